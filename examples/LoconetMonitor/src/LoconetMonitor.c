@@ -4,7 +4,14 @@
 //#
 //#-------------------------------------------------------------------------
 //#
-//#	The functions in this library are used to spread loconet messages.
+//#	The loconet monitor prints every message on the loconet, the
+//#	received ones and the own ones (loopback), as a text line.
+//#
+//#	Every loconet message is decoded into one text line. The opcode
+//#	name and the decoder of the message fields are taken from a table.
+//#	The finished lines are handed over to a low priority output task
+//#	through a ring buffer, so the console never blocks the bus.
+//#	If the ring is full the line is dropped and counted.
 //#
 //#-------------------------------------------------------------------------
 //#
@@ -17,6 +24,11 @@
 //#
 //#-------------------------------------------------------------------------
 //#
+//#	File Version:	2		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	Table driven decoder, the lines are printed by an own task
+//#
 //#	File Version:	1		Date: 14.01.2024
 //#
 //#	Implementation:
@@ -31,9 +43,85 @@
 //
 //==========================================================================
 
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
 #include "LoconetBus.h"
+#include "LoconetRing.h"
 #include "LoconetPhyUART.h"
-#include "LoconetConsumerSwitchSensor.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define LINE_SIZE				192
+#define LINE_END				" ]\n"
+#define LINE_RING_SIZE			64			//	must be a power of two
+
+//	printf() needs most of it
+#define OUTPUT_TASK_STACK_SIZE	3072
+#define OUTPUT_TASK_PERIOD_MS	10
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+//----------------------------------------------------------------------
+//	a field decoder writes the fields of the message into the line
+//	and returns the number of written characters
+//
+typedef int (*monitor_func_decode)( char *pLine, size_t size, LnMsg *pMsg );
+
+
+typedef struct monitor_opcode
+{
+	uint8_t				opcode;
+	const char			*pName;
+	monitor_func_decode	pDecode;
+
+} monitor_opcode_t;
+
+
+typedef struct monitor_line
+{
+	char	text[ LINE_SIZE ];
+
+} monitor_line_t;
+
+
+//==========================================================================
+//
+//		S T A T I C   F U N C T I O N   D E C L A R A T I O N S
+//
+//==========================================================================
+
+static int decode_none( char *pLine, size_t size, LnMsg *pMsg );
+static int decode_loco_spd( char *pLine, size_t size, LnMsg *pMsg );
+static int decode_loco_dirf( char *pLine, size_t size, LnMsg *pMsg );
+static int decode_loco_snd( char *pLine, size_t size, LnMsg *pMsg );
+static int decode_switch( char *pLine, size_t size, LnMsg *pMsg );
+static int decode_switch_report( char *pLine, size_t size, LnMsg *pMsg );
+static int decode_input_report( char *pLine, size_t size, LnMsg *pMsg );
+static int decode_long_ack( char *pLine, size_t size, LnMsg *pMsg );
+static int decode_slot_stat( char *pLine, size_t size, LnMsg *pMsg );
+static int decode_slot_move( char *pLine, size_t size, LnMsg *pMsg );
+static int decode_slot_request( char *pLine, size_t size, LnMsg *pMsg );
+static int decode_loco_adr( char *pLine, size_t size, LnMsg *pMsg );
+static int decode_multi_sense( char *pLine, size_t size, LnMsg *pMsg );
+static int decode_security_element( char *pLine, size_t size, LnMsg *pMsg );
+static int decode_peer_xfer( char *pLine, size_t size, LnMsg *pMsg );
+static int decode_slot_data( char *pLine, size_t size, LnMsg *pMsg );
+static int decode_imm_packet( char *pLine, size_t size, LnMsg *pMsg );
 
 
 //==========================================================================
@@ -44,7 +132,49 @@
 
 loconet_bus_t						theBus;
 loconet_phy_uart_t					theUart;
-loconet_consumer_switch_sensor_t	theSwitchSensorHandler;
+
+static const monitor_opcode_t		opcodeTable[] =
+{
+	{	OPC_BUSY,			"Busy",					decode_none					},
+	{	OPC_GPOFF,			"Power Off",			decode_none					},
+	{	OPC_GPON,			"Power On",				decode_none					},
+	{	OPC_IDLE,			"Emergency Stop All",	decode_none					},
+	{	OPC_LOCO_SPD,		"Loco Speed",			decode_loco_spd				},
+	{	OPC_LOCO_DIRF,		"Loco Dir/F0-F4",		decode_loco_dirf			},
+	{	OPC_LOCO_SND,		"Loco F5-F8",			decode_loco_snd				},
+	{	OPC_SW_REQ,			"Switch Request",		decode_switch				},
+	{	OPC_SW_REP,			"Switch Report",		decode_switch_report		},
+	{	OPC_INPUT_REP,		"Sensor Report",		decode_input_report			},
+	{	OPC_UNKNOWN,		"Unknown",				decode_none					},
+	{	OPC_LONG_ACK,		"Long Ack",				decode_long_ack				},
+	{	OPC_SLOT_STAT1,		"Slot Status",			decode_slot_stat			},
+	{	OPC_CONSIST_FUNC,	"Consist Function",		decode_loco_dirf			},
+	{	OPC_UNLINK_SLOTS,	"Unlink Slots",			decode_slot_move			},
+	{	OPC_LINK_SLOTS,		"Link Slots",			decode_slot_move			},
+	{	OPC_MOVE_SLOTS,		"Move Slots",			decode_slot_move			},
+	{	OPC_RQ_SL_DATA,		"Request Slot",			decode_slot_request			},
+	{	OPC_SW_STATE,		"Switch State",			decode_switch				},
+	{	OPC_SW_ACK,			"Switch Request/Ack",	decode_switch				},
+	{	OPC_LOCO_ADR,		"Request Loco",			decode_loco_adr				},
+	{	OPC_MULTI_SENSE,	"Transponding",			decode_multi_sense			},
+	{	OPC_SE,				"Security Element",		decode_security_element		},
+	{	OPC_PEER_XFER,		"Peer Transfer",		decode_peer_xfer			},
+	{	OPC_SL_RD_DATA,		"Slot Read",			decode_slot_data			},
+	{	OPC_IMM_PACKET,		"Immediate Packet",		decode_imm_packet			},
+	{	OPC_IMM_PACKET_2,	"Immediate Packet 2",	decode_imm_packet			},
+	{	OPC_WR_SL_DATA,		"Slot Write",			decode_slot_data			},
+};
+
+//	index into opcodeTable by (opcode & 0x7F), 0xFF => unknown opcode
+static uint8_t						opcodeIndex[ 128 ];
+
+static char							theLine[ LINE_SIZE ];
+static monitor_line_t				lineStorage[ LINE_RING_SIZE ];
+static loconet_ring_t				lineRing;
+static uint32_t						cntDroppedLines;
+
+static StaticTask_t					xOutputTaskBuffer;
+static StackType_t					xOutputStack[ OUTPUT_TASK_STACK_SIZE ];
 
 
 //==========================================================================
@@ -54,101 +184,307 @@ loconet_consumer_switch_sensor_t	theSwitchSensorHandler;
 //==========================================================================
 
 //**************************************************************************
-//	printRawData
+//	field decoders
 //--------------------------------------------------------------------------
-//	description
 //
-void printRawData( LnMsg *pMsg )
+static int decode_none( char *pLine, size_t size, LnMsg *pMsg )
 {
-	uint8_t	length	= LOCONET_PACKET_SIZE( pMsg->sz.command, pMsg->sz.mesg_size );
+	return( 0 );
+}
+
+
+static int decode_loco_spd( char *pLine, size_t size, LnMsg *pMsg )
+{
+	if( OPC_LOCO_SPD_ESTOP == pMsg->lsp.spd )
+	{
+		return( snprintf( pLine, size, "slot %3u  EMERGENCY STOP", pMsg->lsp.slot ) );
+	}
+
+	return( snprintf( pLine, size, "slot %3u  speed %3u", pMsg->lsp.slot, pMsg->lsp.spd ) );
+}
+
+
+static int decode_loco_dirf( char *pLine, size_t size, LnMsg *pMsg )
+{
+	uint8_t	dirf = pMsg->ldf.dirf;
+
+	return( snprintf(	pLine, size, "slot %3u  %s  F0 %c  F1 %c  F2 %c  F3 %c  F4 %c",
+						pMsg->ldf.slot,
+						(dirf & 0x20) ? "rev" : "fwd",
+						(dirf & 0x10) ? '1' : '0',
+						(dirf & 0x01) ? '1' : '0',
+						(dirf & 0x02) ? '1' : '0',
+						(dirf & 0x04) ? '1' : '0',
+						(dirf & 0x08) ? '1' : '0'	) );
+}
+
+
+static int decode_loco_snd( char *pLine, size_t size, LnMsg *pMsg )
+{
+	uint8_t	snd = pMsg->ls.snd;
+
+	return( snprintf(	pLine, size, "slot %3u  F5 %c  F6 %c  F7 %c  F8 %c",
+						pMsg->ls.slot,
+						(snd & 0x01) ? '1' : '0',
+						(snd & 0x02) ? '1' : '0',
+						(snd & 0x04) ? '1' : '0',
+						(snd & 0x08) ? '1' : '0'	) );
+}
 
-	printf( "  raw: [" );
 
-	for( uint8_t idx = 0 ; idx < length ; idx++ )
+static int decode_switch( char *pLine, size_t size, LnMsg *pMsg )
+{
+	uint16_t	address = (pMsg->srq.sw1 | ((pMsg->srq.sw2 & 0x0F) << 7)) + 1;
+
+	if( OPC_SW_STATE == pMsg->sz.command )
 	{
-		printf( " %02X ", pMsg->data[ idx ] );
+		return( snprintf( pLine, size, "switch %4u", address ) );
 	}
 
-	printf( "]\n" );
+	return( snprintf(	pLine, size, "switch %4u  %s  output %s",
+						address,
+						(pMsg->srq.sw2 & OPC_SW_REQ_DIR) ? "closed" : "thrown",
+						(pMsg->srq.sw2 & OPC_SW_REQ_OUT) ? "on" : "off"			) );
 }
 
 
-//**************************************************************************
-//	printSwitchRequest
-//--------------------------------------------------------------------------
-//	description
-//
-void printSwitchRequest( uint16_t address, bool output_closed, bool direction_thrown )
+static int decode_switch_report( char *pLine, size_t size, LnMsg *pMsg )
 {
-	printf( "CMD: Switch Request" );
+	uint16_t	address = (pMsg->srp.sn1 | ((pMsg->srp.sn2 & 0x0F) << 7)) + 1;
+
+	if( pMsg->srp.sn2 & OPC_SW_REP_INPUTS )
+	{
+		return( snprintf(	pLine, size, "switch %4u  %s input %s",
+							address,
+							(pMsg->srp.sn2 & OPC_SW_REP_SW) ? "switch" : "aux",
+							(pMsg->srp.sn2 & OPC_SW_REP_HI) ? "hi" : "lo"		) );
+	}
+
+	return( snprintf(	pLine, size, "switch %4u  outputs closed %s  thrown %s",
+						address,
+						(pMsg->srp.sn2 & OPC_SW_REP_CLOSED) ? "on" : "off",
+						(pMsg->srp.sn2 & OPC_SW_REP_THROWN) ? "on" : "off"	) );
 }
 
 
-//**************************************************************************
-//	printSwitchReport
-//--------------------------------------------------------------------------
-//	description
-//
-void printSwitchReport( uint16_t address, bool output_closed, bool direction_thrown )
+static int decode_input_report( char *pLine, size_t size, LnMsg *pMsg )
 {
-	printf( "CMD: Switch Report " );
+	uint16_t	address =		(((pMsg->ir.in1 | ((pMsg->ir.in2 & 0x0F) << 7)) << 1)
+							+	((pMsg->ir.in2 & OPC_INPUT_REP_SW) ? 2 : 1));
+
+	return( snprintf(	pLine, size, "sensor %4u  %s",
+						address,
+						(pMsg->ir.in2 & OPC_INPUT_REP_HI) ? "occupied" : "free"	) );
 }
 
 
-//**************************************************************************
-//	printOutputReport
-//--------------------------------------------------------------------------
-//	description
-//
-void printOutputReport( uint16_t address, bool output_closed, bool direction_thrown )
+static int decode_long_ack( char *pLine, size_t size, LnMsg *pMsg )
 {
-	printf( "CMD: Output Report " );
+	return( snprintf(	pLine, size, "for 0x%02X  ack 0x%02X",
+						pMsg->lack.opcode | LOCONET_OPC_MASK,
+						pMsg->lack.ack1							) );
+}
+
+
+static int decode_slot_stat( char *pLine, size_t size, LnMsg *pMsg )
+{
+	return( snprintf(	pLine, size, "slot %3u  %s  %s",
+						pMsg->ss.slot,
+						LOCO_STAT( pMsg->ss.stat ),
+						CONSIST_STAT( pMsg->ss.stat )	) );
+}
+
+
+static int decode_slot_move( char *pLine, size_t size, LnMsg *pMsg )
+{
+	return( snprintf( pLine, size, "src %3u  dest %3u", pMsg->sm.src, pMsg->sm.dest ) );
+}
+
+
+static int decode_slot_request( char *pLine, size_t size, LnMsg *pMsg )
+{
+	return( snprintf( pLine, size, "slot %3u", pMsg->sr.slot ) );
+}
+
+
+static int decode_loco_adr( char *pLine, size_t size, LnMsg *pMsg )
+{
+	return( snprintf( pLine, size, "address %4u", (pMsg->la.adr_hi << 7) | pMsg->la.adr_lo ) );
+}
+
+
+static int decode_multi_sense( char *pLine, size_t size, LnMsg *pMsg )
+{
+	uint8_t	type = pMsg->mstr.type & OPC_MULTI_SENSE_MSG;
+
+	if( OPC_MULTI_SENSE_DEVICE_INFO == type )
+	{
+		return( snprintf(	pLine, size, "device info %02X %02X %02X %02X",
+							pMsg->msdi.arg1, pMsg->msdi.arg2, pMsg->msdi.arg3, pMsg->msdi.arg4 ) );
+	}
+
+	return( snprintf(	pLine, size, "zone %4u  loco %4u  %s",
+						OPC_MULTI_SENSE_BOARD_ADDRESS( pMsg->mstr.zone, pMsg->mstr.type ),
+						OPC_MULTI_SENSE_LOCO_ADDRESS( pMsg->mstr.adr1, pMsg->mstr.adr2 ),
+						(OPC_MULTI_SENSE_PRESENT == type) ? "present" : "absent"			) );
+}
+
+
+static int decode_security_element( char *pLine, size_t size, LnMsg *pMsg )
+{
+	return( snprintf(	pLine, size, "address %4u  cmd 0x%02X",
+						(pMsg->se.addr_h << 7) | pMsg->se.addr_l,
+						pMsg->se.cmd								) );
+}
+
+
+static int decode_peer_xfer( char *pLine, size_t size, LnMsg *pMsg )
+{
+	if( (0x10 == pMsg->sz.mesg_size) && (0x02 == pMsg->sv.sv_type) )
+	{
+		return( snprintf(	pLine, size, "SV cmd 0x%02X  src %u  dst %u  sv %u",
+							pMsg->sv.sv_cmd,
+							pMsg->sv.src,
+							(pMsg->sv.dst_lo | ((pMsg->sv.svx1 & 0x01) << 7)) | ((pMsg->sv.dst_hi | ((pMsg->sv.svx1 & 0x02) << 6)) << 8),
+							(pMsg->sv.sv_addl | ((pMsg->sv.svx1 & 0x04) << 5)) | ((pMsg->sv.sv_addh | ((pMsg->sv.svx1 & 0x08) << 4)) << 8)	) );
+	}
+
+	return( snprintf(	pLine, size, "src %u  dst %u",
+						pMsg->px.src,
+						pMsg->px.dst_l | (pMsg->px.dst_h << 7)	) );
+}
+
+
+static int decode_slot_data( char *pLine, size_t size, LnMsg *pMsg )
+{
+	if( FC_SLOT == pMsg->sd.slot )
+	{
+		return( snprintf(	pLine, size, "fast clock  %02u:%02u  day %u  rate %u",
+							(uint8_t)((pMsg->fc.hours_24 & 0x7F) - 104) % 24,
+							(uint8_t)((pMsg->fc.mins_60 & 0x7F) - 68) % 60,
+							pMsg->fc.days,
+							pMsg->fc.clk_rate									) );
+	}
+
+	if( PRG_SLOT == pMsg->sd.slot )
+	{
+		return( snprintf(	pLine, size, "programmer  cmd 0x%02X  stat 0x%02X  cv %u  value %u",
+							pMsg->pt.pcmd,
+							pMsg->pt.pstat,
+							PROG_CV_NUM( pMsg->pt ) + 1,
+							PROG_DATA( pMsg->pt )			) );
+	}
+
+	return( snprintf(	pLine, size, "slot %3u  address %4u  %s  %s steps  speed %3u  dirf 0x%02X  trk 0x%02X",
+						pMsg->sd.slot,
+						pMsg->sd.adr | (pMsg->sd.adr2 << 7),
+						LOCO_STAT( pMsg->sd.stat ),
+						DEC_MODE( pMsg->sd.stat ),
+						pMsg->sd.spd,
+						pMsg->sd.dirf,
+						pMsg->sd.trk												) );
+}
+
+
+static int decode_imm_packet( char *pLine, size_t size, LnMsg *pMsg )
+{
+	return( snprintf( pLine, size, "repeat %u", pMsg->sp.reps & 0x07 ) );
 }
 
 
 //**************************************************************************
-//	printSwitchState
+//	formatLoconetMsg
 //--------------------------------------------------------------------------
-//	description
+//	opcode name, decoded fields and the raw bytes into one line
 //
-void printSwitchState( uint16_t address, bool output_closed, bool direction_thrown )
+int formatLoconetMsg( char *pLine, size_t size, LnMsg *pMsg )
 {
-	printf( "CMD: Switch State  " );
+	uint8_t	length	= LOCONET_PACKET_SIZE( pMsg->sz.command, pMsg->sz.mesg_size );
+	uint8_t	tabIdx	= opcodeIndex[ pMsg->sz.command & 0x7F ];
+	int		pos;
+
+	if( 0xFF == tabIdx )
+	{
+		pos = snprintf( pLine, size, "0x%02X unknown         ", pMsg->sz.command );
+	}
+	else
+	{
+		pos  = snprintf( pLine, size, "%-20s ", opcodeTable[ tabIdx ].pName );
+		pos += (*opcodeTable[ tabIdx ].pDecode)( &(pLine[ pos ]), size - pos, pMsg );
+	}
+
+	//------------------------------------------------------------------
+	//	the room for LINE_END is kept free, bytes that do not fit
+	//	are left out, so every line is closed
+	//
+	if( ((size_t)pos + 3 + sizeof( LINE_END )) <= size )
+	{
+		pos += snprintf( &(pLine[ pos ]), size - pos, "  [" );
+	}
+
+	for( uint8_t idx = 0 ; (idx < length) && (((size_t)pos + 3 + sizeof( LINE_END )) <= size) ; idx++ )
+	{
+		pos += snprintf( &(pLine[ pos ]), size - pos, " %02X", pMsg->data[ idx ] );
+	}
+
+	if( ((size_t)pos + sizeof( LINE_END )) > size )
+	{
+		pos = (int)(size - sizeof( LINE_END ));
+	}
+
+	pos += snprintf( &(pLine[ pos ]), size - pos, LINE_END );
+
+	return( pos );
 }
 
 
 //**************************************************************************
-//	printSensorReport
+//	printLoconetMsg
 //--------------------------------------------------------------------------
-//	description
+//	bus consumer: format the line and hand it over to the output task
 //
-void printSensorReport( uint16_t address, bool state )
+void printLoconetMsg( loconet_bus_consumer pConsumer, LnMsg *pMsg )
 {
-	printf( "CMD: Sensor Report " );
+	formatLoconetMsg( theLine, sizeof( theLine ), pMsg );
+
+	if( !loconet_ring_push( &lineRing, theLine ) )
+	{
+		cntDroppedLines++;
+	}
 }
 
 
 //**************************************************************************
-//	printLoconetMsg
+//	outputTask
 //--------------------------------------------------------------------------
-//	description
+//	low priority task that writes the lines to the console
 //
-void printLoconetMsg( loconet_bus_consumer pConsumer, LnMsg *pMsg )
+void outputTask( void *pParameter )
 {
-	switch( pMsg->sz.command )
+	monitor_line_t	line;
+	uint32_t		reportedDrops = 0;
+	uint32_t		drops;
+
+	while( 1 )
 	{
-		case OPC_SW_REP:
-		case OPC_SW_REQ:
-		case OPC_SW_STATE:
-		case OPC_INPUT_REP:
-			break;
+		while( loconet_ring_pop( &lineRing, &line ) )
+		{
+			fputs( line.text, stdout );
+		}
 
-		default:
-			printf( "CMD: 0x%02X unknown  ", pMsg->sz.command );
-			break;
-	}
+		drops = cntDroppedLines;
+
+		if( reportedDrops != drops )
+		{
+			printf( "*** %lu lines dropped\n", (unsigned long)(drops - reportedDrops) );
+
+			reportedDrops = drops;
+		}
 
-	printRawData( pMsg );
+		fflush( stdout );
+
+		vTaskDelay( OUTPUT_TASK_PERIOD_MS / portTICK_PERIOD_MS );
+	}
 }
 
 
@@ -169,28 +505,47 @@ void app_main()
 	theUart.invertRx	= true;
 	theUart.invertTx	= true;
 
+	memset( opcodeIndex, 0xFF, sizeof( opcodeIndex ) );
+
+	for( uint8_t idx = 0 ; (sizeof( opcodeTable ) / sizeof( opcodeTable[ 0 ] )) > idx ; idx++ )
+	{
+		opcodeIndex[ opcodeTable[ idx ].opcode & 0x7F ] = idx;
+	}
+
+	loconet_ring_init( &lineRing, lineStorage, sizeof( monitor_line_t ), LINE_RING_SIZE );
+
 	loconet_bus_init( &theBus );
 	loconet_phy_uart_init( &theUart );
-	loconet_consumer_switch_sensor_init( &theSwitchSensorHandler, &theBus );
 
 	//------------------------------------------------------------------
 	//	register functions
 	//
-	loconet_consumer_register_notify_switch_request( &theSwitchSensorHandler, printSwitchRequest );
-	loconet_consumer_register_notify_switch_report( &theSwitchSensorHandler, printSwitchReport );
-	loconet_consumer_register_notify_switch_state( &theSwitchSensorHandler, printSwitchState );
-	loconet_consumer_register_notify_switch_outputs( &theSwitchSensorHandler, printOutputReport );
-	loconet_consumer_register_notify_sensor( &theSwitchSensorHandler, printSensorReport );
-
 	loconet_bus_register_consumer( &theBus, NULL, printLoconetMsg );
+	loconet_bus_set_loopback( &theBus, printLoconetMsg, true );
 
 	vTaskDelay( 5000 / portTICK_PERIOD_MS );
 
 	printf( "Loconet Monitor\n" );
 
+	xTaskCreateStatic(	outputTask,
+						"LN_monitor",
+						OUTPUT_TASK_STACK_SIZE,
+						NULL,
+						tskIDLE_PRIORITY,
+						xOutputStack,
+						&xOutputTaskBuffer		);
+
+	//------------------------------------------------------------------
+	//	every waiting message is dispatched, a burst on the loconet
+	//	must not fill the rx queue
+	//
 	while( 1 )
 	{
-		loconet_phy_uart_process( &theUart );
+		do
+		{
+			loconet_phy_uart_process( &theUart );
+
+		} while( uxQueueMessagesWaiting( theUart.rxQueue ) );
 
 		vTaskDelay( 10 / portTICK_PERIOD_MS );
 	}
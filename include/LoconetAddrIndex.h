@@ -0,0 +1,82 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetAddrIndex.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	A small hash index that maps a loco address (the key) to an
+//#	8 bit value, e.g. a slot number or a table index.
+//#	Insert, find and remove are O(1) on average.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+//	must be a power of 2, the index will be filled up to 3/4
+#define LOCONET_ADDR_INDEX_SIZE			256
+
+#define LOCONET_ADDR_INDEX_NO_KEY		0xFFFF
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+//----------------------------------------------------------------------
+//	the index structure (open addressing with linear probing)
+//
+typedef struct loconet_addr_index
+{
+	uint16_t	key[ LOCONET_ADDR_INDEX_SIZE ];
+	uint8_t		value[ LOCONET_ADDR_INDEX_SIZE ];
+	uint16_t	count;
+
+} loconet_addr_index_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern void		loconet_addr_index_init( loconet_addr_index_t *pIndex );
+
+extern uint8_t	loconet_addr_index_insert( loconet_addr_index_t *pIndex, uint16_t key, uint8_t value );
+extern bool		loconet_addr_index_find( loconet_addr_index_t *pIndex, uint16_t key, uint8_t *pValue );
+extern void		loconet_addr_index_remove( loconet_addr_index_t *pIndex, uint16_t key );
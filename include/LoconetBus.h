@@ -34,6 +34,10 @@
 //==========================================================================
 
 #include <inttypes.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 #include "ln_opc.h"
 
@@ -44,7 +48,10 @@
 //
 //==========================================================================
 
-#define	LOCONET_BUS_MAX_CONSUMERS		10
+//	a daemon with many gateways and consumers may need more
+#ifndef LOCONET_BUS_MAX_CONSUMERS
+	#define	LOCONET_BUS_MAX_CONSUMERS	10
+#endif
 
 
 //==========================================================================
@@ -68,12 +75,21 @@ typedef void (*loconet_bus_consumer_func)( loconet_bus_consumer pConsumer, LnMsg
 
 //----------------------------------------------------------------------
 //	the bus structure
+//	Only one task at a time spreads a message: broadcast and loopback
+//	hold the (recursive) bus lock while the consumers run, so a
+//	consumer never runs in two tasks at the same time.
 //
 typedef struct loconet_bus
 {
+	SemaphoreHandle_t			lock;
+	StaticSemaphore_t			lockBuffer;
+
 	loconet_bus_consumer		consumerArray[ LOCONET_BUS_MAX_CONSUMERS ];
 	loconet_bus_consumer_func	consumerFunctions[ LOCONET_BUS_MAX_CONSUMERS ];
+	bool						loopback[ LOCONET_BUS_MAX_CONSUMERS ];
 	uint8_t						numConsumers;
+	loconet_bus_consumer_func	pActiveSender;		//	sender of the msg in broadcast
+	bool						isLoopback;			//	the msg in broadcast is a loopback
 
 } loconet_bus_t;
 
@@ -90,3 +106,41 @@ extern uint8_t loconet_bus_register_consumer( loconet_bus_t *pBus, loconet_bus_c
 extern uint8_t loconet_bus_unregister_consumer( loconet_bus_t *pBus, loconet_bus_consumer pConsumer, loconet_bus_consumer_func pFunc );
 
 extern void loconet_bus_broadcast( loconet_bus_t *pBus, LnMsg *pMsg, loconet_bus_consumer_func pSender );
+
+//--------------------------------------------------------------------------
+//	the consumers may run in another task than the application (e.g.
+//	the dispatch task of the phy in pipeline mode). An application task
+//	that calls functions of a consumer (process, checkpoint, sample...)
+//	must hold the bus lock meanwhile. The lock can be taken again by
+//	the same task, so broadcasts inside are okay.
+extern void loconet_bus_lock( loconet_bus_t *pBus );
+extern void loconet_bus_unlock( loconet_bus_t *pBus );
+
+//--------------------------------------------------------------------------
+//	a consumer that opts in gets the own messages again after they
+//	are sent to the loconet (e.g. a monitor). For the sender of the
+//	message this is the tx completion.
+extern uint8_t loconet_bus_set_loopback( loconet_bus_t *pBus, loconet_bus_consumer_func pFunc, bool enable );
+
+//--------------------------------------------------------------------------
+//	called by a phy for a message that was sent by 'pSender',
+//	only the consumers with loopback get the message
+extern void loconet_bus_loopback( loconet_bus_t *pBus, LnMsg *pMsg, loconet_bus_consumer_func pSender );
+
+//--------------------------------------------------------------------------
+//	can be called by a phy without the lock, true if any consumer
+//	opted in, otherwise the own messages need not be handed over
+extern bool loconet_bus_has_loopback( loconet_bus_t *pBus );
+
+//--------------------------------------------------------------------------
+//	can be called by a consumer, true while a loopback is spread
+extern bool loconet_bus_is_loopback( loconet_bus_t *pBus );
+
+//--------------------------------------------------------------------------
+//	can be called by a consumer to get the sender of the current msg
+extern loconet_bus_consumer_func loconet_bus_get_sender( loconet_bus_t *pBus );
+
+//--------------------------------------------------------------------------
+//	returns true for messages that must not wait behind other messages
+//	(power off, idle, emergency stop)
+extern bool loconet_bus_is_safety_msg( const LnMsg *pMsg );
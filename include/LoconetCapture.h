@@ -0,0 +1,169 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetCapture.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library record all loconet
+//#	messages on the bus with a timestamp (us) and the id of the sender.
+//#	The bus consumer only copies the message into a lock-free ring,
+//#	a background task writes the records into a file.
+//#
+//#	File format:
+//#		header:	'L' 'N' 'C' 'A' 'P' <version>
+//#		record:	<time delta in us, varint> <source id> <msg bytes>
+//#
+//#	The time delta of the first record is relative to 0, the varint
+//#	holds 7 bits per byte, least significant first, bit 7 set if
+//#	more bytes follow. The length of the message is given by the
+//#	message itself (LOCONET_PACKET_SIZE).
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "ln_opc.h"
+#include "LoconetBus.h"
+#include "LoconetRing.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+//	number of records in the ring, must be a power of two
+#ifndef LOCONET_CAPTURE_RING_SIZE
+	#define LOCONET_CAPTURE_RING_SIZE		512
+#endif
+
+#define LOCONET_CAPTURE_MAX_SOURCES			8
+#define LOCONET_CAPTURE_FLUSH_PERIOD_MS		100
+
+//	the records are collected before they are written to the file
+#define LOCONET_CAPTURE_OUT_BUFFER_SIZE		512
+
+#define LOCONET_CAPTURE_MAGIC				"LNCAP"
+#define LOCONET_CAPTURE_VERSION				1
+#define LOCONET_CAPTURE_HEADER_SIZE			6
+
+//	source id of messages from an unknown sender
+#define LOCONET_CAPTURE_SOURCE_UNKNOWN		0
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+//----------------------------------------------------------------------
+//	after a stop the capture is draining until the flush has written
+//	the last records, only then the file is given back
+//
+typedef enum
+{
+	LN_CAPTURE_IDLE		= 0,
+	LN_CAPTURE_RECORDING,
+	LN_CAPTURE_DRAINING
+
+} loconet_capture_state_t;
+
+
+//----------------------------------------------------------------------
+//	one record in the ring
+//
+typedef struct loconet_capture_record
+{
+	uint64_t	time;			//	in us
+	uint8_t		source;
+	LnMsg		msg;
+
+} loconet_capture_record_t;
+
+
+//----------------------------------------------------------------------
+//	the capture structure
+//
+typedef struct loconet_capture
+{
+	loconet_bus_t				*pBus;
+	loconet_ring_t				ring;
+	loconet_capture_record_t	records[ LOCONET_CAPTURE_RING_SIZE ];
+
+	loconet_bus_consumer_func	pSourceFunc[ LOCONET_CAPTURE_MAX_SOURCES ];
+	uint8_t						sourceId[ LOCONET_CAPTURE_MAX_SOURCES ];
+	uint8_t						numSources;
+
+	FILE						*pFile;
+	atomic_uchar				state;				//	loconet_capture_state_t
+	uint64_t					lastTime;
+	uint8_t						outBuffer[ LOCONET_CAPTURE_OUT_BUFFER_SIZE ];
+
+	TaskHandle_t				flushTask;
+
+	uint32_t					cntRecords;
+	uint32_t					cntDropped;
+	uint64_t					cntBytes;			//	written to the file
+	uint32_t					cntWriteErrors;		//	short writes and failed flushes
+
+} loconet_capture_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern uint8_t loconet_capture_init( loconet_capture_t *pCapture, loconet_bus_t *pBus );
+
+extern uint8_t	loconet_capture_register_source( loconet_capture_t *pCapture, loconet_bus_consumer_func pFunc, uint8_t id );
+
+extern uint8_t	loconet_capture_start( loconet_capture_t *pCapture, FILE *pFile );
+extern void		loconet_capture_stop( loconet_capture_t *pCapture );
+extern bool		loconet_capture_is_busy( loconet_capture_t *pCapture );
+
+//--------------------------------------------------------------------------
+//	writes all records of the ring into the file, this is done by the
+//	task started with loconet_capture_start_task() or, without the task,
+//	it must be called in a periodical manner
+extern void loconet_capture_flush( loconet_capture_t *pCapture );
+extern void loconet_capture_start_task( loconet_capture_t *pCapture );
+
+//--------------------------------------------------------------------------
+//	this is the function that must be registered at the "bus"
+//	to be able to record the loconet messages
+extern void loconet_capture_process( loconet_bus_consumer pConsumer, LnMsg *pMsg );
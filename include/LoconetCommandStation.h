@@ -0,0 +1,100 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetCommandStation.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library emulate the slot manager
+//#	of a command station. Slot requests, slot writes, moves and links
+//#	are answered with OPC_SL_RD_DATA or OPC_LONG_ACK like a real
+//#	command station does, speed and function messages update the slots.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "ln_opc.h"
+#include "LoconetBus.h"
+#include "LoconetAddrIndex.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+//	slot 0 is the dispatch slot, slots 1 .. 119 are loco slots
+#define LOCONET_CS_NUM_SLOTS			120
+
+//	decoder mode of a new allocated slot
+#define LOCONET_CS_DEFAULT_DEC_MODE		(DEC_MODE_128)
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+//----------------------------------------------------------------------
+//	the command station structure
+//	the slots are stored in the layout of the slot data message,
+//	so a reply is a copy of the slot
+//
+typedef struct loconet_command_station
+{
+	loconet_bus_t			*pBus;
+	rwSlotDataMsg			slots[ LOCONET_CS_NUM_SLOTS ];
+	loconet_addr_index_t	addrIndex;
+
+	uint8_t					trk;				//	global track status
+	uint8_t					dispatchSlot;		//	0 => nothing dispatched
+
+	uint32_t				cntRequests;
+	uint32_t				cntReplies;
+	uint32_t				cntRejects;
+
+} loconet_command_station_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern uint8_t loconet_command_station_init( loconet_command_station_t *pCs, loconet_bus_t *pBus );
+
+extern const rwSlotDataMsg *loconet_command_station_get_slot( loconet_command_station_t *pCs, uint8_t slot );
+
+//--------------------------------------------------------------------------
+//	this is the function that must be registered at the "bus"
+//	to be able to consume (handle) slot loconet messages
+extern void loconet_command_station_process( loconet_bus_consumer pConsumer, LnMsg *pMsg );
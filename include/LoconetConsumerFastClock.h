@@ -0,0 +1,116 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetConsumerFastClock.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library decode the fast clock
+//#	slot and interpolate the fast time locally between the updates
+//#	of the clock master. A query will never send anything to the bus.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "ln_opc.h"
+#include "LoconetBus.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+//	an error bigger than this will be corrected by a jump,
+//	smaller errors will be corrected smoothly
+#define LOCONET_FAST_CLOCK_MAX_SLEW_MS		(2 * 60 * 1000)
+
+//	time (real time) to correct a small error
+#define LOCONET_FAST_CLOCK_SLEW_TIME_US		(5 * 1000 * 1000)
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+//----------------------------------------------------------------------
+//	the fast clock structure
+//	the fast time is calculated as
+//		anchorFastMs + (now - anchorTime) * effectiveRate
+//	up to 'slewEnd', after that the master rate is used
+//
+typedef struct loconet_consumer_fast_clock
+{
+	loconet_bus_t	*pBus;
+	bool			valid;
+	uint8_t			rate;				//	rate of the clock master
+	uint16_t		id;					//	id of the last device that set the clock
+
+	uint64_t		anchorTime;			//	in us (esp_timer_get_time)
+	uint64_t		anchorFastMs;		//	fast ms since day 0, 00:00
+	uint32_t		effectiveRate;		//	in 1/1000
+	uint64_t		slewEnd;			//	in us
+
+	uint32_t		cntUpdates;
+	uint32_t		cntJumps;
+
+	atomic_uint		sequence;
+
+} loconet_consumer_fast_clock_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern uint8_t loconet_consumer_fast_clock_init( loconet_consumer_fast_clock_t *pClock, loconet_bus_t *pBus );
+
+extern uint64_t	loconet_fast_clock_get_ms( loconet_consumer_fast_clock_t *pClock );
+extern bool		loconet_fast_clock_get_time(	loconet_consumer_fast_clock_t	*pClock,
+												uint16_t						*pDays,
+												uint8_t							*pHours,
+												uint8_t							*pMinutes,
+												uint8_t							*pSeconds	);
+extern uint8_t	loconet_fast_clock_get_rate( loconet_consumer_fast_clock_t *pClock );
+
+//--------------------------------------------------------------------------
+//	ask the clock master for the fast clock slot,
+//	e.g. once after the start
+extern void		loconet_fast_clock_request( loconet_consumer_fast_clock_t *pClock );
+
+//--------------------------------------------------------------------------
+//	this is the function that must be registered at the "bus"
+//	to be able to consume (handle) fast clock loconet messages
+extern void loconet_consumer_fast_clock_process( loconet_bus_consumer pConsumer, LnMsg *pMsg );
@@ -0,0 +1,135 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetConsumerSlotTable.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library keep a mirror of the
+//#	slot table of the command station. Speed, direction and functions
+//#	of every loco can be read locally without asking the command station.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "ln_opc.h"
+#include "LoconetBus.h"
+#include "LoconetAddrIndex.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+//	slot 0 is the dispatch slot, slots 1 .. 119 are loco slots
+#define LOCONET_SLOT_TABLE_SIZE				120
+
+#define LOCONET_SLOT_TABLE_MAX_LISTENERS	4
+
+//	bits of the 'changed' mask of the notify function
+#define LN_SLOT_CHANGED_STATUS				0x01
+#define LN_SLOT_CHANGED_ADDRESS				0x02
+#define LN_SLOT_CHANGED_SPEED				0x04
+#define LN_SLOT_CHANGED_DIRF				0x08
+#define LN_SLOT_CHANGED_SOUND				0x10
+#define LN_SLOT_CHANGED_OTHER				0x20
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+//----------------------------------------------------------------------
+//	notify function definition
+//	will be called after the data of a slot changed
+//
+typedef void (*loconet_slot_table_func_notify)( void *pContext, uint8_t slot, uint8_t changed );
+
+
+//----------------------------------------------------------------------
+//	the mirrored data of one slot
+//
+typedef struct loconet_slot
+{
+	uint16_t	address;
+	uint16_t	id;
+	uint8_t		stat;
+	uint8_t		spd;
+	uint8_t		dirf;
+	uint8_t		snd;
+	uint8_t		trk;
+	uint8_t		ss2;
+	bool		valid;			//	slot data was read at least once
+	uint32_t	updateTime;		//	in ms
+
+} loconet_slot_t;
+
+
+//----------------------------------------------------------------------
+//	the slot table structure
+//
+typedef struct loconet_consumer_slot_table
+{
+	loconet_bus_t					*pBus;
+	loconet_slot_t					slots[ LOCONET_SLOT_TABLE_SIZE ];
+	loconet_addr_index_t			addrIndex;
+
+	loconet_slot_table_func_notify	pNotifyFunc[ LOCONET_SLOT_TABLE_MAX_LISTENERS ];
+	void							*pNotifyContext[ LOCONET_SLOT_TABLE_MAX_LISTENERS ];
+	uint8_t							numListeners;
+
+} loconet_consumer_slot_table_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern uint8_t loconet_consumer_slot_table_init( loconet_consumer_slot_table_t *pTable, loconet_bus_t *pBus );
+
+extern uint8_t	loconet_slot_table_register_notify( loconet_consumer_slot_table_t *pTable, loconet_slot_table_func_notify pFunc, void *pContext );
+
+extern const loconet_slot_t *loconet_slot_table_get_slot( loconet_consumer_slot_table_t *pTable, uint8_t slot );
+extern bool		loconet_slot_table_find_address( loconet_consumer_slot_table_t *pTable, uint16_t address, uint8_t *pSlot );
+
+//--------------------------------------------------------------------------
+//	set the data of a slot that was not learned from the bus,
+//	e.g. from a restored checkpoint
+extern void		loconet_slot_table_set_slot( loconet_consumer_slot_table_t *pTable, uint8_t slot, const loconet_slot_t *pData );
+
+//--------------------------------------------------------------------------
+//	this is the function that must be registered at the "bus"
+//	to be able to consume (handle) slot loconet messages
+extern void loconet_consumer_slot_table_process( loconet_bus_consumer pConsumer, LnMsg *pMsg );
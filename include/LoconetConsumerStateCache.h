@@ -0,0 +1,164 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetConsumerStateCache.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library keep the last known state
+//#	of all sensors and switches (turnouts) of the loconet.
+//#	The states are held in packed bitmaps, so every query is O(1).
+//#	Every change gets a generation number, so a client (e.g. an UI)
+//#	can ask for all changes since its last refresh.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "ln_opc.h"
+#include "LoconetBus.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define LOCONET_STATE_CACHE_MAX_SENSORS		4096
+#define LOCONET_STATE_CACHE_MAX_SWITCHES	2048
+#define LOCONET_STATE_CACHE_MAX_ITEMS		(LOCONET_STATE_CACHE_MAX_SENSORS + LOCONET_STATE_CACHE_MAX_SWITCHES)
+
+//	must be a power of 2
+#ifndef LOCONET_STATE_CACHE_JOURNAL_SIZE
+	#define LOCONET_STATE_CACHE_JOURNAL_SIZE	256
+#endif
+
+#define LN_STATE_BITMAP_WORDS( bits )		(((bits) + 31) / 32)
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+typedef enum
+{
+	LN_STATE_ITEM_SENSOR	= 0,
+	LN_STATE_ITEM_SWITCH
+
+} loconet_state_item_t;
+
+
+//----------------------------------------------------------------------
+//	a delta function will be called once for every item that
+//	changed since the asked generation
+//
+typedef void (*loconet_state_cache_func_delta)( void *pContext, loconet_state_item_t item, uint16_t address );
+
+
+//----------------------------------------------------------------------
+//	the packed state of all sensors and switches
+//	bit (address - 1) holds the state of the given address
+//	a copy of this structure is a complete snapshot of the layout state
+//
+typedef struct loconet_state_snapshot
+{
+	uint32_t	generation;
+	uint32_t	sensorState[  LN_STATE_BITMAP_WORDS( LOCONET_STATE_CACHE_MAX_SENSORS ) ];
+	uint32_t	sensorKnown[  LN_STATE_BITMAP_WORDS( LOCONET_STATE_CACHE_MAX_SENSORS ) ];
+	uint32_t	switchClosed[ LN_STATE_BITMAP_WORDS( LOCONET_STATE_CACHE_MAX_SWITCHES ) ];
+	uint32_t	switchOutput[ LN_STATE_BITMAP_WORDS( LOCONET_STATE_CACHE_MAX_SWITCHES ) ];
+	uint32_t	switchKnown[  LN_STATE_BITMAP_WORDS( LOCONET_STATE_CACHE_MAX_SWITCHES ) ];
+
+} loconet_state_snapshot_t;
+
+
+//----------------------------------------------------------------------
+//	the state cache structure
+//
+typedef struct loconet_consumer_state_cache
+{
+	loconet_bus_t				*pBus;
+	loconet_state_snapshot_t	state;
+
+	//------------------------------------------------------------------
+	//	per item data, items are numbered:
+	//		sensors:	0 .. (MAX_SENSORS - 1)
+	//		switches:	MAX_SENSORS .. (MAX_ITEMS - 1)
+	//
+	uint32_t					changeTime[ LOCONET_STATE_CACHE_MAX_ITEMS ];		//	in ms
+	uint32_t					changeGeneration[ LOCONET_STATE_CACHE_MAX_ITEMS ];
+
+	//------------------------------------------------------------------
+	//	journal of the last changes, index is (generation & (SIZE - 1))
+	//
+	uint16_t					journal[ LOCONET_STATE_CACHE_JOURNAL_SIZE ];
+
+	//------------------------------------------------------------------
+	//	odd while the state is updated, used for consistent snapshots
+	//
+	atomic_uint					sequence;
+
+} loconet_consumer_state_cache_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern uint8_t loconet_consumer_state_cache_init( loconet_consumer_state_cache_t *pCache, loconet_bus_t *pBus );
+
+extern bool		loconet_state_cache_get_sensor( loconet_consumer_state_cache_t *pCache, uint16_t address, bool *pState );
+extern bool		loconet_state_cache_get_switch( loconet_consumer_state_cache_t *pCache, uint16_t address, bool *pClosed, bool *pOutput );
+extern uint32_t	loconet_state_cache_get_sensor_time( loconet_consumer_state_cache_t *pCache, uint16_t address );
+extern uint32_t	loconet_state_cache_get_switch_time( loconet_consumer_state_cache_t *pCache, uint16_t address );
+extern uint32_t	loconet_state_cache_get_generation( loconet_consumer_state_cache_t *pCache );
+
+extern uint8_t	loconet_state_cache_changed_since(	loconet_consumer_state_cache_t	*pCache,
+													uint32_t						generation,
+													loconet_state_cache_func_delta	pFunc,
+													void							*pContext,
+													uint32_t						*pNewGeneration	);
+
+extern void		loconet_state_cache_snapshot( loconet_consumer_state_cache_t *pCache, loconet_state_snapshot_t *pSnapshot );
+
+//--------------------------------------------------------------------------
+//	these functions will set a state that was not learned from the bus,
+//	e.g. from a discovery or a restored checkpoint
+extern void		loconet_state_cache_set_sensor( loconet_consumer_state_cache_t *pCache, uint16_t address, bool state );
+extern void		loconet_state_cache_set_switch( loconet_consumer_state_cache_t *pCache, uint16_t address, bool closed, bool output );
+
+//--------------------------------------------------------------------------
+//	this is the function that must be registered at the "bus"
+//	to be able to consume (handle) switch and sensor loconet messages
+extern void loconet_consumer_state_cache_process( loconet_bus_consumer pConsumer, LnMsg *pMsg );
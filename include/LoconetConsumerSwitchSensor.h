@@ -52,6 +52,20 @@
 #define NOTIFY_FUNC_IDX_SWITCH_REPORT		2
 #define NOTIFY_FUNC_IDX_SWITCH_OUTPUTS		3
 #define NOTIFY_FUNC_IDX_SWITCH_STATE		4
+#define NOTIFY_FUNC_IDX_MAX					5
+
+//	max number of listeners per notify function index, must be <= 32
+#ifndef LOCONET_CONSUMER_MAX_LISTENERS
+	#define LOCONET_CONSUMER_MAX_LISTENERS	16
+#endif
+
+#define LOCONET_CONSUMER_MAX_SEGMENTS		(2 * LOCONET_CONSUMER_MAX_LISTENERS + 1)
+
+//	sensor debouncing, the number of wheel slots must be a power of 2
+#define LOCONET_DEBOUNCE_MAX_SENSORS		4096
+#define LOCONET_DEBOUNCE_MAX_RANGES			8
+#define LOCONET_DEBOUNCE_WHEEL_SLOTS		256		//	max 256
+#define LOCONET_DEBOUNCE_TICK_MS			10
 
 
 //==========================================================================
@@ -69,6 +83,113 @@ typedef void (*loconet_consumer_func_notify_sensor)( uint16_t address, bool stat
 typedef void (*loconet_consumer_func_notify_switch)( uint16_t address, bool output_closed, bool direction_thrown );
 
 
+//----------------------------------------------------------------------
+//	listener function definitions
+//	any number of listeners (up to LOCONET_CONSUMER_MAX_LISTENERS) can
+//	be added for every notify function index. Every listener gets only
+//	the addresses of its range and its own context pointer.
+//
+typedef void (*loconet_consumer_func_listener_sensor)( void *pContext, uint16_t address, bool state );
+typedef void (*loconet_consumer_func_listener_switch)( void *pContext, uint16_t address, bool output_closed, bool direction_thrown );
+
+
+//----------------------------------------------------------------------
+//	a listener is removed by the handle it got when it was added,
+//	0 is never a valid handle
+//
+typedef uint32_t	loconet_consumer_listener_handle_t;
+
+
+//----------------------------------------------------------------------
+//	a listener for an address range [firstAddress .. lastAddress]
+//	if pAddressSet is not NULL, then bit (address - 1) of this bitmap
+//	must be set, too
+//
+typedef struct loconet_consumer_listener
+{
+	loconet_consumer_func_listener_sensor	pSensorFunc;
+	loconet_consumer_func_listener_switch	pSwitchFunc;
+	void									*pContext;
+	const uint32_t							*pAddressSet;
+	uint16_t								firstAddress;
+	uint16_t								lastAddress;
+	uint16_t								generation;	//	part of the handle, counts the adds
+
+} loconet_consumer_listener_t;
+
+
+//----------------------------------------------------------------------
+//	the listener interval index
+//	the address space is split into segments at the borders of all
+//	listener ranges. For every segment a bit mask shows the listeners
+//	that cover the whole segment, so a dispatch will only visit
+//	matching listeners.
+//
+typedef struct loconet_consumer_listener_index
+{
+	loconet_consumer_listener_t	listeners[ LOCONET_CONSUMER_MAX_LISTENERS ];
+	uint32_t					usedMask;
+
+	uint16_t					segmentStart[ LOCONET_CONSUMER_MAX_SEGMENTS ];
+	uint32_t					segmentMask[ LOCONET_CONSUMER_MAX_SEGMENTS ];
+	uint8_t						numSegments;
+
+} loconet_consumer_listener_index_t;
+
+
+//----------------------------------------------------------------------
+//	a hold-off time for the sensor addresses [firstAddress .. lastAddress]
+//
+typedef struct loconet_debounce_range
+{
+	uint16_t	firstAddress;
+	uint16_t	lastAddress;
+	uint16_t	holdOffMs;
+
+} loconet_debounce_range_t;
+
+
+//----------------------------------------------------------------------
+//	the debounce state of one sensor
+//	'next' and 'prev' link the sensor into the timer wheel 'slot'
+//	while a new state is pending
+//
+typedef struct loconet_debounce_sensor
+{
+	uint16_t	next;
+	uint16_t	prev;
+	uint16_t	flapCount;
+	uint8_t		slot;
+	uint8_t		rounds;
+	uint8_t		flags;
+
+} loconet_debounce_sensor_t;
+
+
+//----------------------------------------------------------------------
+//	the debounce structure
+//	a sensor state will only be reported after it was stable for the
+//	hold-off time of its address. Bounces back to the reported state
+//	within the hold-off time are counted as flaps.
+//	All pending sensors share one timer wheel.
+//
+typedef struct loconet_sensor_debounce
+{
+	loconet_debounce_sensor_t	sensors[ LOCONET_DEBOUNCE_MAX_SENSORS ];
+	uint16_t					wheel[ LOCONET_DEBOUNCE_WHEEL_SLOTS ];
+	uint32_t					currentTick;
+	uint64_t					lastTickTime;
+
+	loconet_debounce_range_t	ranges[ LOCONET_DEBOUNCE_MAX_RANGES ];
+	uint8_t						numRanges;
+	uint16_t					defaultHoldOffMs;
+
+	uint32_t					cntFlaps;
+	uint32_t					cntReports;
+
+} loconet_sensor_debounce_t;
+
+
 //----------------------------------------------------------------------
 //	the bus structure
 //
@@ -81,6 +202,9 @@ typedef struct loconet_consumer_switch_sensor
 	loconet_consumer_func_notify_switch		pNotifySwitchOutputs;
 	loconet_consumer_func_notify_switch		pNotifySwitchState;
 
+	loconet_consumer_listener_index_t		listenerIndex[ NOTIFY_FUNC_IDX_MAX ];
+	loconet_sensor_debounce_t				*pDebounce;
+
 } loconet_consumer_switch_sensor_t;
 
 
@@ -98,6 +222,34 @@ extern uint8_t	loconet_consumer_register_notify_switch_report(  loconet_consumer
 extern uint8_t	loconet_consumer_register_notify_switch_outputs( loconet_consumer_switch_sensor_t *pConsumer, loconet_consumer_func_notify_switch pFunc );
 extern uint8_t	loconet_consumer_register_notify_switch_state(   loconet_consumer_switch_sensor_t *pConsumer, loconet_consumer_func_notify_switch pFunc );
 
+extern uint8_t	loconet_consumer_add_listener_sensor(	loconet_consumer_switch_sensor_t		*pConsumer,
+														uint16_t								firstAddress,
+														uint16_t								lastAddress,
+														const uint32_t							*pAddressSet,
+														loconet_consumer_func_listener_sensor	pFunc,
+														void									*pContext,
+														loconet_consumer_listener_handle_t		*pHandle		);
+extern uint8_t	loconet_consumer_add_listener_switch(	loconet_consumer_switch_sensor_t		*pConsumer,
+														uint8_t									funcIdx,
+														uint16_t								firstAddress,
+														uint16_t								lastAddress,
+														const uint32_t							*pAddressSet,
+														loconet_consumer_func_listener_switch	pFunc,
+														void									*pContext,
+														loconet_consumer_listener_handle_t		*pHandle		);
+extern uint8_t	loconet_consumer_remove_listener( loconet_consumer_switch_sensor_t *pConsumer, loconet_consumer_listener_handle_t handle );
+
+extern void		loconet_consumer_debounce_init( loconet_sensor_debounce_t *pDebounce, uint16_t defaultHoldOffMs );
+extern uint8_t	loconet_consumer_debounce_add_range( loconet_sensor_debounce_t *pDebounce, uint16_t firstAddress, uint16_t lastAddress, uint16_t holdOffMs );
+extern uint16_t	loconet_consumer_debounce_get_flaps( loconet_sensor_debounce_t *pDebounce, uint16_t address );
+extern void		loconet_consumer_set_debounce( loconet_consumer_switch_sensor_t *pConsumer, loconet_sensor_debounce_t *pDebounce );
+
+//--------------------------------------------------------------------------
+//	if debouncing is used, this function should be called in a
+//	periodical manner (at least every LOCONET_DEBOUNCE_TICK_MS)
+//	to report the sensors that became stable
+extern void loconet_consumer_switch_sensor_tick( loconet_consumer_switch_sensor_t *pConsumer );
+
 //--------------------------------------------------------------------------
 //	this is the function that must be registered at the "bus"
 //	to be able to consume (handle) switch and sensor loconet messages
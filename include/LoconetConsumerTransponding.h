@@ -0,0 +1,132 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetConsumerTransponding.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library decode transponding
+//#	messages (OPC_MULTI_SENSE) and keep an index of which loco is in
+//#	which zone and which locos are in a zone.
+//#	Updates and lookups are O(1).
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "ln_opc.h"
+#include "LoconetBus.h"
+#include "LoconetAddrIndex.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+//	zones are numbered 1 .. 4096 (see OPC_MULTI_SENSE_BOARD_ADDRESS)
+#define LOCONET_TRANSPONDING_MAX_ZONES		4096
+
+//	max number of locos that can be located at the same time, < 255
+#define LOCONET_TRANSPONDING_MAX_LOCOS		128
+
+#define LOCONET_TRANSPONDING_NO_ENTRY		0xFF
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+//----------------------------------------------------------------------
+//	notify function definition
+//	will be called if a loco enters (present) or leaves a zone
+//
+typedef void (*loconet_transponding_func_notify)( void *pContext, uint16_t locoAddress, uint16_t zone, bool present );
+
+
+//----------------------------------------------------------------------
+//	one located loco
+//	'next' and 'prev' link all locos of the same zone
+//
+typedef struct loconet_transponding_entry
+{
+	uint16_t	locoAddress;
+	uint16_t	zone;
+	uint32_t	time;			//	in ms
+	uint8_t		next;
+	uint8_t		prev;
+
+} loconet_transponding_entry_t;
+
+
+//----------------------------------------------------------------------
+//	the transponding structure
+//
+typedef struct loconet_consumer_transponding
+{
+	loconet_bus_t						*pBus;
+
+	loconet_transponding_entry_t		entries[ LOCONET_TRANSPONDING_MAX_LOCOS ];
+	uint8_t								freeHead;
+	uint8_t								zoneHead[ LOCONET_TRANSPONDING_MAX_ZONES ];
+	loconet_addr_index_t				locoIndex;
+
+	loconet_transponding_func_notify	pNotifyFunc;
+	void								*pNotifyContext;
+
+	uint32_t							cntPresent;
+	uint32_t							cntAbsent;
+	uint32_t							cntOverflow;
+
+} loconet_consumer_transponding_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern uint8_t loconet_consumer_transponding_init( loconet_consumer_transponding_t *pTransp, loconet_bus_t *pBus );
+
+extern uint8_t	loconet_transponding_register_notify( loconet_consumer_transponding_t *pTransp, loconet_transponding_func_notify pFunc, void *pContext );
+
+extern bool		loconet_transponding_find_loco( loconet_consumer_transponding_t *pTransp, uint16_t locoAddress, uint16_t *pZone );
+extern uint16_t	loconet_transponding_first_loco( loconet_consumer_transponding_t *pTransp, uint16_t zone );
+extern uint8_t	loconet_transponding_get_zone_locos(	loconet_consumer_transponding_t	*pTransp,
+														uint16_t						zone,
+														uint16_t						*pLocos,
+														uint8_t							maxLocos	);
+
+//--------------------------------------------------------------------------
+//	this is the function that must be registered at the "bus"
+//	to be able to consume (handle) transponding loconet messages
+extern void loconet_consumer_transponding_process( loconet_bus_consumer pConsumer, LnMsg *pMsg );
@@ -0,0 +1,232 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetDiscovery.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library find out the state of the
+//#	layout after a start: the sensors are asked with the interrogate
+//#	sequence (OPC_SW_REQ to 1017 .. 1020), the switches of an address range
+//#	with OPC_SW_STATE. The OPC_LONG_ACK replies do not tell the switch
+//#	address, so they are matched in the order of the queries.
+//#	The queries are sent in windows. The replies of a window are only
+//#	used if all of them came, because after a lost reply the following
+//#	ones would belong to the wrong address. A window grows by one after
+//#	every complete one and is halved after a timeout, then all its
+//#	queries are repeated. No window is sent while the load of the other
+//#	messages on the bus is above a limit.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "ln_opc.h"
+#include "LoconetBus.h"
+#include "LoconetConsumerStateCache.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define LOCONET_DISCOVERY_MAX_WINDOW			16
+
+#define LOCONET_DISCOVERY_DEFAULT_WINDOW		8
+#define LOCONET_DISCOVERY_DEFAULT_TIMEOUT_US	(100 * 1000)
+#define LOCONET_DISCOVERY_DEFAULT_RETRIES		2
+#define LOCONET_DISCOVERY_DEFAULT_MAX_LOAD		500			//	in 1/10 %
+
+//	the load of the other messages is measured over this time
+#define LOCONET_DISCOVERY_LOAD_PERIOD_US		(50 * 1000)
+
+//	time between the messages of the interrogate sequence
+#define LOCONET_DISCOVERY_INTERROGATE_GAP_US	(100 * 1000)
+
+//	the sensors are complete if no report came for this time
+#define LOCONET_DISCOVERY_SENSOR_QUIET_US		(500 * 1000)
+
+#define LOCONET_DISCOVERY_INTERROGATE_ADDRESS	1017
+#define LOCONET_DISCOVERY_INTERROGATE_STEPS		8
+
+#define LOCONET_DISCOVERY_MAX_SWITCHES			2048
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+//----------------------------------------------------------------------
+//	switch function definition
+//	will be called for every answered OPC_SW_STATE
+//
+typedef void (*loconet_discovery_func_switch)( void *pContext, uint16_t address, bool closed, bool output );
+
+
+//----------------------------------------------------------------------
+//	done function definition
+//	'durationUs' is the time from the start to the full state
+//
+typedef void (*loconet_discovery_func_done)( void *pContext, uint16_t cntSwitches, uint16_t cntFailed, uint32_t durationUs );
+
+
+//----------------------------------------------------------------------
+//	one outstanding or repeated OPC_SW_STATE
+//
+typedef struct loconet_discovery_query
+{
+	uint16_t	address;
+	uint8_t		retries;
+	uint8_t		ack1;			//	of the reply
+
+} loconet_discovery_query_t;
+
+
+//----------------------------------------------------------------------
+//	the discovery structure
+//
+typedef struct loconet_discovery
+{
+	loconet_bus_t					*pBus;
+	loconet_consumer_state_cache_t	*pCache;		//	may be NULL
+
+	loconet_discovery_func_switch	pSwitchFunc;
+	void							*pSwitchContext;
+	loconet_discovery_func_done		pDoneFunc;
+	void							*pDoneContext;
+
+	uint8_t							maxWindow;
+	uint8_t							maxRetries;
+	uint32_t						timeoutUs;
+	uint16_t						maxLoad;		//	in 1/10 %
+
+	//------------------------------------------------------------------
+	//	switches: 'nextAddress' is the next one that was not asked yet,
+	//	the queries of a timeout wait in 'repeat' and are sent first
+	//
+	uint16_t						nextAddress;
+	uint16_t						lastAddress;
+
+	loconet_discovery_query_t		inFlight[ LOCONET_DISCOVERY_MAX_WINDOW ];
+	uint8_t							numInFlight;
+	uint8_t							numReplies;
+	uint8_t							numStale;		//	replies of dropped queries still to come
+	uint8_t							numOnWire;		//	queries of the window seen as loopback
+	uint64_t						replyTime;		//	of the last reply or of the send
+
+	loconet_discovery_query_t		repeat[ LOCONET_DISCOVERY_MAX_WINDOW ];
+	uint8_t							numRepeat;
+
+	uint8_t							window;
+	uint64_t						drainEnd;		//	late replies are ignored until then
+	uint64_t						drainLimit;		//	end of a drain with lost stale replies
+
+	//------------------------------------------------------------------
+	//	sensors
+	//
+	uint8_t							interrogateStep;
+	uint64_t						interrogateTime;
+	uint64_t						lastSensorTime;
+
+	//------------------------------------------------------------------
+	//	bus load, bytes of the other messages in the running period
+	//
+	uint64_t						periodStart;
+	uint32_t						periodBytes;
+	uint16_t						load;			//	of the last period in 1/10 %
+
+	bool							useLoopback;
+	bool							running;
+	uint64_t						startTime;
+	uint32_t						durationUs;
+
+	uint16_t						cntSwitches;
+	uint16_t						cntFailed;
+	uint32_t						cntSensorReports;
+	uint32_t						cntQueries;
+	uint32_t						cntTimeouts;
+	uint32_t						cntLocalDrops;	//	windows with a query that was not sent
+	uint32_t						cntUnexpected;	//	replies without a query
+	uint32_t						cntForeign;		//	windows dropped for a query of another sender
+
+} loconet_discovery_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//--------------------------------------------------------------------------
+//	if 'pCache' is given the switch states are stored there
+extern uint8_t loconet_discovery_init(	loconet_discovery_t				*pDiscovery,
+										loconet_bus_t					*pBus,
+										loconet_consumer_state_cache_t	*pCache		);
+
+extern void loconet_discovery_register_notify(	loconet_discovery_t				*pDiscovery,
+												loconet_discovery_func_switch	pFunc,
+												void							*pContext	);
+
+//--------------------------------------------------------------------------
+//	with a phy on the bus that spreads the sent messages as loopback
+//	(e.g. LoconetPhyUART) the timeout of a window starts when its
+//	queries are on the loconet, and a window with a query that was not
+//	sent (e.g. the tx ring was full) is counted in 'cntLocalDrops'
+//	instead of 'cntTimeouts' and uses up no retry.
+extern void loconet_discovery_use_loopback( loconet_discovery_t *pDiscovery, bool enable );
+
+//--------------------------------------------------------------------------
+//	ask the switches 'firstAddress' .. 'firstAddress + numSwitches - 1'
+//	and, with 'interrogate', the sensors
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	discovery is running
+//		2	=>	invalid address range
+extern uint8_t	loconet_discovery_start(	loconet_discovery_t			*pDiscovery,
+											uint16_t					firstAddress,
+											uint16_t					numSwitches,
+											bool						interrogate,
+											loconet_discovery_func_done	pFunc,
+											void						*pContext		);
+extern bool		loconet_discovery_is_running( loconet_discovery_t *pDiscovery );
+
+//--------------------------------------------------------------------------
+//	this function should be called in a periodical manner (every ms)
+//	by the task that broadcasts on the bus, to send new queries and
+//	to handle timeouts
+extern void loconet_discovery_process( loconet_discovery_t *pDiscovery );
+
+//--------------------------------------------------------------------------
+//	this is the function that must be registered at the "bus"
+//	to be able to consume (handle) the replies
+extern void loconet_discovery_receive( loconet_bus_consumer pConsumer, LnMsg *pMsg );
@@ -0,0 +1,170 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetLbServer.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library connect TCP clients
+//#	(e.g. JMRI or Rocrail) with the LbServer protocol to the bus:
+//#		client	=>	SEND <hex bytes>
+//#		server	=>	SENT OK | SENT ERROR <reason>
+//#		server	=>	RECEIVE <hex bytes>		(every message of the bus)
+//#		server	=>	VERSION <text>			(after connecting)
+//#	The sockets are non-blocking. The lines for a client are collected
+//#	in a bounded buffer that is written with one send() per call of
+//#	loconet_lbserver_process(). A client that can not keep up is
+//#	disconnected, so the bus never waits for the network.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "ln_opc.h"
+#include "LoconetBus.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define LOCONET_LBSERVER_DEFAULT_PORT		1234
+
+#ifndef LOCONET_LBSERVER_MAX_CLIENTS
+	#define LOCONET_LBSERVER_MAX_CLIENTS	4
+#endif
+
+//	output buffer per client, a client is dropped if it is full
+#ifndef LOCONET_LBSERVER_TX_BUF_SIZE
+	#define LOCONET_LBSERVER_TX_BUF_SIZE	4096
+#endif
+
+#define LOCONET_LBSERVER_RX_BUF_SIZE		256
+
+//	SEND commands waiting for the loopback (see loconet_lbserver_use_loopback)
+#ifndef LOCONET_LBSERVER_MAX_PENDING
+	#define LOCONET_LBSERVER_MAX_PENDING	16
+#endif
+
+//	a SEND without loopback after this time was not sent
+#define LOCONET_LBSERVER_SEND_TIMEOUT_US	(1000 * 1000)
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+typedef struct loconet_lbserver_client
+{
+	int			fd;							//	-1 => not connected
+
+	char		rxBuf[ LOCONET_LBSERVER_RX_BUF_SIZE ];
+	uint16_t	rxLen;
+
+	char		txBuf[ LOCONET_LBSERVER_TX_BUF_SIZE ];
+	uint16_t	txLen;
+
+} loconet_lbserver_client_t;
+
+
+//----------------------------------------------------------------------
+//	a SEND command that waits for its loopback
+//
+typedef struct loconet_lbserver_pending
+{
+	LnMsg		msg;
+	uint64_t	time;							//	of the SEND command
+	uint8_t		client;							//	LOCONET_LBSERVER_MAX_CLIENTS => gone
+
+} loconet_lbserver_pending_t;
+
+
+//----------------------------------------------------------------------
+//	the server structure
+//
+typedef struct loconet_lbserver
+{
+	loconet_bus_t				*pBus;
+	int							listenFd;
+
+	loconet_lbserver_client_t	clients[ LOCONET_LBSERVER_MAX_CLIENTS ];
+
+	bool						useLoopback;
+	loconet_lbserver_pending_t	pending[ LOCONET_LBSERVER_MAX_PENDING ];	//	oldest first
+	uint8_t						numPending;
+
+	uint32_t					cntConnects;
+	uint32_t					cntDropped;		//	slow clients
+	uint32_t					cntSent;		//	messages from clients
+	uint32_t					cntErrors;		//	bad SEND lines
+	uint32_t					cntFailed;		//	SENDs that did not reach the loconet
+
+} loconet_lbserver_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//--------------------------------------------------------------------------
+//	return values:
+//		0	=>	okay
+//		1	=>	socket could not be created
+//		2	=>	bind failed (port in use?)
+//		3	=>	listen failed
+//		4	=>	no free consumer entry on the bus
+extern uint8_t	loconet_lbserver_init( loconet_lbserver_t *pServer, loconet_bus_t *pBus, uint16_t port );
+extern void		loconet_lbserver_close( loconet_lbserver_t *pServer );
+
+extern uint8_t	loconet_lbserver_num_clients( loconet_lbserver_t *pServer );
+
+//--------------------------------------------------------------------------
+//	with a phy on the bus that spreads the sent messages as loopback
+//	(e.g. LoconetPhyUART) a SEND is answered with "SENT OK" and echoed
+//	to the clients when the message is on the loconet. If it is not
+//	there after LOCONET_LBSERVER_SEND_TIMEOUT_US (dropped or collisions)
+//	the answer is "SENT ERROR". Without, a SEND is answered and echoed
+//	when it is spread on the bus.
+extern void		loconet_lbserver_use_loopback( loconet_lbserver_t *pServer, bool enable );
+
+//--------------------------------------------------------------------------
+//	this function should be called in a periodical manner by the task
+//	that broadcasts on the bus. It accepts new clients, reads their
+//	commands and writes the collected lines.
+extern void		loconet_lbserver_process( loconet_lbserver_t *pServer );
+
+//--------------------------------------------------------------------------
+//	this is the function that must be registered at the "bus"
+//	to be able to forward the loconet messages to the clients
+extern void		loconet_lbserver_send( loconet_bus_consumer pConsumer, LnMsg *pMsg );
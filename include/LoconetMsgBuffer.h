@@ -78,3 +78,7 @@ typedef struct loconet_msg_buffer
 extern void loconet_msg_buffer_init( loconet_msg_buffer_t *pBuffer );
 
 extern lnMsg *loconet_msg_buffer_add_byte( loconet_msg_buffer_t *pBuffer, uint8_t newByte );
+
+//--------------------------------------------------------------------------
+//	calculate and set the check sum of a message that should be sent
+extern void loconet_msg_set_checksum( lnMsg *pMsg );
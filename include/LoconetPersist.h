@@ -0,0 +1,182 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetPersist.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library save the state of the
+//#	sensors, switches (LoconetConsumerStateCache) and slots
+//#	(LoconetConsumerSlotTable) as a versioned binary image and restore
+//#	it after a restart, so the state is known before the devices
+//#	report again.
+//#	The image is divided into pages with an own CRC, a checkpoint only
+//#	writes the pages that changed since the last one. The storage is a
+//#	backend with read and write functions (e.g. flash or NVS), a file
+//#	backend is part of the library on Linux.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "LoconetConsumerStateCache.h"
+#include "LoconetConsumerSlotTable.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define LOCONET_PERSIST_MAGIC				"LNPS"
+#define LOCONET_PERSIST_VERSION				1
+
+#ifndef LOCONET_PERSIST_PAGE_SIZE
+	#define LOCONET_PERSIST_PAGE_SIZE		256
+#endif
+
+//	bytes of the state in the image
+#define LOCONET_PERSIST_SLOT_SIZE			12
+#define LOCONET_PERSIST_BITMAP_BYTES		(4 * (		(2 * LN_STATE_BITMAP_WORDS( LOCONET_STATE_CACHE_MAX_SENSORS ))	\
+													+	(3 * LN_STATE_BITMAP_WORDS( LOCONET_STATE_CACHE_MAX_SWITCHES ))	))
+#define LOCONET_PERSIST_DATA_SIZE			(LOCONET_PERSIST_BITMAP_BYTES + (LOCONET_SLOT_TABLE_SIZE * LOCONET_PERSIST_SLOT_SIZE))
+
+#define LOCONET_PERSIST_NUM_PAGES			((LOCONET_PERSIST_DATA_SIZE + LOCONET_PERSIST_PAGE_SIZE - 1) / LOCONET_PERSIST_PAGE_SIZE)
+
+//	layout in the storage:
+//		header					LOCONET_PERSIST_HEADER_SIZE
+//		page 0 .. N-1			LOCONET_PERSIST_PAGE_SIZE + 8 (index, crc)
+#define LOCONET_PERSIST_HEADER_SIZE			20
+#define LOCONET_PERSIST_PAGE_RECORD_SIZE	(LOCONET_PERSIST_PAGE_SIZE + 8)
+#define LOCONET_PERSIST_IMAGE_SIZE			(LOCONET_PERSIST_HEADER_SIZE + (LOCONET_PERSIST_NUM_PAGES * LOCONET_PERSIST_PAGE_RECORD_SIZE))
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+//----------------------------------------------------------------------
+//	the storage functions, 'offset' is the position in the image.
+//	They return 0 if okay. 'pSync' may be NULL, it is called after
+//	all pages of a checkpoint are written.
+//
+typedef uint8_t (*loconet_persist_func_read)( void *pContext, uint32_t offset, void *pData, uint32_t length );
+typedef uint8_t (*loconet_persist_func_write)( void *pContext, uint32_t offset, const void *pData, uint32_t length );
+typedef uint8_t (*loconet_persist_func_sync)( void *pContext );
+
+typedef struct loconet_persist_backend
+{
+	loconet_persist_func_read	pRead;
+	loconet_persist_func_write	pWrite;
+	loconet_persist_func_sync	pSync;
+	void						*pContext;
+
+} loconet_persist_backend_t;
+
+
+//----------------------------------------------------------------------
+//	the persistence structure
+//
+typedef struct loconet_persist
+{
+	loconet_consumer_state_cache_t	*pCache;
+	loconet_consumer_slot_table_t	*pTable;
+	loconet_persist_backend_t		backend;
+
+	loconet_state_snapshot_t		snapshot;
+	uint8_t							image[ LOCONET_PERSIST_NUM_PAGES * LOCONET_PERSIST_PAGE_SIZE ];
+	uint8_t							stored[ LOCONET_PERSIST_NUM_PAGES * LOCONET_PERSIST_PAGE_SIZE ];
+	bool							pageValid[ LOCONET_PERSIST_NUM_PAGES ];	//	'stored' is in the storage
+	bool							headerValid;
+
+	uint32_t						lastGeneration;		//	of the state cache
+	bool							slotsChanged;
+
+	uint32_t						cntCheckpoints;
+	uint32_t						cntPagesWritten;
+	uint32_t						cntErrors;
+
+} loconet_persist_t;
+
+
+#ifdef __linux__
+//----------------------------------------------------------------------
+//	file backend
+//
+typedef struct loconet_persist_file
+{
+	int		fd;
+
+} loconet_persist_file_t;
+#endif
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//--------------------------------------------------------------------------
+//	must be called after the init of the state cache and the slot table
+extern void		loconet_persist_init(	loconet_persist_t					*pPersist,
+										loconet_consumer_state_cache_t		*pCache,
+										loconet_consumer_slot_table_t		*pTable,
+										const loconet_persist_backend_t		*pBackend	);
+
+//--------------------------------------------------------------------------
+//	restore the state from the storage, normally directly after the init.
+//	Broken pages are skipped and written with the next checkpoint.
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	no image in the storage or read error
+//		2	=>	image of another version or layout
+//		3	=>	some pages are broken, the others are restored
+extern uint8_t	loconet_persist_restore( loconet_persist_t *pPersist );
+
+//--------------------------------------------------------------------------
+//	should be called in a periodical manner (e.g. every 10 s) by the
+//	task that broadcasts on the bus. Only the changed pages are written.
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	write error
+extern uint8_t	loconet_persist_checkpoint( loconet_persist_t *pPersist );
+
+#ifdef __linux__
+//--------------------------------------------------------------------------
+//	opens (or creates) the file and fills 'pBackend',
+//	returns 0 if okay
+extern uint8_t	loconet_persist_file_open(	loconet_persist_file_t		*pFile,
+											const char					*pPath,
+											loconet_persist_backend_t	*pBackend	);
+extern void		loconet_persist_file_close( loconet_persist_file_t *pFile );
+#endif
@@ -0,0 +1,169 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetPhyLocoBuffer.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library connect the bus to a
+//#	serial stream with the LocoBuffer / PR3 protocol: the raw loconet
+//#	messages in both directions, 57600 baud or faster.
+//#	With 'echo' the phy behaves like a LocoBuffer, so a PC (e.g. JMRI)
+//#	can use the device as loconet interface: every message of the PC
+//#	is sent back to it. Without 'echo' the phy talks to a real
+//#	LocoBuffer, that sends the echo itself.
+//#	Received bytes are read in blocks, messages for the stream are
+//#	collected and written with one write() per call of
+//#	loconet_phy_locobuffer_process().
+//#	On Linux a pty can be used instead of a serial port.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ln_opc.h"
+#include "LoconetBus.h"
+#include "LoconetMsgBuffer.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define LOCONET_LOCOBUFFER_DEFAULT_BAUD		57600
+
+//	bytes read with one read()
+#ifndef LOCONET_LOCOBUFFER_RX_BLOCK_SIZE
+	#define LOCONET_LOCOBUFFER_RX_BLOCK_SIZE	256
+#endif
+
+//	messages that can not be written immediately wait here,
+//	if it is full new messages are dropped
+#ifndef LOCONET_LOCOBUFFER_TX_BUF_SIZE
+	#define LOCONET_LOCOBUFFER_TX_BUF_SIZE		2048
+#endif
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+typedef struct loconet_phy_locobuffer
+{
+	loconet_bus_t			*pBus;
+	int						fd;
+	bool					echo;
+	bool					useLoopback;		//	echo when the msg is on the loconet
+
+	loconet_msg_buffer_t	rxMsg;
+	uint8_t					rxBlock[ LOCONET_LOCOBUFFER_RX_BLOCK_SIZE ];
+
+	uint8_t					txBuf[ LOCONET_LOCOBUFFER_TX_BUF_SIZE ];
+	uint16_t				txLen;
+
+	LnRxStats				rxStats;
+	LnTxStats				txStats;
+	uint32_t				cntTxDropped;
+
+} loconet_phy_locobuffer_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//--------------------------------------------------------------------------
+//	use an already opened stream (e.g. USB-CDC)
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	no free consumer entry on the bus
+extern uint8_t	loconet_phy_locobuffer_init(	loconet_phy_locobuffer_t	*pPhy,
+												loconet_bus_t				*pBus,
+												int							fd,
+												bool						echo	);
+
+//--------------------------------------------------------------------------
+//	open a serial port, if it is a tty it is set to raw mode
+//	with 8N1 and 'baud'.
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	could not open 'pPath'
+//		2	=>	baud rate not supported or port configuration failed
+//		3	=>	no free consumer entry on the bus
+extern uint8_t	loconet_phy_locobuffer_open(	loconet_phy_locobuffer_t	*pPhy,
+												loconet_bus_t				*pBus,
+												const char					*pPath,
+												uint32_t					baud,
+												bool						echo	);
+
+#ifdef __linux__
+//--------------------------------------------------------------------------
+//	create a pty, the name of the slave side (e.g. /dev/pts/3) is
+//	copied into 'pSlaveName', a PC program can open it like a
+//	serial port.
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	could not create the pty
+//		3	=>	no free consumer entry on the bus
+extern uint8_t	loconet_phy_locobuffer_open_pty(	loconet_phy_locobuffer_t	*pPhy,
+													loconet_bus_t				*pBus,
+													char						*pSlaveName,
+													size_t						nameSize,
+													bool						echo	);
+#endif
+
+extern void		loconet_phy_locobuffer_close( loconet_phy_locobuffer_t *pPhy );
+
+//--------------------------------------------------------------------------
+//	with 'echo' and a phy on the bus that spreads the sent messages as
+//	loopback (e.g. LoconetPhyUART) a message of the PC is sent back when
+//	it is on the loconet, like a real LocoBuffer does. A message that
+//	is dropped or fails gets no echo. Without, the echo is sent when
+//	the message is spread on the bus.
+extern void		loconet_phy_locobuffer_use_loopback( loconet_phy_locobuffer_t *pPhy, bool enable );
+
+//--------------------------------------------------------------------------
+//	this function should be called in a periodical manner by the task
+//	that broadcasts on the bus, it reads all received bytes and
+//	writes the collected messages.
+extern void		loconet_phy_locobuffer_process( loconet_phy_locobuffer_t *pPhy );
+
+//--------------------------------------------------------------------------
+//	this is the function that must be registered at the "bus"
+//	to be able to send loconet messages to the stream
+extern void		loconet_phy_locobuffer_send( loconet_bus_consumer pConsumer, LnMsg *pMsg );
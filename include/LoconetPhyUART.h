@@ -39,6 +39,7 @@
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -48,6 +49,8 @@
 #include "ln_opc.h"
 #include "LoconetBus.h"
 #include "LoconetMsgBuffer.h"
+#include "LoconetRing.h"
+#include "LoconetTxRing.h"
 
 
 //==========================================================================
@@ -56,6 +59,35 @@
 //
 //==========================================================================
 
+#define LOCONET_PHY_MAX_SAFETY_HANDLERS		4
+
+//	stack of the rx/tx task, the safety handlers run on it too
+#ifndef LOCONET_PHY_TASK_STACK_SIZE
+	#define LOCONET_PHY_TASK_STACK_SIZE		4096
+#endif
+
+//	stack of the dispatch task, the consumers run on it in pipeline mode
+#ifndef LOCONET_PHY_DISPATCH_STACK_SIZE
+	#define LOCONET_PHY_DISPATCH_STACK_SIZE	4096
+#endif
+
+//	pipeline mode: rx ring between the rx/tx task and the
+//	dispatch task, must be a power of two
+#ifndef LOCONET_PHY_RX_RING_SIZE
+	#define LOCONET_PHY_RX_RING_SIZE		64
+#endif
+
+#define LOCONET_PHY_WIRE_CORE				0
+#define LOCONET_PHY_DISPATCH_CORE			1
+
+//	flags of an rx entry
+#define LOCONET_PHY_RX_OWN					0x01	//	sent by us, the echo was okay
+
+//	messages sent with loconet_phy_uart_send_tracked() at the same time
+#define LOCONET_PHY_MAX_TX_TRACK			16
+
+#define LOCONET_PHY_TX_HANDLE_NONE			0
+
 
 //==========================================================================
 //
@@ -75,14 +107,95 @@ typedef enum
 } ln_tx_rx_status_t;
 
 
+//----------------------------------------------------------------------
+//	safety handler function definition
+//	will be called directly from the rx/tx task for every received
+//	safety message (see loconet_bus_is_safety_msg), so it must be short.
+//	It runs on the stack of the rx/tx task: with the default
+//	LOCONET_PHY_TASK_STACK_SIZE a handler may use up to 2 kB, no
+//	printf and no large local buffers. A handler that needs more must
+//	raise LOCONET_PHY_TASK_STACK_SIZE.
+//
+typedef void (*loconet_phy_uart_func_safety)( void *pContext, LnMsg *pMsg );
+
+
+//----------------------------------------------------------------------
+//	the result of a tracked message
+//
+typedef enum
+{
+	LN_TX_DONE_OK			= 0,
+	LN_TX_DONE_DROPPED,					//	not queued (see loconet_tx_status_t)
+	LN_TX_DONE_FAILED					//	all tries ended with a collision
+
+} loconet_tx_done_t;
+
+
+typedef uint32_t	loconet_phy_tx_handle_t;
+
+
+//----------------------------------------------------------------------
+//	given to the completion function, the times are in us
+//	(esp_timer_get_time), 'timeFirstTry' is 0 for a dropped message
+//
+typedef struct loconet_phy_tx_completion
+{
+	loconet_phy_tx_handle_t	handle;
+	loconet_tx_done_t		status;
+	uint8_t					cntRetries;			//	collisions before the end
+	uint64_t				timeQueued;
+	uint64_t				timeFirstTry;
+	uint64_t				timeDone;			//	end of the message on the wire
+
+} loconet_phy_tx_completion_t;
+
+
+//----------------------------------------------------------------------
+//	completion function definition
+//	will be called from loconet_phy_uart_process() (from the dispatch
+//	task in pipeline mode)
+//
+typedef void (*loconet_phy_uart_func_tx_done)( void *pContext, const loconet_phy_tx_completion_t *pCompletion );
+
+
+//----------------------------------------------------------------------
+//	an entry of the table of tracked messages
+//	'state' hands the entry over between the sender, the rx/tx task
+//	and the dispatching
+//
+typedef struct loconet_phy_tx_track
+{
+	atomic_uchar					state;
+	loconet_phy_uart_func_tx_done	pFunc;
+	void							*pContext;
+	loconet_phy_tx_completion_t		completion;
+
+} loconet_phy_tx_track_t;
+
+
+//----------------------------------------------------------------------
+//	an entry of the rx queue (rx ring in pipeline mode).
+//	An own message is spread as loopback (see loconet_bus_loopback)
+//	to the consumers that opted in, with 'pSender' as the sender.
+//
+typedef struct loconet_phy_rx_entry
+{
+	LnMsg						msg;
+	loconet_bus_consumer_func	pSender;		//	own messages only
+	uint8_t						flags;
+
+} loconet_phy_rx_entry_t;
+
+
 //----------------------------------------------------------------------
 //	the loconet physical handler structure
 //
 typedef struct loconet_phy_uart
 {
 	TaskHandle_t			rxtxTask;
+	TaskHandle_t			dispatchTask;
 	QueueHandle_t			rxQueue;
-	QueueHandle_t			txQueue;
+	QueueHandle_t			txPrioQueue;
 
 	loconet_bus_t			*pBus;
 	uart_port_t				uartNum;
@@ -90,18 +203,52 @@ typedef struct loconet_phy_uart
 	uint8_t					txPin;
 	bool					invertRx;
 	bool					invertTx;
+	bool					pipeline;			//	dispatch from an own task
 	uint8_t					cntTry;
 	
 	loconet_msg_buffer_t	rxMsg;
 	LnMsg 					txMsg;
+	const void				*pTxSender;			//	producer of txMsg
+	uint8_t					txTag;				//	index + 1 in txTrack, 0 => none
 	ln_tx_rx_status_t		state;
 	uint64_t				cdBackoffStart;
 	uint64_t				cdBackoffTimeout;
 	uint64_t				collisionTimeout;
 
+	LnMsg					txDeferred;			//	msg preempted by a safety msg
+	uint8_t					cntTryDeferred;
+	const void				*pTxSenderDeferred;
+	uint8_t					txTagDeferred;
+
+	bool					rxResync;			//	skip bytes until the next opcode
+	uint32_t				cntEchoDiscarded;	//	bytes skipped after a collision
+
+	loconet_phy_uart_func_safety	pSafetyFunc[ LOCONET_PHY_MAX_SAFETY_HANDLERS ];
+	void					*pSafetyContext[ LOCONET_PHY_MAX_SAFETY_HANDLERS ];
+	uint8_t					numSafetyHandlers;
+	uint64_t				rxStartTime;
+	uint32_t				safetyLatencyLast;	//	in us, first byte => handlers done
+	uint32_t				safetyLatencyMax;
+	uint32_t				cntSafetyRx;
+
 	uint32_t				cntCollisionError;
 	uint32_t				cntRetryError;
 
+	LnRxStats				rxStats;
+	LnTxStats				txStats;
+
+	loconet_tx_ring_t		txRing;
+
+	loconet_phy_tx_track_t	txTrack[ LOCONET_PHY_MAX_TX_TRACK ];
+	atomic_uint				txHandleSeq;
+	uint32_t				txLatencyLast;		//	in us, queued => done, tracked only
+	uint32_t				txLatencyMax;
+	uint32_t				cntTrackFull;
+
+	loconet_ring_t			rxRing;				//	pipeline mode only
+	uint32_t				cntRxRingFull;
+	uint32_t				cntRxQueueFull;		//	without pipeline mode
+
 } loconet_phy_uart_t;
 
 
@@ -111,7 +258,33 @@ typedef struct loconet_phy_uart
 //
 //==========================================================================
 
+//--------------------------------------------------------------------------
+//	with 'pipeline' set the received messages are spread over the bus
+//	by an own task on the other core (LOCONET_PHY_DISPATCH_CORE), so
+//	the rx/tx task only handles the bytes and the timing.
+//	loconet_phy_uart_process() must not be called then.
+//	The consumers and the completion functions run in the dispatch
+//	task, other tasks must hold the bus lock (loconet_bus_lock) when
+//	they call functions of the consumers.
 extern void loconet_phy_uart_init( loconet_phy_uart_t *pUart );
 
+extern uint8_t loconet_phy_uart_register_safety( loconet_phy_uart_t *pUart, loconet_phy_uart_func_safety pFunc, void *pContext );
+
 extern void loconet_phy_uart_send( loconet_bus_consumer pConsumer, LnMsg *pMsg );
+
+//--------------------------------------------------------------------------
+//	send with the result, 'pProducer' is the key for the rate limit
+//	(e.g. the own consumer function). If the message is dropped, it
+//	is tried again every tick until 'maxWait' ticks are over.
+extern loconet_tx_status_t loconet_phy_uart_send_status( loconet_phy_uart_t *pUart, const void *pProducer, LnMsg *pMsg, TickType_t maxWait );
+
+//--------------------------------------------------------------------------
+//	send a message and get its completion later, also if it is
+//	dropped. Returns LOCONET_PHY_TX_HANDLE_NONE (and 'pFunc' is not
+//	called) if LOCONET_PHY_MAX_TX_TRACK messages are still open.
+extern loconet_phy_tx_handle_t loconet_phy_uart_send_tracked(	loconet_phy_uart_t				*pUart,
+																const void						*pProducer,
+																LnMsg							*pMsg,
+																loconet_phy_uart_func_tx_done	pFunc,
+																void							*pContext	);
 extern void loconet_phy_uart_process( loconet_phy_uart_t *pUart );
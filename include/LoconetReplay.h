@@ -0,0 +1,128 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetReplay.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library read a capture file
+//#	(see LoconetCapture.h) and inject the recorded messages into the
+//#	bus, with the original timing, N times faster or as fast as possible.
+//#	On Linux the file is memory mapped, so even very large captures
+//#	are not loaded into RAM, otherwise the file is read in blocks.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "ln_opc.h"
+#include "LoconetBus.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+//	max number of messages injected by one call of loconet_replay_process()
+#define LOCONET_REPLAY_BURST			256
+
+#define LOCONET_REPLAY_BLOCK_SIZE		4096
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+typedef enum
+{
+	LN_REPLAY_REALTIME	= 0,		//	original timing
+	LN_REPLAY_SCALED,				//	'speed' times faster
+	LN_REPLAY_MAX_SPEED				//	no waiting at all
+
+} loconet_replay_mode_t;
+
+
+//----------------------------------------------------------------------
+//	the replay structure
+//
+typedef struct loconet_replay
+{
+	loconet_bus_t				*pBus;
+	loconet_bus_consumer_func	pSender;		//	will not get the messages
+
+	const uint8_t				*pData;
+	size_t						size;			//	bytes in pData
+	size_t						pos;
+#ifdef __linux__
+	int							fd;
+#else
+	FILE						*pFile;
+	uint8_t						block[ LOCONET_REPLAY_BLOCK_SIZE ];
+#endif
+
+	uint8_t						mode;			//	loconet_replay_mode_t
+	uint16_t					speed;
+
+	bool						hasNext;
+	uint64_t					nextTime;		//	capture time in us
+	uint8_t						nextSource;
+	LnMsg						nextMsg;
+
+	uint64_t					firstTime;		//	capture time of the first msg
+	uint64_t					startTime;		//	when the replay started
+
+	uint32_t					cntMessages;
+	uint32_t					cntErrors;
+
+} loconet_replay_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern uint8_t	loconet_replay_open(	loconet_replay_t			*pReplay,
+										loconet_bus_t				*pBus,
+										const char					*pPath,
+										loconet_bus_consumer_func	pSender		);
+extern void		loconet_replay_close( loconet_replay_t *pReplay );
+
+extern void		loconet_replay_set_mode( loconet_replay_t *pReplay, loconet_replay_mode_t mode, uint16_t speed );
+
+//--------------------------------------------------------------------------
+//	this function should be called in a periodical manner, it injects
+//	all messages that are due. Returns false at the end of the file.
+extern bool		loconet_replay_process( loconet_replay_t *pReplay );
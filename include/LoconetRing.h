@@ -0,0 +1,75 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetRing.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	A lock-free ring buffer for one producer and one consumer
+//#	(e.g. two tasks). The elements have a fixed size and are copied
+//#	into and out of the ring. The storage is given by the caller.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+//----------------------------------------------------------------------
+//	the ring structure
+//	'head' is only written by the producer, 'tail' only by the consumer
+//
+typedef struct loconet_ring
+{
+	uint8_t		*pStorage;
+	uint16_t	elemSize;
+	uint32_t	mask;			//	capacity - 1
+
+	atomic_uint	head;
+	atomic_uint	tail;
+
+} loconet_ring_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern uint8_t	loconet_ring_init( loconet_ring_t *pRing, void *pStorage, uint16_t elemSize, uint32_t capacity );
+
+extern bool		loconet_ring_push( loconet_ring_t *pRing, const void *pElem );
+extern bool		loconet_ring_pop( loconet_ring_t *pRing, void *pElem );
+extern uint32_t	loconet_ring_count( loconet_ring_t *pRing );
@@ -0,0 +1,171 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetRouteEngine.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library set routes, i.e. named
+//#	sequences of switch commands. The commands are sent with a pacing
+//#	time between them and can be confirmed by OPC_LONG_ACK or OPC_SW_REP.
+//#	Several routes can run at the same time.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "ln_opc.h"
+#include "LoconetBus.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define LOCONET_ROUTE_MAX_RUNS				4
+
+#define LOCONET_ROUTE_DEFAULT_PACING_US		(30 * 1000)
+#define LOCONET_ROUTE_DEFAULT_TIMEOUT_US	(250 * 1000)
+#define LOCONET_ROUTE_DEFAULT_RETRIES		2
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+typedef enum
+{
+	LN_ROUTE_CONFIRM_NONE	= 0,	//	pacing only
+	LN_ROUTE_CONFIRM_ACK,			//	send OPC_SW_ACK, wait for OPC_LONG_ACK
+	LN_ROUTE_CONFIRM_REPORT			//	send OPC_SW_REQ, wait for OPC_SW_REP
+
+} loconet_route_confirm_t;
+
+
+//----------------------------------------------------------------------
+//	one switch command of a route
+//
+typedef struct loconet_route_entry
+{
+	uint16_t	address;
+	bool		closed;
+
+} loconet_route_entry_t;
+
+
+//----------------------------------------------------------------------
+//	a route, the entries will be set in the given order
+//
+typedef struct loconet_route
+{
+	const char					*pName;
+	const loconet_route_entry_t	*pEntries;
+	uint8_t						numEntries;
+
+} loconet_route_t;
+
+
+//----------------------------------------------------------------------
+//	done function definition
+//	'success' is false if at least one command was not confirmed
+//
+typedef void (*loconet_route_func_done)( void *pContext, const loconet_route_t *pRoute, bool success, uint32_t durationUs );
+
+
+//----------------------------------------------------------------------
+//	a running route
+//
+typedef struct loconet_route_run
+{
+	const loconet_route_t		*pRoute;
+	loconet_route_func_done		pDoneFunc;
+	void						*pDoneContext;
+	uint64_t					startTime;
+	uint8_t						nextEntry;
+	uint8_t						cntFailed;
+	bool						active;
+
+} loconet_route_run_t;
+
+
+//----------------------------------------------------------------------
+//	the route engine structure
+//	only one command is outstanding at a time, because an
+//	OPC_LONG_ACK does not tell the switch address
+//
+typedef struct loconet_route_engine
+{
+	loconet_bus_t			*pBus;
+	loconet_route_run_t		runs[ LOCONET_ROUTE_MAX_RUNS ];
+	uint8_t					nextRun;
+
+	uint32_t				pacingUs;
+	uint32_t				timeoutUs;
+	uint8_t					maxRetries;
+	uint8_t					confirmMode;		//	loconet_route_confirm_t
+
+	bool					waiting;
+	uint8_t					waitRun;
+	uint8_t					retries;
+	uint64_t				sendTime;
+
+	uint32_t				cntCommands;
+	uint32_t				cntRetries;
+	uint32_t				cntFailed;
+	uint32_t				lastDurationUs;
+
+} loconet_route_engine_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern uint8_t loconet_route_engine_init( loconet_route_engine_t *pEngine, loconet_bus_t *pBus );
+
+extern uint8_t	loconet_route_engine_start(	loconet_route_engine_t	*pEngine,
+											const loconet_route_t	*pRoute,
+											loconet_route_func_done	pFunc,
+											void					*pContext	);
+extern bool		loconet_route_engine_is_running( loconet_route_engine_t *pEngine, const loconet_route_t *pRoute );
+
+//--------------------------------------------------------------------------
+//	this function should be called in a periodical manner
+//	to send the route commands
+extern void loconet_route_engine_process( loconet_route_engine_t *pEngine );
+
+//--------------------------------------------------------------------------
+//	this is the function that must be registered at the "bus"
+//	to be able to consume (handle) the confirmations
+extern void loconet_route_engine_receive( loconet_bus_consumer pConsumer, LnMsg *pMsg );
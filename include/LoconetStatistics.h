@@ -0,0 +1,200 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetStatistics.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library collect traffic
+//#	statistics: frames and bytes per opcode, the addresses with the
+//#	most traffic (sensors, switches, slots) and the bus utilization,
+//#	collisions and tx errors in 1 s, 10 s and 60 s windows.
+//#	Every update is O(1), a consistent snapshot can be taken from
+//#	any task.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "ln_opc.h"
+#include "LoconetBus.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+//	number of addresses per category in the top list
+#define LOCONET_STATS_TOP_K				8
+
+//	one bucket per second, one more than the longest window,
+//	because the current second is not complete
+#define LOCONET_STATS_NUM_BUCKETS		61
+
+//	wire time of one byte: 10 bits with 60 us each
+#define LOCONET_STATS_BYTE_TIME_US		(10 * 60)
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+typedef enum
+{
+	LN_STATS_SENSOR	= 0,
+	LN_STATS_SWITCH,
+	LN_STATS_SLOT,
+	LN_STATS_NUM_CATEGORIES
+
+} loconet_stats_category_t;
+
+
+typedef enum
+{
+	LN_STATS_WINDOW_1S	= 0,
+	LN_STATS_WINDOW_10S,
+	LN_STATS_WINDOW_60S,
+	LN_STATS_NUM_WINDOWS
+
+} loconet_stats_window_idx_t;
+
+
+//----------------------------------------------------------------------
+//	top list of one category (Space-Saving algorithm):
+//	'count' may be too high by at most 'error'
+//
+typedef struct loconet_stats_talker
+{
+	uint16_t	address;
+	uint32_t	count;
+	uint32_t	error;
+
+} loconet_stats_talker_t;
+
+
+typedef struct loconet_stats_top
+{
+	loconet_stats_talker_t	entries[ LOCONET_STATS_TOP_K ];
+	uint8_t					numEntries;
+
+} loconet_stats_top_t;
+
+
+//----------------------------------------------------------------------
+//	the counters of one second
+//
+typedef struct loconet_stats_bucket
+{
+	uint32_t	second;
+	uint32_t	frames;
+	uint32_t	bytes;
+	uint32_t	txPackets;
+	uint32_t	txErrors;
+	uint32_t	collisions;
+
+} loconet_stats_bucket_t;
+
+
+//----------------------------------------------------------------------
+//	the sums of one window
+//
+typedef struct loconet_stats_window
+{
+	uint32_t	frames;
+	uint32_t	bytes;
+	uint32_t	txPackets;
+	uint32_t	txErrors;
+	uint32_t	collisions;
+	uint16_t	utilization;		//	wire time in 1/10 %
+
+} loconet_stats_window_t;
+
+
+//----------------------------------------------------------------------
+//	a snapshot of all statistics
+//
+typedef struct loconet_stats_snapshot
+{
+	uint32_t				opcodeFrames[ 128 ];	//	index: opcode & 0x7F
+	uint32_t				opcodeBytes[ 128 ];
+	uint64_t				totalFrames;
+	uint64_t				totalBytes;
+
+	loconet_stats_top_t		top[ LN_STATS_NUM_CATEGORIES ];
+	loconet_stats_window_t	window[ LN_STATS_NUM_WINDOWS ];
+
+} loconet_stats_snapshot_t;
+
+
+//----------------------------------------------------------------------
+//	the statistics structure
+//
+typedef struct loconet_statistics
+{
+	loconet_bus_t			*pBus;
+
+	uint32_t				opcodeFrames[ 128 ];
+	uint32_t				opcodeBytes[ 128 ];
+	uint64_t				totalFrames;
+	uint64_t				totalBytes;
+
+	loconet_stats_top_t		top[ LN_STATS_NUM_CATEGORIES ];
+	loconet_stats_bucket_t	buckets[ LOCONET_STATS_NUM_BUCKETS ];
+
+	LnTxStats				lastTxStats;
+
+	atomic_uint				sequence;			//	odd while updating
+
+} loconet_statistics_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern uint8_t loconet_statistics_init( loconet_statistics_t *pStats, loconet_bus_t *pBus );
+
+//--------------------------------------------------------------------------
+//	should be called in a periodical manner (e.g. every 100 ms) with the
+//	tx statistics of the phy to get the collisions and tx errors.
+//	It must be called by the task that broadcasts on the bus.
+extern void loconet_statistics_sample_tx( loconet_statistics_t *pStats, const LnTxStats *pTxStats );
+
+extern void loconet_statistics_snapshot( loconet_statistics_t *pStats, loconet_stats_snapshot_t *pSnapshot );
+
+//--------------------------------------------------------------------------
+//	this is the function that must be registered at the "bus"
+//	to be able to count the loconet messages
+extern void loconet_statistics_process( loconet_bus_consumer pConsumer, LnMsg *pMsg );
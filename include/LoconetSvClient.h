@@ -0,0 +1,187 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetSvClient.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library read and write
+//#	System Variables (SV, protocol version 2) of loconet devices.
+//#	A list of requests is worked off with several requests in flight
+//#	to different devices, four SVs per transfer where possible.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "ln_opc.h"
+#include "LoconetBus.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define LOCONET_SV_MAX_IN_FLIGHT		8
+
+#define LOCONET_SV_DEFAULT_IN_FLIGHT	4
+#define LOCONET_SV_DEFAULT_TIMEOUT_US	(300 * 1000)
+#define LOCONET_SV_DEFAULT_RETRIES		3
+
+//	source address used in the requests
+#define LOCONET_SV_SOURCE				0x01
+
+//	SV commands (protocol version 2), a reply has bit 6 set
+#define SV_CMD_WRITE_SINGLE				0x01
+#define SV_CMD_READ_SINGLE				0x02
+#define SV_CMD_WRITE_MASKED				0x03
+#define SV_CMD_WRITE_QUAD				0x05
+#define SV_CMD_READ_QUAD				0x06
+#define SV_CMD_DISCOVER					0x07
+#define SV_CMD_IDENTIFY					0x08
+#define SV_CMD_CHANGE_ADDRESS			0x09
+#define SV_CMD_RECONFIGURE				0x0F
+#define SV_CMD_REPLY					0x40
+
+#define SV_TYPE_2						0x02
+#define SV_MSG_SIZE						0x10
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+typedef enum
+{
+	LN_SV_READ		= 0,
+	LN_SV_WRITE
+
+} loconet_sv_op_t;
+
+
+typedef enum
+{
+	LN_SV_PENDING	= 0,
+	LN_SV_IN_FLIGHT,
+	LN_SV_DONE,
+	LN_SV_FAILED
+
+} loconet_sv_status_t;
+
+
+//----------------------------------------------------------------------
+//	one SV transfer, 'count' is 1 (single) or 4 (quad)
+//	for a read the received data is stored in 'data'
+//
+typedef struct loconet_sv_request
+{
+	uint16_t	destination;
+	uint16_t	svAddress;
+	uint8_t		count;
+	uint8_t		op;				//	loconet_sv_op_t
+	uint8_t		status;			//	loconet_sv_status_t
+	uint8_t		retries;
+	uint8_t		data[ 4 ];
+
+} loconet_sv_request_t;
+
+
+//----------------------------------------------------------------------
+//	progress function definition
+//	will be called after every finished (done or failed) request
+//
+typedef void (*loconet_sv_func_progress)( void *pContext, uint16_t done, uint16_t failed, uint16_t total );
+
+
+//----------------------------------------------------------------------
+//	the SV client structure
+//
+typedef struct loconet_sv_client
+{
+	loconet_bus_t				*pBus;
+
+	loconet_sv_request_t		*pRequests;
+	uint16_t					numRequests;
+	uint16_t					firstPending;
+
+	uint16_t					inFlight[ LOCONET_SV_MAX_IN_FLIGHT ];
+	uint64_t					sendTime[ LOCONET_SV_MAX_IN_FLIGHT ];
+	uint8_t						numInFlight;
+
+	uint8_t						maxInFlight;
+	uint8_t						maxRetries;
+	uint32_t					timeoutUs;
+
+	loconet_sv_func_progress	pProgressFunc;
+	void						*pProgressContext;
+
+	uint16_t					cntDone;
+	uint16_t					cntFailed;
+	uint32_t					cntRetries;
+	uint64_t					startTime;
+	uint64_t					endTime;
+
+} loconet_sv_client_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern uint8_t loconet_sv_client_init( loconet_sv_client_t *pClient, loconet_bus_t *pBus );
+
+extern uint16_t	loconet_sv_fill_requests(	loconet_sv_request_t	*pRequests,
+											uint16_t				maxRequests,
+											uint16_t				destination,
+											uint16_t				firstSv,
+											uint16_t				numSvs,
+											loconet_sv_op_t			op,
+											const uint8_t			*pData			);
+
+extern uint8_t	loconet_sv_client_start(	loconet_sv_client_t			*pClient,
+											loconet_sv_request_t		*pRequests,
+											uint16_t					numRequests,
+											loconet_sv_func_progress	pFunc,
+											void						*pContext		);
+extern bool		loconet_sv_client_is_busy( loconet_sv_client_t *pClient );
+
+//--------------------------------------------------------------------------
+//	this function should be called in a periodical manner to send new
+//	requests and to handle timeouts
+extern void loconet_sv_client_process( loconet_sv_client_t *pClient );
+
+//--------------------------------------------------------------------------
+//	this is the function that must be registered at the "bus"
+//	to be able to consume (handle) SV replies
+extern void loconet_sv_client_receive( loconet_bus_consumer pConsumer, LnMsg *pMsg );
@@ -0,0 +1,175 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetThrottle.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library drive locos: a throttle is
+//#	bound to a slot and keeps the wanted speed, direction and functions.
+//#	The frames (OPC_LOCO_SPD, OPC_LOCO_DIRF for direction and F0 .. F4,
+//#	OPC_LOCO_SND for F5 .. F8) are only sent if the value changed, at most
+//#	once per interval per slot, so many changes in between lead to one
+//#	frame with the last value. All throttles of a pool share a budget of
+//#	frames per second, they are served round-robin.
+//#	An emergency stop is sent at once.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "ln_opc.h"
+#include "LoconetBus.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define LOCONET_THROTTLE_MAX_THROTTLES			16
+
+//	at most 10 frames per second per slot
+#define LOCONET_THROTTLE_DEFAULT_INTERVAL_US	(100 * 1000)
+
+//	frames per second of all throttles of a pool (about 12 % of the bus)
+#define LOCONET_THROTTLE_DEFAULT_BUDGET			50
+#define LOCONET_THROTTLE_DEFAULT_BURST			4
+
+#define LOCONET_THROTTLE_MAX_FUNCTION			8
+
+//	slot 0 is the dispatch slot, slots 1 .. 119 are loco slots
+#define LOCONET_THROTTLE_MAX_SLOT				119
+
+//	pending frames of a throttle
+#define LN_THROTTLE_PENDING_SPD					0x01
+#define LN_THROTTLE_PENDING_DIRF				0x02
+#define LN_THROTTLE_PENDING_SND					0x04
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+struct loconet_throttle_pool;
+
+
+//----------------------------------------------------------------------
+//	one throttle, bound to a slot
+//	'spd', 'dirf' and 'snd' are the wanted values, the 'sent...'
+//	values are the last ones on the bus
+//
+typedef struct loconet_throttle
+{
+	struct loconet_throttle_pool	*pPool;
+	uint8_t							slot;
+
+	uint8_t							spd;
+	uint8_t							dirf;
+	uint8_t							snd;
+
+	uint8_t							sentSpd;
+	uint8_t							sentDirf;
+	uint8_t							sentSnd;
+
+	uint8_t							pending;		//	LN_THROTTLE_PENDING_xxx
+	uint8_t							lastFrame;		//	LN_THROTTLE_PENDING_xxx
+	uint32_t						intervalUs;
+	uint64_t						sendTime;
+
+	uint32_t						cntFrames;
+	uint32_t						cntCoalesced;	//	changes without an own frame
+
+} loconet_throttle_t;
+
+
+//----------------------------------------------------------------------
+//	the pool structure
+//	the budget is a token bucket, one token per frame
+//
+typedef struct loconet_throttle_pool
+{
+	loconet_bus_t			*pBus;
+
+	loconet_throttle_t		*pThrottles[ LOCONET_THROTTLE_MAX_THROTTLES ];
+	uint8_t					nextThrottle;		//	round-robin
+
+	uint16_t				budget;				//	frames per second
+	uint8_t					burst;
+	uint64_t				tokens;				//	in 1/1000000 frames
+	uint64_t				refillTime;
+
+	uint32_t				cntFrames;
+	uint32_t				cntDeferred;		//	no token left
+
+} loconet_throttle_pool_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern uint8_t loconet_throttle_pool_init( loconet_throttle_pool_t *pPool, loconet_bus_t *pBus );
+
+//--------------------------------------------------------------------------
+//	bind a throttle to a slot, the current values of the slot should
+//	be set before with loconet_throttle_sync()
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	pool is full
+//		2	=>	invalid slot
+extern uint8_t	loconet_throttle_init( loconet_throttle_t *pThrottle, loconet_throttle_pool_t *pPool, uint8_t slot );
+extern void		loconet_throttle_release( loconet_throttle_t *pThrottle );
+
+//--------------------------------------------------------------------------
+//	take the values of the slot (e.g. from OPC_SL_RD_DATA) as wanted
+//	and sent values, nothing is sent
+extern void		loconet_throttle_sync( loconet_throttle_t *pThrottle, uint8_t spd, uint8_t dirf, uint8_t snd );
+
+//--------------------------------------------------------------------------
+//	'spd' is the value of OPC_LOCO_SPD: 0 => stop, 2 .. 127 => speed,
+//	1 is the emergency stop and sent at once
+extern void		loconet_throttle_set_speed( loconet_throttle_t *pThrottle, uint8_t spd );
+extern void		loconet_throttle_set_direction( loconet_throttle_t *pThrottle, bool forward );
+extern void		loconet_throttle_set_function( loconet_throttle_t *pThrottle, uint8_t function, bool on );
+extern void		loconet_throttle_estop( loconet_throttle_t *pThrottle );
+
+//--------------------------------------------------------------------------
+//	this function should be called in a periodical manner (every ms)
+//	by the task that broadcasts on the bus, it sends the pending frames
+extern void loconet_throttle_pool_process( loconet_throttle_pool_t *pPool );
+
+//--------------------------------------------------------------------------
+//	this is the function that must be registered at the "bus" to
+//	follow the slot changes of other throttles
+extern void loconet_throttle_pool_receive( loconet_bus_consumer pConsumer, LnMsg *pMsg );
@@ -0,0 +1,121 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetTrace.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	Trace points along the rx and tx path of the library. Every event
+//#	is stored with a time stamp and a small payload in a lock-free
+//#	ring per core and can be exported as Chrome trace JSON
+//#	(chrome://tracing or ui.perfetto.dev).
+//#	Without LOCONET_TRACE_ENABLE all trace points compile to nothing.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#ifndef LOCONET_TRACE_NUM_CORES
+	#define LOCONET_TRACE_NUM_CORES		2
+#endif
+
+//	events per core, must be a power of two
+#ifndef LOCONET_TRACE_RING_SIZE
+	#define LOCONET_TRACE_RING_SIZE		1024
+#endif
+
+
+#ifdef LOCONET_TRACE_ENABLE
+	#define LN_TRACE( id, payload )		loconet_trace_event( (id), (uint32_t)(payload) )
+#else
+	#define LN_TRACE( id, payload )		((void)0)
+#endif
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+typedef enum
+{
+	LN_TRACE_RX_BYTE	= 0,		//	payload: the byte
+	LN_TRACE_RX_FRAME,				//	payload: opcode
+	LN_TRACE_RX_ENQUEUE,			//	payload: opcode
+	LN_TRACE_RX_DEQUEUE,			//	payload: opcode
+	LN_TRACE_CONSUMER_ENTER,		//	payload: index of the consumer
+	LN_TRACE_CONSUMER_EXIT,			//	payload: index of the consumer
+	LN_TRACE_TX_START,				//	payload: opcode
+	LN_TRACE_TX_ECHO_OK,			//	payload: opcode
+	LN_TRACE_TX_COLLISION,			//	payload: remaining tries
+	LN_TRACE_BACKOFF_END,			//	payload: 0
+	LN_TRACE_NUM_EVENTS
+
+} loconet_trace_id_t;
+
+
+typedef struct loconet_trace_event
+{
+	uint64_t	time;				//	us
+	uint32_t	payload;
+	uint8_t		id;					//	loconet_trace_id_t
+
+} loconet_trace_event_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+#ifdef LOCONET_TRACE_ENABLE
+
+//--------------------------------------------------------------------------
+//	tracing is on after start up, switch it off before the export
+//	to get a consistent picture
+extern void		loconet_trace_enable( bool enable );
+extern void		loconet_trace_clear( void );
+
+extern void		loconet_trace_event( uint8_t id, uint32_t payload );
+
+//--------------------------------------------------------------------------
+//	writes all events of all cores as Chrome trace JSON,
+//	returns the number of events
+extern uint32_t	loconet_trace_export_json( FILE *pFile );
+
+#endif
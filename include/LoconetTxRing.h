@@ -0,0 +1,177 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		LoconetTxRing.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library implement the transmit
+//#	ring of a phy: many tasks (producers) can add messages without a lock,
+//#	one task (the consumer) takes them out and sends them.
+//#	A producer can get an own token bucket, so a chatty one can not fill
+//#	the ring and starve the others. OPC_LOCO_SPD, OPC_LOCO_DIRF and
+//#	OPC_LOCO_SND for a slot that is already waiting are coalesced: only
+//#	the last value is sent.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "ln_opc.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+//	must be a power of two
+#ifndef LOCONET_TX_RING_SIZE
+	#define LOCONET_TX_RING_SIZE			64
+#endif
+
+//	producers are told apart by a key (e.g. the bus sender),
+//	entry 0 is used for the key NULL and if the table is full
+#define LOCONET_TX_MAX_PRODUCERS			8
+
+//	OPC_LOCO_SPD, OPC_LOCO_DIRF and OPC_LOCO_SND
+#define LOCONET_TX_NUM_COALESCE				3
+#define LOCONET_TX_NUM_SLOTS				128
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+typedef enum
+{
+	LN_TX_QUEUED	= 0,
+	LN_TX_COALESCED,				//	replaced the value of a waiting message
+	LN_TX_DROPPED					//	ring full or producer over its rate
+
+} loconet_tx_status_t;
+
+
+//----------------------------------------------------------------------
+//	one entry of the ring, 'sequence' tells if it is free or filled
+//	for the actual round (bounded MPMC queue of D. Vyukov)
+//	A coalesced message only holds opcode and slot, the value is
+//	taken from the value table when it is sent.
+//
+typedef struct loconet_tx_cell
+{
+	atomic_uint		sequence;
+	uint8_t			coalesce;		//	index in the value table, 0xFF => none
+	uint8_t			tag;			//	of the caller, 0 => none
+	const void		*pProducer;
+	LnMsg			msg;
+
+} loconet_tx_cell_t;
+
+
+//----------------------------------------------------------------------
+//	the token bucket of a producer as "theoretical arrival time"
+//	(GCRA), so it is one atomic value
+//	A producer without a rate (intervalUs 0) is not limited.
+//
+typedef struct loconet_tx_producer
+{
+	atomic_uintptr_t	key;
+	atomic_uint			arrivalTime;		//	in us
+	atomic_uint			cntDropped;
+	uint32_t			intervalUs;			//	between two frames, 0 => no limit
+	uint32_t			toleranceUs;		//	burst
+
+} loconet_tx_producer_t;
+
+
+//----------------------------------------------------------------------
+//	the ring structure
+//	'head' is written by the producers, 'tail' only by the consumer
+//
+typedef struct loconet_tx_ring
+{
+	loconet_tx_cell_t		cells[ LOCONET_TX_RING_SIZE ];
+	atomic_uint				head;
+	atomic_uint				tail;
+
+	atomic_uchar			value[ LOCONET_TX_NUM_COALESCE ][ LOCONET_TX_NUM_SLOTS ];
+	atomic_bool				waiting[ LOCONET_TX_NUM_COALESCE ][ LOCONET_TX_NUM_SLOTS ];
+
+	loconet_tx_producer_t	producers[ LOCONET_TX_MAX_PRODUCERS ];
+
+	atomic_uint				cntQueued;
+	atomic_uint				cntCoalesced;
+	atomic_uint				cntDroppedFull;
+	atomic_uint				cntDroppedRate;
+	atomic_uint				highWater;
+
+} loconet_tx_ring_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern void		loconet_tx_ring_init( loconet_tx_ring_t *pRing );
+
+//--------------------------------------------------------------------------
+//	limits the producer 'pProducer' to 'rate' frames per second with a
+//	burst of 'burst' frames, a 'rate' of 0 removes the limit.
+//	Producers are not limited after the init. Must be called before the
+//	first push of the producer.
+extern void		loconet_tx_ring_set_rate( loconet_tx_ring_t *pRing, const void *pProducer, uint16_t rate, uint8_t burst );
+
+//--------------------------------------------------------------------------
+//	can be called by any task, never blocks
+extern loconet_tx_status_t	loconet_tx_ring_push( loconet_tx_ring_t *pRing, const void *pProducer, const LnMsg *pMsg );
+
+//--------------------------------------------------------------------------
+//	the 'tag' is given back by loconet_tx_ring_pop(), a tagged message
+//	is never coalesced
+extern loconet_tx_status_t	loconet_tx_ring_push_tagged( loconet_tx_ring_t *pRing, const void *pProducer, const LnMsg *pMsg, uint8_t tag );
+
+//--------------------------------------------------------------------------
+//	an emergency stop is sent by the priority path of the phy, this
+//	sets the value of a waiting OPC_LOCO_SPD for the slot, so the old
+//	speed can not follow the stop. The phy calls it when it takes the
+//	stop out of the priority queue.
+extern void		loconet_tx_ring_override_speed( loconet_tx_ring_t *pRing, uint8_t slot, uint8_t spd );
+
+//--------------------------------------------------------------------------
+//	must only be called by the consumer, 'ppProducer' and 'pTag' (both
+//	can be NULL) get the key of the producer and the tag of the message.
+//	Returns false if the ring is empty.
+extern bool		loconet_tx_ring_pop( loconet_tx_ring_t *pRing, LnMsg *pMsg, const void **ppProducer, uint8_t *pTag );
+extern uint32_t	loconet_tx_ring_count( loconet_tx_ring_t *pRing );
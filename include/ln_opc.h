@@ -172,23 +172,23 @@
 #define OPC_MULTI_SENSE_DEVICE_INFO		0x60	/* MSG field: Device Info Message  */
 #define OPC_MULTI_SENSE_ZONE_MASK		0x0F
 #define OPC_MULTI_SENSE_ZONE_ID(zone) \
-	((zone) & OPC_MULTI_SENSE_ZONE_MASK) == 0x00 ? 'A' : \
-	((zone) & OPC_MULTI_SENSE_ZONE_MASK) == 0x02 ? 'B' : \
-	((zone) & OPC_MULTI_SENSE_ZONE_MASK) == 0x04 ? 'C' : \
-	((zone) & OPC_MULTI_SENSE_ZONE_MASK) == 0x06 ? 'D' : \
-	((zone) & OPC_MULTI_SENSE_ZONE_MASK) == 0x08 ? 'E' : \
-	((zone) & OPC_MULTI_SENSE_ZONE_MASK) == 0x0A ? 'F' : \
-	((zone) & OPC_MULTI_SENSE_ZONE_MASK) == 0x0C ? 'G' : \
-	((zone) & OPC_MULTI_SENSE_ZONE_MASK) == 0x0E ? 'H' : \
-	((zone) & OPC_MULTI_SENSE_ZONE_MASK)
+	( ((zone) & OPC_MULTI_SENSE_ZONE_MASK) == 0x00 ? 'A' : \
+	  ((zone) & OPC_MULTI_SENSE_ZONE_MASK) == 0x02 ? 'B' : \
+	  ((zone) & OPC_MULTI_SENSE_ZONE_MASK) == 0x04 ? 'C' : \
+	  ((zone) & OPC_MULTI_SENSE_ZONE_MASK) == 0x06 ? 'D' : \
+	  ((zone) & OPC_MULTI_SENSE_ZONE_MASK) == 0x08 ? 'E' : \
+	  ((zone) & OPC_MULTI_SENSE_ZONE_MASK) == 0x0A ? 'F' : \
+	  ((zone) & OPC_MULTI_SENSE_ZONE_MASK) == 0x0C ? 'G' : \
+	  ((zone) & OPC_MULTI_SENSE_ZONE_MASK) == 0x0E ? 'H' : \
+	  ((zone) & OPC_MULTI_SENSE_ZONE_MASK) )
 #define OPC_MULTI_SENSE_BOARD_ID(arg1, arg2) \
-    arg2 + 1 + (arg1 & 0x01) ? 128 : 0
+    ((arg2) + 1 + (((arg1) & 0x01) ? 128 : 0))
 #define OPC_MULTI_SENSE_BOARD_ADDRESS(zone, type) \
-    zone + (type & 0x1F << 7) + 1
+    ((zone) + (((type) & 0x1F) << 7) + 1)
 #define OPC_MULTI_SENSE_LOCO_ADDRESS(adr1, adr2) \
-    adr2 + adr1 != 0x7D ? adr1 << 7 : 0
+    ((adr2) + (((adr1) != 0x7D) ? ((adr1) << 7) : 0))
 #define OPC_MULTI_SENSE_PRESENCE(zone) \
-    zone & OPC_MULTI_SENSE_PRESENT
+    ((zone) & OPC_MULTI_SENSE_PRESENT)
 
 /* Slot Status byte definitions and macros */
 /***********************************************************************************
@@ -266,14 +266,14 @@
                            "Free")))
 
 /* mask and values for decoder type encoding for this slot */
-#define DEC_MODE_MASK		STAT1_SL_SPDEX + STAT1_SL_SPD14 + STAT1_SL_SPD28
+#define DEC_MODE_MASK		(STAT1_SL_SPDEX + STAT1_SL_SPD14 + STAT1_SL_SPD28)
 
 /* Advanced consisting allowed for the next two */
-#define DEC_MODE_128A		STAT1_SL_SPDEX + STAT1_SL_SPD14 + STAT1_SL_SPD28
+#define DEC_MODE_128A		(STAT1_SL_SPDEX + STAT1_SL_SPD14 + STAT1_SL_SPD28)
 #define DEC_MODE_28A		STAT1_SL_SPDEX
 
 /* normal modes */
-#define DEC_MODE_128		STAT1_SL_SPD14 + STAT1_SL_SPD28
+#define DEC_MODE_128		(STAT1_SL_SPD14 + STAT1_SL_SPD28)
 #define DEC_MODE_14			STAT1_SL_SPD14
 #define DEC_MODE_28TRI		STAT1_SL_SPD28
 #define DEC_MODE_28			0
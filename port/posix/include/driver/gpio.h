@@ -0,0 +1,66 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		gpio.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	POSIX port: the ESP-IDF gpio functions used by the library.
+//#	A host has no gpio pins, the levels are only stored.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+
+#include "esp_err.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define GPIO_NUM_MAX		64
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+typedef int		gpio_num_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern esp_err_t	gpio_set_level( gpio_num_t gpioNum, uint32_t level );
+extern int			gpio_get_level( gpio_num_t gpioNum );
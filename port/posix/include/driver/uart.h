@@ -0,0 +1,155 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		uart.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	POSIX port: the ESP-IDF uart driver functions used by the library.
+//#	A uart is a serial device of the host (e.g. a USB serial adapter with
+//#	a loconet level converter), it must be assigned with
+//#	uart_posix_set_device() before uart_driver_install() is called.
+//#	The line inversion and the rs485 collision detection of the ESP32
+//#	are not available, the level converter must handle the inversion.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define UART_NUM_0				0
+#define UART_NUM_1				1
+#define UART_NUM_2				2
+#define UART_NUM_MAX			3
+
+#define UART_PIN_NO_CHANGE		(-1)
+
+#define UART_SIGNAL_RXD_INV		(0x01 << 4)
+#define UART_SIGNAL_TXD_INV		(0x01 << 10)
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+typedef int		uart_port_t;
+
+typedef enum
+{
+	UART_DATA_5_BITS	= 0,
+	UART_DATA_6_BITS,
+	UART_DATA_7_BITS,
+	UART_DATA_8_BITS
+
+} uart_word_length_t;
+
+typedef enum
+{
+	UART_PARITY_DISABLE	= 0,
+	UART_PARITY_EVEN	= 2,
+	UART_PARITY_ODD		= 3
+
+} uart_parity_t;
+
+typedef enum
+{
+	UART_STOP_BITS_1	= 1,
+	UART_STOP_BITS_1_5,
+	UART_STOP_BITS_2
+
+} uart_stop_bits_t;
+
+typedef enum
+{
+	UART_HW_FLOWCTRL_DISABLE	= 0,
+	UART_HW_FLOWCTRL_RTS,
+	UART_HW_FLOWCTRL_CTS,
+	UART_HW_FLOWCTRL_CTS_RTS
+
+} uart_hw_flowcontrol_t;
+
+typedef enum
+{
+	UART_MODE_UART	= 0,
+	UART_MODE_RS485_HALF_DUPLEX,
+	UART_MODE_IRDA,
+	UART_MODE_RS485_COLLISION_DETECT,
+	UART_MODE_RS485_APP_CTRL
+
+} uart_mode_t;
+
+
+typedef struct
+{
+	int						baud_rate;
+	uart_word_length_t		data_bits;
+	uart_parity_t			parity;
+	uart_stop_bits_t		stop_bits;
+	uart_hw_flowcontrol_t	flow_ctrl;
+	uint8_t					rx_flow_ctrl_thresh;
+
+} uart_config_t;
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//--------------------------------------------------------------------------
+//	only in the POSIX port: the serial device of a uart
+extern esp_err_t	uart_posix_set_device( uart_port_t uartNum, const char *pPath );
+
+extern esp_err_t	uart_driver_install(	uart_port_t	uartNum,
+											int			rxBufferSize,
+											int			txBufferSize,
+											int			queueSize,
+											void		*pQueue,
+											int			intrAllocFlags	);
+extern esp_err_t	uart_driver_delete( uart_port_t uartNum );
+
+extern esp_err_t	uart_param_config( uart_port_t uartNum, const uart_config_t *pConfig );
+extern esp_err_t	uart_set_pin( uart_port_t uartNum, int txPin, int rxPin, int rtsPin, int ctsPin );
+extern esp_err_t	uart_set_line_inverse( uart_port_t uartNum, uint32_t inverseMask );
+extern esp_err_t	uart_set_mode( uart_port_t uartNum, uart_mode_t mode );
+extern esp_err_t	uart_get_collision_flag( uart_port_t uartNum, bool *pCollision );
+
+extern int			uart_read_bytes( uart_port_t uartNum, void *pBuffer, uint32_t length, TickType_t ticks );
+extern int			uart_write_bytes( uart_port_t uartNum, const void *pData, size_t size );
@@ -0,0 +1,69 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		esp_err.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	POSIX port: the ESP-IDF error codes used by the library.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define ESP_OK					0
+#define ESP_FAIL				-1
+#define ESP_ERR_INVALID_ARG		0x102
+#define ESP_ERR_INVALID_STATE	0x103
+
+#define ESP_ERROR_CHECK( x )														\
+	do																				\
+	{																				\
+		esp_err_t	errRc = (x);													\
+																					\
+		if( ESP_OK != errRc )														\
+		{																			\
+			fprintf( stderr, "%s:%d: %s failed (%d)\n", __FILE__, __LINE__, #x, errRc );	\
+			abort();																\
+		}																			\
+	} while( 0 )
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+typedef int		esp_err_t;
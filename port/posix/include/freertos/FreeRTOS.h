@@ -0,0 +1,129 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		FreeRTOS.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	POSIX port: the FreeRTOS types and definitions used by the library.
+//#	Tasks are pthreads, queues are a ring with a mutex and a condition
+//#	variable. The static buffers hold the whole control structure, so
+//#	nothing is allocated, like with the static FreeRTOS functions.
+//#	One tick is one millisecond.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define pdFALSE					0
+#define pdTRUE					1
+#define pdPASS					pdTRUE
+#define pdFAIL					pdFALSE
+#define errQUEUE_FULL			pdFALSE
+#define errQUEUE_EMPTY			pdFALSE
+
+#define configTICK_RATE_HZ		1000
+#define configMAX_PRIORITIES	25
+
+#define portTICK_PERIOD_MS		(1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY			((TickType_t)0xFFFFFFFF)
+#define portNUM_PROCESSORS		2
+
+#define pdMS_TO_TICKS( ms )		((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+typedef int32_t		BaseType_t;
+typedef uint32_t	UBaseType_t;
+typedef uint32_t	TickType_t;
+typedef uint8_t		StackType_t;
+
+typedef void (*TaskFunction_t)( void *pParameter );
+
+
+//----------------------------------------------------------------------
+//	task control structure, the stack of the pthread is used
+//	instead of the given stack buffer
+//
+typedef struct StaticTask
+{
+	pthread_t		thread;
+	TaskFunction_t	pFunc;
+	void			*pParameter;
+	BaseType_t		coreId;
+
+	pthread_mutex_t	notifyMutex;
+	pthread_cond_t	notifyCond;
+	uint32_t		notifyValue;
+
+} StaticTask_t;
+
+
+//----------------------------------------------------------------------
+//	queue control structure, the items are stored in the buffer
+//	given to xQueueCreateStatic()
+//
+typedef struct StaticQueue
+{
+	pthread_mutex_t	mutex;
+	pthread_cond_t	changed;
+	uint8_t			*pStorage;
+	UBaseType_t		length;
+	UBaseType_t		itemSize;
+	UBaseType_t		head;
+	UBaseType_t		count;
+
+} StaticQueue_t;
+
+
+//----------------------------------------------------------------------
+//	mutex control structure
+//
+typedef struct StaticSemaphore
+{
+	pthread_mutex_t	mutex;
+
+} StaticSemaphore_t;
+
+
+typedef StaticTask_t		*TaskHandle_t;
+typedef StaticQueue_t		*QueueHandle_t;
+typedef StaticSemaphore_t	*SemaphoreHandle_t;
@@ -0,0 +1,64 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		queue.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	POSIX port: the FreeRTOS queue functions used by the library.
+//#	The items are copied like with FreeRTOS, a task waits on a
+//#	condition variable for the given number of ticks.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include "freertos/FreeRTOS.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define xQueueSend( queue, pItem, ticks )		xQueueSendToBack( (queue), (pItem), (ticks) )
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern QueueHandle_t	xQueueCreateStatic(	UBaseType_t		length,
+											UBaseType_t		itemSize,
+											uint8_t			*pStorage,
+											StaticQueue_t	*pQueueBuffer	);
+
+extern BaseType_t		xQueueSendToBack( QueueHandle_t queue, const void *pItem, TickType_t ticks );
+extern BaseType_t		xQueueSendToFront( QueueHandle_t queue, const void *pItem, TickType_t ticks );
+extern BaseType_t		xQueueReceive( QueueHandle_t queue, void *pItem, TickType_t ticks );
+
+extern UBaseType_t		uxQueueMessagesWaiting( QueueHandle_t queue );
@@ -0,0 +1,48 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		semphr.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	POSIX port: the FreeRTOS semaphore functions used by the library.
+//#	Only the recursive mutex is needed, it is a recursive pthread mutex.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include "freertos/FreeRTOS.h"
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern SemaphoreHandle_t	xSemaphoreCreateRecursiveMutexStatic( StaticSemaphore_t *pMutexBuffer );
+
+extern BaseType_t			xSemaphoreTakeRecursive( SemaphoreHandle_t mutex, TickType_t ticks );
+extern BaseType_t			xSemaphoreGiveRecursive( SemaphoreHandle_t mutex );
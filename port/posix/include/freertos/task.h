@@ -0,0 +1,81 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		task.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	POSIX port: the FreeRTOS task functions used by the library.
+//#	The priority is ignored, a task that is pinned to a core gets the
+//#	affinity of this cpu (if the host has that many).
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include "freertos/FreeRTOS.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define tskIDLE_PRIORITY		((UBaseType_t)0)
+#define tskNO_AFFINITY			((BaseType_t)0x7FFFFFFF)
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+extern TaskHandle_t	xTaskCreateStatic(	TaskFunction_t	pFunc,
+										const char		*pName,
+										uint32_t		stackDepth,
+										void			*pParameter,
+										UBaseType_t		priority,
+										StackType_t		*pStack,
+										StaticTask_t	*pTaskBuffer	);
+
+extern TaskHandle_t	xTaskCreateStaticPinnedToCore(	TaskFunction_t	pFunc,
+													const char		*pName,
+													uint32_t		stackDepth,
+													void			*pParameter,
+													UBaseType_t		priority,
+													StackType_t		*pStack,
+													StaticTask_t	*pTaskBuffer,
+													BaseType_t		coreId			);
+
+extern void			vTaskDelay( TickType_t ticks );
+extern TickType_t	xTaskGetTickCount( void );
+
+extern BaseType_t	xPortGetCoreID( void );
+
+//--------------------------------------------------------------------------
+//	the notification value is used as counting semaphore
+extern BaseType_t	xTaskNotifyGive( TaskHandle_t task );
+extern uint32_t		ulTaskNotifyTake( BaseType_t clearOnExit, TickType_t ticks );
@@ -0,0 +1,80 @@
+#pragma once
+
+//##########################################################################
+//#
+//#		uart_hal.h
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	POSIX port: the uart registers used by the library.
+//#	Every uart has a dummy register set, writing to it has no effect.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+
+#include "driver/uart.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define UART_LL_GET_HW( num )		(&(uart_posix_dev[ (num) ]))
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+typedef struct
+{
+	struct
+	{
+		uint32_t	rs485_clash_int_clr;
+
+	} int_clr;
+
+	struct
+	{
+		uint32_t	rs485rxby_tx_en;
+		uint32_t	rs485tx_rx_en;
+
+	} rs485_conf;
+
+} uart_dev_t;
+
+
+//==========================================================================
+//
+//		G L O B A L   V A R I A B L E S
+//
+//==========================================================================
+
+extern uart_dev_t	uart_posix_dev[ UART_NUM_MAX ];
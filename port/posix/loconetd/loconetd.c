@@ -0,0 +1,584 @@
+//##########################################################################
+//#
+//#		loconetd.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	loconetd: runs the bus with its phys and gateways on a Linux host.
+//#		-d <device>		loconet over a serial device (USB serial adapter
+//#						with a loconet level converter), uses the uart phy
+//#		-P				uart phy in pipeline mode (own dispatch task), the
+//#						main loop holds the bus lock while it works
+//#		-t <port>		LbServer port (default 1234, 0 => off)
+//#		-l				LocoBuffer compatible pty for a PC program
+//#		-c <file>		capture all messages into <file>
+//#		-s <seconds>	print the statistics every <seconds>
+//#		-p <file>		keep the state of the sensors, switches and slots
+//#						in <file>, it is restored at the start
+//#		-q <count>		ask the sensors and the switches 1 .. <count>
+//#						after the start and print the time it took
+//#		-r <rate>		limit the messages of the LbServer clients and
+//#						of the PC on the pty to <rate> per second each
+//#						(default no limit)
+//#	The daemon runs until SIGINT or SIGTERM.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "driver/uart.h"
+
+#include "LoconetBus.h"
+#include "LoconetPhyUART.h"
+#include "LoconetPhyLocoBuffer.h"
+#include "LoconetLbServer.h"
+#include "LoconetCapture.h"
+#include "LoconetStatistics.h"
+#include "LoconetPersist.h"
+#include "LoconetDiscovery.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define LOCONET_UART_NUM		UART_NUM_2
+
+//	period of the main loop
+#define TICK_PERIOD_NS			1000000
+
+//	ticks between two checkpoints of the state
+#define CHECKPOINT_TICKS		10000
+
+//	burst of a producer with a rate (-r)
+#define TX_BURST				32
+
+
+//==========================================================================
+//
+//		G L O B A L   V A R I A B L E S
+//
+//==========================================================================
+
+static loconet_bus_t				theBus;
+static loconet_phy_uart_t			theUart;
+static loconet_phy_locobuffer_t		theLocoBuffer;
+static loconet_lbserver_t			theServer;
+static loconet_capture_t			theCapture;
+static loconet_statistics_t			theStatistics;
+static loconet_stats_snapshot_t		theSnapshot;
+static loconet_consumer_state_cache_t	theStateCache;
+static loconet_consumer_slot_table_t	theSlotTable;
+static loconet_persist_t				thePersist;
+static loconet_persist_file_t			thePersistFile;
+static loconet_discovery_t				theDiscovery;
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	usage
+//--------------------------------------------------------------------------
+//
+static void usage( const char *pName )
+{
+	fprintf(	stderr,
+				"usage: %s [-d device [-P]] [-t port] [-l] [-c file] [-s seconds] [-p file] [-q count] [-r rate]\n"
+				"  -d device   loconet over a serial device (uart phy)\n"
+				"  -P          uart phy with an own dispatch task\n"
+				"  -t port     LbServer port (default %u, 0 => off)\n"
+				"  -l          LocoBuffer compatible pty\n"
+				"  -c file     capture all messages into file\n"
+				"  -s seconds  print the statistics every seconds\n"
+				"  -p file     keep the sensor, switch and slot state in file\n"
+				"  -q count    ask the sensors and the switches 1 .. count\n"
+				"  -r rate     limit LbServer and pty to rate messages/s each\n",
+				pName, LOCONET_LBSERVER_DEFAULT_PORT							);
+}
+
+
+//**************************************************************************
+//	print_statistics
+//--------------------------------------------------------------------------
+//
+static void print_statistics( const LnTxStats *pTxStats )
+{
+	loconet_stats_window_t	*pWindow = &(theSnapshot.window[ LN_STATS_WINDOW_10S ]);
+
+	if( NULL != pTxStats )
+	{
+		loconet_statistics_sample_tx( &theStatistics, pTxStats );
+	}
+
+	loconet_statistics_snapshot( &theStatistics, &theSnapshot );
+
+	printf(	"frames: %" PRIu64 "  last 10 s: %" PRIu32 " frames, %u.%u %% load, %" PRIu32 " collisions, %" PRIu32 " tx errors\n",
+			theSnapshot.totalFrames,
+			pWindow->frames,
+			pWindow->utilization / 10, pWindow->utilization % 10,
+			pWindow->collisions,
+			pWindow->txErrors																										);
+
+	if( NULL != pTxStats )
+	{
+		printf(	"tx ring: %u queued, %u coalesced, %u dropped (full), %u dropped (rate), high water %u\n",
+				atomic_load( &(theUart.txRing.cntQueued) ),
+				atomic_load( &(theUart.txRing.cntCoalesced) ),
+				atomic_load( &(theUart.txRing.cntDroppedFull) ),
+				atomic_load( &(theUart.txRing.cntDroppedRate) ),
+				atomic_load( &(theUart.txRing.highWater) )													);
+
+		printf(	"rx: %" PRIu32 " dropped (queue full), %" PRIu32 " dropped (ring full)\n",
+				theUart.cntRxQueueFull,
+				theUart.cntRxRingFull											);
+	}
+
+	fflush( stdout );
+}
+
+
+//**************************************************************************
+//	discovery_done
+//--------------------------------------------------------------------------
+//
+static void discovery_done( void *pContext, uint16_t cntSwitches, uint16_t cntFailed, uint32_t durationUs )
+{
+	printf(	"discovery: %u switches, %u failed, %" PRIu32 " sensor reports, %" PRIu32 " timeouts, %" PRIu32 " local drops in %" PRIu32 ".%03" PRIu32 " s\n",
+			cntSwitches, cntFailed,
+			theDiscovery.cntSensorReports,
+			theDiscovery.cntTimeouts,
+			theDiscovery.cntLocalDrops,
+			durationUs / 1000000, (durationUs / 1000) % 1000												);
+
+	fflush( stdout );
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	main
+//--------------------------------------------------------------------------
+//
+int main( int argc, char *argv[] )
+{
+	loconet_persist_backend_t	backend;
+	struct epoll_event	event;
+	struct itimerspec	period;
+	sigset_t			signals;
+	uint64_t			expirations;
+	uint64_t			ticks		= 0;
+	uint64_t			persistTicks	= 0;
+	const char			*pDevice	= NULL;
+	const char			*pCapture	= NULL;
+	const char			*pPersist	= NULL;
+	FILE				*pCaptureFile	= NULL;
+	unsigned long		port		= LOCONET_LBSERVER_DEFAULT_PORT;
+	unsigned long		statPeriod	= 0;
+	unsigned long		numSwitches	= 0;
+	unsigned long		txRate		= 0;
+	bool				usePty		= false;
+	bool				pipeline	= false;
+	bool				running		= true;
+	char				ptyName[ 64 ];
+	int					option;
+	uint8_t				result;
+	int					epollFd;
+	int					timerFd;
+	int					signalFd;
+
+	while( -1 != (option = getopt( argc, argv, "d:Pt:lc:s:p:q:r:h" )) )
+	{
+		switch( option )
+		{
+			case 'd':	pDevice		= optarg;						break;
+			case 'P':	pipeline	= true;							break;
+			case 't':	port		= strtoul( optarg, NULL, 10 );	break;
+			case 'l':	usePty		= true;							break;
+			case 'c':	pCapture	= optarg;						break;
+			case 's':	statPeriod	= strtoul( optarg, NULL, 10 );	break;
+			case 'p':	pPersist	= optarg;						break;
+			case 'q':	numSwitches	= strtoul( optarg, NULL, 10 );	break;
+			case 'r':	txRate		= strtoul( optarg, NULL, 10 );	break;
+			default:	usage( argv[ 0 ] );							return( 1 );
+		}
+	}
+
+	if( pipeline && (NULL == pDevice) )
+	{
+		fprintf( stderr, "-P needs -d\n" );
+		return( 1 );
+	}
+
+	if( (0 < txRate) && (NULL == pDevice) )
+	{
+		fprintf( stderr, "-r needs -d\n" );
+		return( 1 );
+	}
+
+	if( UINT16_MAX < txRate )
+	{
+		fprintf( stderr, "-r: at most %u messages per second\n", UINT16_MAX );
+		return( 1 );
+	}
+
+	if( LOCONET_DISCOVERY_MAX_SWITCHES < numSwitches )
+	{
+		fprintf( stderr, "-q: at most %u switches\n", LOCONET_DISCOVERY_MAX_SWITCHES );
+		return( 1 );
+	}
+
+	//------------------------------------------------------------------
+	//	SIGINT and SIGTERM are read from a signalfd,
+	//	so the main loop can end in a clean way
+	//
+	sigemptyset( &signals );
+	sigaddset( &signals, SIGINT );
+	sigaddset( &signals, SIGTERM );
+	sigprocmask( SIG_BLOCK, &signals, NULL );
+	signal( SIGPIPE, SIG_IGN );
+
+	loconet_bus_init( &theBus );
+
+	if( 0 != loconet_statistics_init( &theStatistics, &theBus ) )
+	{
+		fprintf( stderr, "too many bus consumers\n" );
+		return( 1 );
+	}
+
+	//------------------------------------------------------------------
+	//	the state is restored before a phy receives the first message
+	//
+	if( NULL != pPersist )
+	{
+		if( 0 != loconet_persist_file_open( &thePersistFile, pPersist, &backend ) )
+		{
+			fprintf( stderr, "can not open %s\n", pPersist );
+			return( 1 );
+		}
+
+		if(		(0 != loconet_consumer_state_cache_init( &theStateCache, &theBus ))
+			||	(0 != loconet_consumer_slot_table_init( &theSlotTable, &theBus ))	)
+		{
+			fprintf( stderr, "too many bus consumers\n" );
+			return( 1 );
+		}
+
+		loconet_persist_init( &thePersist, &theStateCache, &theSlotTable, &backend );
+
+		if( 1 < loconet_persist_restore( &thePersist ) )
+		{
+			fprintf( stderr, "%s: state not or not completely restored\n", pPersist );
+		}
+	}
+
+	//------------------------------------------------------------------
+	//	in pipeline mode the consumers run in the dispatch task of the
+	//	phy, so this thread only touches them with the bus lock
+	//
+	loconet_bus_lock( &theBus );
+
+	if( NULL != pDevice )
+	{
+		if( ESP_OK != uart_posix_set_device( LOCONET_UART_NUM, pDevice ) )
+		{
+			fprintf( stderr, "can not use %s\n", pDevice );
+			return( 1 );
+		}
+
+		theUart.pBus		= &theBus;
+		theUart.uartNum		= LOCONET_UART_NUM;
+		theUart.rxPin		= 3;
+		theUart.txPin		= 1;
+		theUart.pipeline	= pipeline;
+
+		loconet_phy_uart_init( &theUart );
+
+		//--------------------------------------------------------------
+		//	the producers are not limited, the PC programs can be
+		//	limited so they leave room for the others
+		//
+		if( 0 < txRate )
+		{
+			loconet_tx_ring_set_rate( &(theUart.txRing), (const void *)loconet_lbserver_send, (uint16_t)txRate, TX_BURST );
+			loconet_tx_ring_set_rate( &(theUart.txRing), (const void *)loconet_phy_locobuffer_send, (uint16_t)txRate, TX_BURST );
+		}
+	}
+
+	if( usePty )
+	{
+		result = loconet_phy_locobuffer_open_pty( &theLocoBuffer, &theBus, ptyName, sizeof( ptyName ), true );
+
+		if( 3 == result )
+		{
+			fprintf( stderr, "too many bus consumers\n" );
+			return( 1 );
+		}
+
+		if( 0 != result )
+		{
+			fprintf( stderr, "can not create the pty\n" );
+			return( 1 );
+		}
+
+		printf( "LocoBuffer pty: %s\n", ptyName );
+
+		//--------------------------------------------------------------
+		//	with a loconet the PC gets the echo when the message is
+		//	on the wire
+		//
+		if( NULL != pDevice )
+		{
+			loconet_phy_locobuffer_use_loopback( &theLocoBuffer, true );
+		}
+	}
+
+	if( 0 < port )
+	{
+		result = loconet_lbserver_init( &theServer, &theBus, (uint16_t)port );
+
+		if( 4 == result )
+		{
+			fprintf( stderr, "too many bus consumers\n" );
+			return( 1 );
+		}
+
+		if( 0 != result )
+		{
+			fprintf( stderr, "can not listen on port %lu\n", port );
+			return( 1 );
+		}
+	}
+
+	//------------------------------------------------------------------
+	//	with a loconet the clients get the answer of a SEND when the
+	//	message is on the wire
+	//
+	if( (0 < port) && (NULL != pDevice) )
+	{
+		loconet_lbserver_use_loopback( &theServer, true );
+	}
+
+	if( NULL != pCapture )
+	{
+		pCaptureFile = fopen( pCapture, "wb" );
+
+		if( NULL == pCaptureFile )
+		{
+			fprintf( stderr, "can not create %s\n", pCapture );
+			return( 1 );
+		}
+
+		if( 0 != loconet_capture_init( &theCapture, &theBus ) )
+		{
+			fprintf( stderr, "too many bus consumers\n" );
+			return( 1 );
+		}
+
+		if( NULL != pDevice )
+		{
+			loconet_capture_register_source( &theCapture, loconet_phy_uart_send, 1 );
+		}
+
+		if( 0 < port )
+		{
+			loconet_capture_register_source( &theCapture, loconet_lbserver_send, 2 );
+		}
+
+		if( usePty )
+		{
+			loconet_capture_register_source( &theCapture, loconet_phy_locobuffer_send, 3 );
+		}
+
+		loconet_capture_start( &theCapture, pCaptureFile );
+		loconet_capture_start_task( &theCapture );
+	}
+
+	//------------------------------------------------------------------
+	//	the discovery stores the switch states in the state cache
+	//	of the persistence, if there is one
+	//
+	if( 0 < numSwitches )
+	{
+		if( 0 != loconet_discovery_init( &theDiscovery, &theBus, (NULL != pPersist) ? &theStateCache : NULL ) )
+		{
+			fprintf( stderr, "too many bus consumers\n" );
+			return( 1 );
+		}
+
+		if( NULL != pDevice )
+		{
+			loconet_discovery_use_loopback( &theDiscovery, true );
+		}
+
+		loconet_discovery_start( &theDiscovery, 1, (uint16_t)numSwitches, true, discovery_done, NULL );
+	}
+
+	//------------------------------------------------------------------
+	//	the main loop waits for the timer or a signal
+	//
+	epollFd		= epoll_create1( EPOLL_CLOEXEC );
+	timerFd		= timerfd_create( CLOCK_MONOTONIC, TFD_CLOEXEC );
+	signalFd	= signalfd( -1, &signals, SFD_CLOEXEC );
+
+	period.it_interval.tv_sec	= 0;
+	period.it_interval.tv_nsec	= TICK_PERIOD_NS;
+	period.it_value				= period.it_interval;
+
+	timerfd_settime( timerFd, 0, &period, NULL );
+
+	event.events	= EPOLLIN;
+	event.data.fd	= timerFd;
+	epoll_ctl( epollFd, EPOLL_CTL_ADD, timerFd, &event );
+
+	event.data.fd	= signalFd;
+	epoll_ctl( epollFd, EPOLL_CTL_ADD, signalFd, &event );
+
+	loconet_bus_unlock( &theBus );
+
+	while( running )
+	{
+		if( 1 > epoll_wait( epollFd, &event, 1, -1 ) )
+		{
+			continue;
+		}
+
+		if( signalFd == event.data.fd )
+		{
+			running = false;
+			continue;
+		}
+
+		if( sizeof( expirations ) != read( timerFd, &expirations, sizeof( expirations ) ) )
+		{
+			continue;
+		}
+
+		ticks += expirations;
+
+		loconet_bus_lock( &theBus );
+
+		if( (NULL != pDevice) && !pipeline )
+		{
+			do
+			{
+				loconet_phy_uart_process( &theUart );
+
+			} while( uxQueueMessagesWaiting( theUart.rxQueue ) );
+		}
+
+		if( usePty )
+		{
+			loconet_phy_locobuffer_process( &theLocoBuffer );
+		}
+
+		if( 0 < port )
+		{
+			loconet_lbserver_process( &theServer );
+		}
+
+		if( 0 < numSwitches )
+		{
+			loconet_discovery_process( &theDiscovery );
+		}
+
+		if( (0 < statPeriod) && ((statPeriod * 1000) <= ticks) )
+		{
+			ticks = 0;
+
+			print_statistics( (NULL != pDevice) ? &(theUart.txStats) : NULL );
+		}
+
+		persistTicks += expirations;
+
+		if( (NULL != pPersist) && (CHECKPOINT_TICKS <= persistTicks) )
+		{
+			persistTicks = 0;
+
+			loconet_persist_checkpoint( &thePersist );
+		}
+
+		loconet_bus_unlock( &theBus );
+	}
+
+	loconet_bus_lock( &theBus );
+
+	if( NULL != pPersist )
+	{
+		loconet_persist_checkpoint( &thePersist );
+		loconet_persist_file_close( &thePersistFile );
+	}
+
+	if( NULL != pCapture )
+	{
+		loconet_capture_stop( &theCapture );
+
+		while( loconet_capture_is_busy( &theCapture ) )
+		{
+			vTaskDelay( pdMS_TO_TICKS( 10 ) );
+		}
+
+		if( (0 != fclose( pCaptureFile )) || (0 < theCapture.cntWriteErrors) )
+		{
+			fprintf( stderr, "%s: %" PRIu32 " write errors, the capture is not complete\n", pCapture, theCapture.cntWriteErrors );
+		}
+	}
+
+	if( 0 < port )
+	{
+		loconet_lbserver_close( &theServer );
+	}
+
+	if( usePty )
+	{
+		loconet_phy_locobuffer_close( &theLocoBuffer );
+	}
+
+	loconet_bus_unlock( &theBus );
+
+	return( 0 );
+}
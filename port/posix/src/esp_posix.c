@@ -0,0 +1,100 @@
+//##########################################################################
+//#
+//#		esp_posix.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	POSIX port: esp_timer and gpio functions.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <time.h>
+
+#include "esp_timer.h"
+#include "driver/gpio.h"
+
+
+//==========================================================================
+//
+//		G L O B A L   V A R I A B L E S
+//
+//==========================================================================
+
+static uint32_t	gpioLevels[ GPIO_NUM_MAX ];
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	esp_timer_get_time
+//--------------------------------------------------------------------------
+//	like on the ESP32 the time since boot, the monotonic clock does
+//	not jump if the system time is changed
+//
+int64_t esp_timer_get_time( void )
+{
+	struct timespec	now;
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+
+	return( ((int64_t)now.tv_sec * 1000000) + (now.tv_nsec / 1000) );
+}
+
+
+//**************************************************************************
+//	gpio_set_level
+//--------------------------------------------------------------------------
+//
+esp_err_t gpio_set_level( gpio_num_t gpioNum, uint32_t level )
+{
+	if( (0 > gpioNum) || (GPIO_NUM_MAX <= gpioNum) )
+	{
+		return( ESP_ERR_INVALID_ARG );
+	}
+
+	gpioLevels[ gpioNum ] = level;
+
+	return( ESP_OK );
+}
+
+
+//**************************************************************************
+//	gpio_get_level
+//--------------------------------------------------------------------------
+//
+int gpio_get_level( gpio_num_t gpioNum )
+{
+	if( (0 > gpioNum) || (GPIO_NUM_MAX <= gpioNum) )
+	{
+		return( 0 );
+	}
+
+	return( (int)gpioLevels[ gpioNum ] );
+}
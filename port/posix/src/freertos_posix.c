@@ -0,0 +1,518 @@
+//##########################################################################
+//#
+//#		freertos_posix.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	POSIX port: FreeRTOS tasks and queues on pthreads.
+//#	Tasks are pthreads, queues are a ring with a mutex and a condition
+//#	variable. The static buffers hold the whole control structure, so
+//#	nothing is allocated, like with the static FreeRTOS functions.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#define _GNU_SOURCE		//	pthread_setaffinity_np(), sched_getcpu()
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+
+//==========================================================================
+//
+//		G L O B A L   V A R I A B L E S
+//
+//==========================================================================
+
+//	the control structure of the calling task, NULL for the main thread
+static __thread StaticTask_t	*pCurrentTask = NULL;
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	task_start
+//--------------------------------------------------------------------------
+//	a FreeRTOS task function never returns
+//
+static void *task_start( void *pArgument )
+{
+	StaticTask_t	*pTask = (StaticTask_t *)pArgument;
+
+	pCurrentTask = pTask;
+
+	(*pTask->pFunc)( pTask->pParameter );
+
+	return( NULL );
+}
+
+
+//**************************************************************************
+//	ticks_to_deadline
+//--------------------------------------------------------------------------
+//
+static void ticks_to_deadline( TickType_t ticks, struct timespec *pDeadline )
+{
+	uint64_t	nanoSeconds = (uint64_t)ticks * portTICK_PERIOD_MS * 1000000;
+
+	clock_gettime( CLOCK_MONOTONIC, pDeadline );
+
+	nanoSeconds			+= (uint64_t)pDeadline->tv_nsec;
+	pDeadline->tv_sec	+= (time_t)(nanoSeconds / 1000000000);
+	pDeadline->tv_nsec	 = (long)(nanoSeconds % 1000000000);
+}
+
+
+//**************************************************************************
+//	queue_wait
+//--------------------------------------------------------------------------
+//	wait with the locked mutex until the queue has a free place
+//	('forSpace') or an item, returns false after 'ticks'
+//
+static bool queue_wait( StaticQueue_t *pQueue, TickType_t ticks, bool forSpace )
+{
+	struct timespec	deadline;
+
+	if( (0 != ticks) && (portMAX_DELAY != ticks) )
+	{
+		ticks_to_deadline( ticks, &deadline );
+	}
+
+	while( forSpace ? (pQueue->count == pQueue->length) : (0 == pQueue->count) )
+	{
+		if( 0 == ticks )
+		{
+			return( false );
+		}
+
+		if( portMAX_DELAY == ticks )
+		{
+			pthread_cond_wait( &(pQueue->changed), &(pQueue->mutex) );
+		}
+		else if( ETIMEDOUT == pthread_cond_timedwait( &(pQueue->changed), &(pQueue->mutex), &deadline ) )
+		{
+			ticks = 0;
+		}
+	}
+
+	return( true );
+}
+
+
+//**************************************************************************
+//	queue_send
+//--------------------------------------------------------------------------
+//
+static BaseType_t queue_send( QueueHandle_t queue, const void *pItem, TickType_t ticks, bool toFront )
+{
+	UBaseType_t	pos;
+
+	pthread_mutex_lock( &(queue->mutex) );
+
+	if( !queue_wait( queue, ticks, true ) )
+	{
+		pthread_mutex_unlock( &(queue->mutex) );
+		return( errQUEUE_FULL );
+	}
+
+	if( toFront )
+	{
+		queue->head	= (queue->head + queue->length - 1) % queue->length;
+		pos			= queue->head;
+	}
+	else
+	{
+		pos = (queue->head + queue->count) % queue->length;
+	}
+
+	memcpy( &(queue->pStorage[ pos * queue->itemSize ]), pItem, queue->itemSize );
+
+	queue->count++;
+
+	pthread_cond_broadcast( &(queue->changed) );
+	pthread_mutex_unlock( &(queue->mutex) );
+
+	return( pdPASS );
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	xTaskCreateStaticPinnedToCore
+//--------------------------------------------------------------------------
+//
+TaskHandle_t xTaskCreateStaticPinnedToCore(	TaskFunction_t	pFunc,
+											const char		*pName,
+											uint32_t		stackDepth,
+											void			*pParameter,
+											UBaseType_t		priority,
+											StackType_t		*pStack,
+											StaticTask_t	*pTaskBuffer,
+											BaseType_t		coreId			)
+{
+	char		threadName[ 16 ];
+	cpu_set_t	cpuSet;
+
+	(void)stackDepth;
+	(void)priority;
+	(void)pStack;
+
+	pthread_condattr_t	condAttr;
+
+	pTaskBuffer->pFunc			= pFunc;
+	pTaskBuffer->pParameter		= pParameter;
+	pTaskBuffer->coreId			= coreId;
+	pTaskBuffer->notifyValue	= 0;
+
+	pthread_condattr_init( &condAttr );
+	pthread_condattr_setclock( &condAttr, CLOCK_MONOTONIC );
+
+	pthread_mutex_init( &(pTaskBuffer->notifyMutex), NULL );
+	pthread_cond_init( &(pTaskBuffer->notifyCond), &condAttr );
+
+	pthread_condattr_destroy( &condAttr );
+
+	if( 0 != pthread_create( &(pTaskBuffer->thread), NULL, task_start, pTaskBuffer ) )
+	{
+		return( NULL );
+	}
+
+	//------------------------------------------------------------------
+	//	the name is shown by top and perf (max. 15 characters)
+	//
+	strncpy( threadName, pName, sizeof( threadName ) - 1 );
+	threadName[ sizeof( threadName ) - 1 ] = '\0';
+
+	pthread_setname_np( pTaskBuffer->thread, threadName );
+
+	if( (tskNO_AFFINITY != coreId) && (coreId < sysconf( _SC_NPROCESSORS_ONLN )) )
+	{
+		CPU_ZERO( &cpuSet );
+		CPU_SET( coreId, &cpuSet );
+
+		pthread_setaffinity_np( pTaskBuffer->thread, sizeof( cpu_set_t ), &cpuSet );
+	}
+
+	return( pTaskBuffer );
+}
+
+
+//**************************************************************************
+//	xTaskCreateStatic
+//--------------------------------------------------------------------------
+//
+TaskHandle_t xTaskCreateStatic(	TaskFunction_t	pFunc,
+								const char		*pName,
+								uint32_t		stackDepth,
+								void			*pParameter,
+								UBaseType_t		priority,
+								StackType_t		*pStack,
+								StaticTask_t	*pTaskBuffer	)
+{
+	return( xTaskCreateStaticPinnedToCore(	pFunc, pName, stackDepth, pParameter,
+											priority, pStack, pTaskBuffer, tskNO_AFFINITY	) );
+}
+
+
+//**************************************************************************
+//	vTaskDelay
+//--------------------------------------------------------------------------
+//
+void vTaskDelay( TickType_t ticks )
+{
+	struct timespec	deadline;
+
+	if( 0 == ticks )
+	{
+		sched_yield();
+		return;
+	}
+
+	ticks_to_deadline( ticks, &deadline );
+
+	while( EINTR == clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL ) )
+	{
+		;
+	}
+}
+
+
+//**************************************************************************
+//	xTaskGetTickCount
+//--------------------------------------------------------------------------
+//
+TickType_t xTaskGetTickCount( void )
+{
+	return( (TickType_t)(esp_timer_get_time() / (portTICK_PERIOD_MS * 1000)) );
+}
+
+
+//**************************************************************************
+//	xPortGetCoreID
+//--------------------------------------------------------------------------
+//	mapped onto the cores of an ESP32, so it can be used as index
+//
+BaseType_t xPortGetCoreID( void )
+{
+	int	cpu = sched_getcpu();
+
+	return( (0 > cpu) ? 0 : (BaseType_t)(cpu % portNUM_PROCESSORS) );
+}
+
+
+//**************************************************************************
+//	xTaskNotifyGive
+//--------------------------------------------------------------------------
+//
+BaseType_t xTaskNotifyGive( TaskHandle_t task )
+{
+	pthread_mutex_lock( &(task->notifyMutex) );
+
+	task->notifyValue++;
+
+	pthread_cond_signal( &(task->notifyCond) );
+	pthread_mutex_unlock( &(task->notifyMutex) );
+
+	return( pdPASS );
+}
+
+
+//**************************************************************************
+//	ulTaskNotifyTake
+//--------------------------------------------------------------------------
+//	must be called by a task created with xTaskCreateStatic...(),
+//	returns the notification value before it was decremented or cleared
+//
+uint32_t ulTaskNotifyTake( BaseType_t clearOnExit, TickType_t ticks )
+{
+	StaticTask_t	*pTask = pCurrentTask;
+	struct timespec	deadline;
+	uint32_t		value;
+
+	if( NULL == pTask )
+	{
+		vTaskDelay( ticks );
+		return( 0 );
+	}
+
+	if( (0 != ticks) && (portMAX_DELAY != ticks) )
+	{
+		ticks_to_deadline( ticks, &deadline );
+	}
+
+	pthread_mutex_lock( &(pTask->notifyMutex) );
+
+	while( (0 == pTask->notifyValue) && (0 != ticks) )
+	{
+		if( portMAX_DELAY == ticks )
+		{
+			pthread_cond_wait( &(pTask->notifyCond), &(pTask->notifyMutex) );
+		}
+		else if( ETIMEDOUT == pthread_cond_timedwait( &(pTask->notifyCond), &(pTask->notifyMutex), &deadline ) )
+		{
+			ticks = 0;
+		}
+	}
+
+	value = pTask->notifyValue;
+
+	if( 0 < value )
+	{
+		pTask->notifyValue = clearOnExit ? 0 : (value - 1);
+	}
+
+	pthread_mutex_unlock( &(pTask->notifyMutex) );
+
+	return( value );
+}
+
+
+//**************************************************************************
+//	xQueueCreateStatic
+//--------------------------------------------------------------------------
+//
+QueueHandle_t xQueueCreateStatic(	UBaseType_t		length,
+									UBaseType_t		itemSize,
+									uint8_t			*pStorage,
+									StaticQueue_t	*pQueueBuffer	)
+{
+	pthread_condattr_t	condAttr;
+
+	if( (0 == length) || (0 == itemSize) || (NULL == pStorage) )
+	{
+		return( NULL );
+	}
+
+	pthread_condattr_init( &condAttr );
+	pthread_condattr_setclock( &condAttr, CLOCK_MONOTONIC );
+
+	pthread_mutex_init( &(pQueueBuffer->mutex), NULL );
+	pthread_cond_init( &(pQueueBuffer->changed), &condAttr );
+
+	pthread_condattr_destroy( &condAttr );
+
+	pQueueBuffer->pStorage	= pStorage;
+	pQueueBuffer->length	= length;
+	pQueueBuffer->itemSize	= itemSize;
+	pQueueBuffer->head		= 0;
+	pQueueBuffer->count		= 0;
+
+	return( pQueueBuffer );
+}
+
+
+//**************************************************************************
+//	xQueueSendToBack
+//--------------------------------------------------------------------------
+//
+BaseType_t xQueueSendToBack( QueueHandle_t queue, const void *pItem, TickType_t ticks )
+{
+	return( queue_send( queue, pItem, ticks, false ) );
+}
+
+
+//**************************************************************************
+//	xQueueSendToFront
+//--------------------------------------------------------------------------
+//
+BaseType_t xQueueSendToFront( QueueHandle_t queue, const void *pItem, TickType_t ticks )
+{
+	return( queue_send( queue, pItem, ticks, true ) );
+}
+
+
+//**************************************************************************
+//	xQueueReceive
+//--------------------------------------------------------------------------
+//
+BaseType_t xQueueReceive( QueueHandle_t queue, void *pItem, TickType_t ticks )
+{
+	pthread_mutex_lock( &(queue->mutex) );
+
+	if( !queue_wait( queue, ticks, false ) )
+	{
+		pthread_mutex_unlock( &(queue->mutex) );
+		return( errQUEUE_EMPTY );
+	}
+
+	memcpy( pItem, &(queue->pStorage[ queue->head * queue->itemSize ]), queue->itemSize );
+
+	queue->head = (queue->head + 1) % queue->length;
+	queue->count--;
+
+	pthread_cond_broadcast( &(queue->changed) );
+	pthread_mutex_unlock( &(queue->mutex) );
+
+	return( pdPASS );
+}
+
+
+//**************************************************************************
+//	uxQueueMessagesWaiting
+//--------------------------------------------------------------------------
+//
+UBaseType_t uxQueueMessagesWaiting( QueueHandle_t queue )
+{
+	UBaseType_t	count;
+
+	pthread_mutex_lock( &(queue->mutex) );
+	count = queue->count;
+	pthread_mutex_unlock( &(queue->mutex) );
+
+	return( count );
+}
+
+
+//**************************************************************************
+//	xSemaphoreCreateRecursiveMutexStatic
+//--------------------------------------------------------------------------
+//
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic( StaticSemaphore_t *pMutexBuffer )
+{
+	pthread_mutexattr_t	attr;
+
+	pthread_mutexattr_init( &attr );
+	pthread_mutexattr_settype( &attr, PTHREAD_MUTEX_RECURSIVE );
+
+	pthread_mutex_init( &(pMutexBuffer->mutex), &attr );
+
+	pthread_mutexattr_destroy( &attr );
+
+	return( pMutexBuffer );
+}
+
+
+//**************************************************************************
+//	xSemaphoreTakeRecursive
+//--------------------------------------------------------------------------
+//
+BaseType_t xSemaphoreTakeRecursive( SemaphoreHandle_t mutex, TickType_t ticks )
+{
+	struct timespec	deadline;
+
+	if( portMAX_DELAY == ticks )
+	{
+		return( (0 == pthread_mutex_lock( &(mutex->mutex) )) ? pdTRUE : pdFALSE );
+	}
+
+	if( 0 == ticks )
+	{
+		return( (0 == pthread_mutex_trylock( &(mutex->mutex) )) ? pdTRUE : pdFALSE );
+	}
+
+	ticks_to_deadline( ticks, &deadline );
+
+	return( (0 == pthread_mutex_clocklock( &(mutex->mutex), CLOCK_MONOTONIC, &deadline )) ? pdTRUE : pdFALSE );
+}
+
+
+//**************************************************************************
+//	xSemaphoreGiveRecursive
+//--------------------------------------------------------------------------
+//
+BaseType_t xSemaphoreGiveRecursive( SemaphoreHandle_t mutex )
+{
+	return( (0 == pthread_mutex_unlock( &(mutex->mutex) )) ? pdTRUE : pdFALSE );
+}
@@ -0,0 +1,447 @@
+//##########################################################################
+//#
+//#		uart_posix.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	POSIX port: the ESP-IDF uart driver on a serial device of the host.
+//#	Any baud rate (e.g. 16667 for loconet) is set with termios2,
+//#	a read with timeout waits with epoll.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>		//	termios2, <termios.h> can not be used with it
+
+#include "esp_timer.h"
+#include "driver/uart.h"
+#include "hal/uart_hal.h"
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+typedef struct uart_posix
+{
+	const char	*pPath;
+	int			fd;
+	int			epollFd;
+	int			txPin;
+	int			rxPin;
+
+} uart_posix_t;
+
+
+//==========================================================================
+//
+//		G L O B A L   V A R I A B L E S
+//
+//==========================================================================
+
+uart_dev_t				uart_posix_dev[ UART_NUM_MAX ];
+
+static uart_posix_t		uarts[ UART_NUM_MAX ] =
+{
+	{ NULL, -1, -1, -1, -1 },
+	{ NULL, -1, -1, -1, -1 },
+	{ NULL, -1, -1, -1, -1 }
+};
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	get_uart
+//--------------------------------------------------------------------------
+//	returns NULL for an unknown or not installed uart
+//
+static uart_posix_t *get_uart( uart_port_t uartNum )
+{
+	if( (0 > uartNum) || (UART_NUM_MAX <= uartNum) || (0 > uarts[ uartNum ].fd) )
+	{
+		return( NULL );
+	}
+
+	return( &(uarts[ uartNum ]) );
+}
+
+
+//**************************************************************************
+//	wait_for
+//--------------------------------------------------------------------------
+//	wait until the device is readable or writable ('events'),
+//	'timeout' in ms, -1 => forever
+//
+static void wait_for( uart_posix_t *pUart, uint32_t events, int timeout )
+{
+	struct epoll_event	event;
+
+	event.events	= events;
+	event.data.fd	= pUart->fd;
+
+	epoll_ctl( pUart->epollFd, EPOLL_CTL_MOD, pUart->fd, &event );
+	epoll_wait( pUart->epollFd, &event, 1, timeout );
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	uart_posix_set_device
+//--------------------------------------------------------------------------
+//	'pPath' is not copied
+//
+esp_err_t uart_posix_set_device( uart_port_t uartNum, const char *pPath )
+{
+	if( (0 > uartNum) || (UART_NUM_MAX <= uartNum) || (0 <= uarts[ uartNum ].fd) )
+	{
+		return( ESP_ERR_INVALID_ARG );
+	}
+
+	uarts[ uartNum ].pPath = pPath;
+
+	return( ESP_OK );
+}
+
+
+//**************************************************************************
+//	uart_driver_install
+//--------------------------------------------------------------------------
+//	the buffers are the buffers of the serial driver of the host
+//
+esp_err_t uart_driver_install(	uart_port_t	uartNum,
+								int			rxBufferSize,
+								int			txBufferSize,
+								int			queueSize,
+								void		*pQueue,
+								int			intrAllocFlags	)
+{
+	struct epoll_event	event;
+	uart_posix_t		*pUart;
+
+	(void)rxBufferSize;
+	(void)txBufferSize;
+	(void)queueSize;
+	(void)pQueue;
+	(void)intrAllocFlags;
+
+	if( (0 > uartNum) || (UART_NUM_MAX <= uartNum) || (NULL == uarts[ uartNum ].pPath) )
+	{
+		return( ESP_ERR_INVALID_STATE );
+	}
+
+	pUart		= &(uarts[ uartNum ]);
+	pUart->fd	= open( pUart->pPath, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC );
+
+	if( 0 > pUart->fd )
+	{
+		return( ESP_FAIL );
+	}
+
+	pUart->epollFd = epoll_create1( EPOLL_CLOEXEC );
+
+	event.events	= EPOLLIN;
+	event.data.fd	= pUart->fd;
+
+	if( (0 > pUart->epollFd) || (0 != epoll_ctl( pUart->epollFd, EPOLL_CTL_ADD, pUart->fd, &event )) )
+	{
+		uart_driver_delete( uartNum );
+		return( ESP_FAIL );
+	}
+
+	return( ESP_OK );
+}
+
+
+//**************************************************************************
+//	uart_driver_delete
+//--------------------------------------------------------------------------
+//
+esp_err_t uart_driver_delete( uart_port_t uartNum )
+{
+	uart_posix_t	*pUart = get_uart( uartNum );
+
+	if( NULL == pUart )
+	{
+		return( ESP_ERR_INVALID_STATE );
+	}
+
+	if( 0 <= pUart->epollFd )
+	{
+		close( pUart->epollFd );
+	}
+
+	close( pUart->fd );
+
+	pUart->fd		= -1;
+	pUart->epollFd	= -1;
+
+	return( ESP_OK );
+}
+
+
+//**************************************************************************
+//	uart_param_config
+//--------------------------------------------------------------------------
+//	a device that is no tty (e.g. a fifo for tests) is accepted
+//	without any configuration
+//
+esp_err_t uart_param_config( uart_port_t uartNum, const uart_config_t *pConfig )
+{
+	uart_posix_t	*pUart = get_uart( uartNum );
+	struct termios2	tio;
+
+	if( NULL == pUart )
+	{
+		return( ESP_ERR_INVALID_STATE );
+	}
+
+	if( !isatty( pUart->fd ) )
+	{
+		return( ESP_OK );
+	}
+
+	if( 0 != ioctl( pUart->fd, TCGETS2, &tio ) )
+	{
+		return( ESP_FAIL );
+	}
+
+	tio.c_iflag	&= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY);
+	tio.c_oflag	&= ~OPOST;
+	tio.c_lflag	&= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+	tio.c_cflag	&= ~(CSIZE | PARENB | PARODD | CSTOPB | CBAUD | CRTSCTS);
+	tio.c_cflag	|= CREAD | CLOCAL | BOTHER;
+
+	switch( pConfig->data_bits )
+	{
+		case UART_DATA_5_BITS:	tio.c_cflag |= CS5;	break;
+		case UART_DATA_6_BITS:	tio.c_cflag |= CS6;	break;
+		case UART_DATA_7_BITS:	tio.c_cflag |= CS7;	break;
+		default:				tio.c_cflag |= CS8;	break;
+	}
+
+	if( UART_PARITY_DISABLE != pConfig->parity )
+	{
+		tio.c_cflag |= PARENB | ((UART_PARITY_ODD == pConfig->parity) ? PARODD : 0);
+	}
+
+	if( UART_STOP_BITS_1 != pConfig->stop_bits )
+	{
+		tio.c_cflag |= CSTOPB;
+	}
+
+	if( UART_HW_FLOWCTRL_DISABLE != pConfig->flow_ctrl )
+	{
+		tio.c_cflag |= CRTSCTS;
+	}
+
+	tio.c_ispeed		= (speed_t)pConfig->baud_rate;
+	tio.c_ospeed		= (speed_t)pConfig->baud_rate;
+	tio.c_cc[ VMIN ]	= 0;
+	tio.c_cc[ VTIME ]	= 0;
+
+	if( 0 != ioctl( pUart->fd, TCSETS2, &tio ) )
+	{
+		return( ESP_FAIL );
+	}
+
+	return( ESP_OK );
+}
+
+
+//**************************************************************************
+//	uart_set_pin
+//--------------------------------------------------------------------------
+//	the pins are only stored
+//
+esp_err_t uart_set_pin( uart_port_t uartNum, int txPin, int rxPin, int rtsPin, int ctsPin )
+{
+	uart_posix_t	*pUart = get_uart( uartNum );
+
+	(void)rtsPin;
+	(void)ctsPin;
+
+	if( NULL == pUart )
+	{
+		return( ESP_ERR_INVALID_STATE );
+	}
+
+	pUart->txPin = txPin;
+	pUart->rxPin = rxPin;
+
+	return( ESP_OK );
+}
+
+
+//**************************************************************************
+//	uart_set_line_inverse
+//--------------------------------------------------------------------------
+//	not possible on a host, the level converter must invert the lines
+//
+esp_err_t uart_set_line_inverse( uart_port_t uartNum, uint32_t inverseMask )
+{
+	(void)inverseMask;
+
+	return( (NULL == get_uart( uartNum )) ? ESP_ERR_INVALID_STATE : ESP_OK );
+}
+
+
+//**************************************************************************
+//	uart_set_mode
+//--------------------------------------------------------------------------
+//
+esp_err_t uart_set_mode( uart_port_t uartNum, uart_mode_t mode )
+{
+	(void)mode;
+
+	return( (NULL == get_uart( uartNum )) ? ESP_ERR_INVALID_STATE : ESP_OK );
+}
+
+
+//**************************************************************************
+//	uart_get_collision_flag
+//--------------------------------------------------------------------------
+//	there is no collision detection on a host, a collision is only
+//	seen by comparing the echo
+//
+esp_err_t uart_get_collision_flag( uart_port_t uartNum, bool *pCollision )
+{
+	*pCollision = false;
+
+	return( (NULL == get_uart( uartNum )) ? ESP_ERR_INVALID_STATE : ESP_OK );
+}
+
+
+//**************************************************************************
+//	uart_read_bytes
+//--------------------------------------------------------------------------
+//	read up to 'length' bytes, wait at most 'ticks' for them.
+//	Returns the number of bytes or -1 for an error.
+//
+int uart_read_bytes( uart_port_t uartNum, void *pBuffer, uint32_t length, TickType_t ticks )
+{
+	uart_posix_t	*pUart		= get_uart( uartNum );
+	uint8_t			*pData		= (uint8_t *)pBuffer;
+	int64_t			deadline	= esp_timer_get_time() + ((int64_t)ticks * portTICK_PERIOD_MS * 1000);
+	int64_t			remaining;
+	uint32_t		count		= 0;
+	ssize_t			result;
+
+	if( NULL == pUart )
+	{
+		return( -1 );
+	}
+
+	while( count < length )
+	{
+		result = read( pUart->fd, &(pData[ count ]), length - count );
+
+		if( 0 < result )
+		{
+			count += (uint32_t)result;
+			continue;
+		}
+
+		if( (0 > result) && (EAGAIN != errno) && (EINTR != errno) )
+		{
+			return( (0 < count) ? (int)count : -1 );
+		}
+
+		if( portMAX_DELAY == ticks )
+		{
+			wait_for( pUart, EPOLLIN, -1 );
+			continue;
+		}
+
+		remaining = deadline - esp_timer_get_time();
+
+		if( 0 >= remaining )
+		{
+			break;
+		}
+
+		wait_for( pUart, EPOLLIN, (int)((remaining + 999) / 1000) );
+	}
+
+	return( (int)count );
+}
+
+
+//**************************************************************************
+//	uart_write_bytes
+//--------------------------------------------------------------------------
+//	like the ESP-IDF function it blocks until all bytes are taken
+//
+int uart_write_bytes( uart_port_t uartNum, const void *pData, size_t size )
+{
+	uart_posix_t	*pUart	= get_uart( uartNum );
+	const uint8_t	*pBytes	= (const uint8_t *)pData;
+	size_t			count	= 0;
+	ssize_t			result;
+
+	if( NULL == pUart )
+	{
+		return( -1 );
+	}
+
+	while( count < size )
+	{
+		result = write( pUart->fd, &(pBytes[ count ]), size - count );
+
+		if( 0 < result )
+		{
+			count += (size_t)result;
+		}
+		else if( (0 > result) && ((EAGAIN == errno) || (EINTR == errno)) )
+		{
+			wait_for( pUart, EPOLLOUT, -1 );
+		}
+		else
+		{
+			return( -1 );
+		}
+	}
+
+	return( (int)count );
+}
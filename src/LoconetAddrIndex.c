@@ -0,0 +1,212 @@
+//##########################################################################
+//#
+//#		LoconetAddrIndex.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	A small hash index that maps a loco address (the key) to an
+//#	8 bit value, e.g. a slot number or a table index.
+//#	Insert, find and remove are O(1) on average.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "LoconetAddrIndex.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define INDEX_MASK			(LOCONET_ADDR_INDEX_SIZE - 1)
+#define INDEX_MAX_COUNT		((LOCONET_ADDR_INDEX_SIZE * 3) / 4)
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	hash_key
+//--------------------------------------------------------------------------
+//	multiplicative hash, loco addresses are often consecutive
+//
+static inline uint16_t hash_key( uint16_t key )
+{
+	return( (uint16_t)(((uint32_t)key * 40503u) >> 8) & INDEX_MASK );
+}
+
+
+//**************************************************************************
+//	find_pos
+//--------------------------------------------------------------------------
+//	returns the position of the key or of the empty entry
+//	where the key would be inserted
+//
+static uint16_t find_pos( loconet_addr_index_t *pIndex, uint16_t key )
+{
+	uint16_t	pos = hash_key( key );
+
+	while(		(LOCONET_ADDR_INDEX_NO_KEY != pIndex->key[ pos ])
+			&&	(key != pIndex->key[ pos ])						)
+	{
+		pos = (pos + 1) & INDEX_MASK;
+	}
+
+	return( pos );
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_addr_index_init
+//--------------------------------------------------------------------------
+//
+void loconet_addr_index_init( loconet_addr_index_t *pIndex )
+{
+	for( uint16_t pos = 0 ; LOCONET_ADDR_INDEX_SIZE > pos ; pos++ )
+	{
+		pIndex->key[ pos ]		= LOCONET_ADDR_INDEX_NO_KEY;
+		pIndex->value[ pos ]	= 0;
+	}
+
+	pIndex->count = 0;
+}
+
+
+//**************************************************************************
+//	loconet_addr_index_insert
+//--------------------------------------------------------------------------
+//	if the key is already in the index, its value will be replaced
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	index is full
+//		2	=>	invalid key
+//
+uint8_t loconet_addr_index_insert( loconet_addr_index_t *pIndex, uint16_t key, uint8_t value )
+{
+	uint16_t	pos;
+
+	if( LOCONET_ADDR_INDEX_NO_KEY == key )
+	{
+		return( 2 );
+	}
+
+	pos = find_pos( pIndex, key );
+
+	if( LOCONET_ADDR_INDEX_NO_KEY == pIndex->key[ pos ] )
+	{
+		if( INDEX_MAX_COUNT <= pIndex->count )
+		{
+			return( 1 );
+		}
+
+		pIndex->key[ pos ] = key;
+		pIndex->count++;
+	}
+
+	pIndex->value[ pos ] = value;
+
+	return( 0 );
+}
+
+
+//**************************************************************************
+//	loconet_addr_index_find
+//--------------------------------------------------------------------------
+//	returns true if the key was found
+//
+bool loconet_addr_index_find( loconet_addr_index_t *pIndex, uint16_t key, uint8_t *pValue )
+{
+	uint16_t	pos = find_pos( pIndex, key );
+
+	if( (LOCONET_ADDR_INDEX_NO_KEY == key) || (LOCONET_ADDR_INDEX_NO_KEY == pIndex->key[ pos ]) )
+	{
+		return( false );
+	}
+
+	*pValue = pIndex->value[ pos ];
+
+	return( true );
+}
+
+
+//**************************************************************************
+//	loconet_addr_index_remove
+//--------------------------------------------------------------------------
+//	the following entries of the probe chain are shifted back,
+//	so no 'deleted' markers are needed
+//
+void loconet_addr_index_remove( loconet_addr_index_t *pIndex, uint16_t key )
+{
+	uint16_t	hole;
+	uint16_t	pos;
+	uint16_t	home;
+
+	if( LOCONET_ADDR_INDEX_NO_KEY == key )
+	{
+		return;
+	}
+
+	hole = find_pos( pIndex, key );
+
+	if( LOCONET_ADDR_INDEX_NO_KEY == pIndex->key[ hole ] )
+	{
+		return;
+	}
+
+	pIndex->key[ hole ] = LOCONET_ADDR_INDEX_NO_KEY;
+	pIndex->count--;
+
+	for( pos = (hole + 1) & INDEX_MASK ; LOCONET_ADDR_INDEX_NO_KEY != pIndex->key[ pos ] ; pos = (pos + 1) & INDEX_MASK )
+	{
+		home = hash_key( pIndex->key[ pos ] );
+
+		//------------------------------------------------------------------
+		//	move the entry into the hole, if its home position
+		//	is not between the hole and its current position
+		//
+		if( ((pos - home) & INDEX_MASK) >= ((pos - hole) & INDEX_MASK) )
+		{
+			pIndex->key[ hole ]		= pIndex->key[ pos ];
+			pIndex->value[ hole ]	= pIndex->value[ pos ];
+			pIndex->key[ pos ]		= LOCONET_ADDR_INDEX_NO_KEY;
+			hole					= pos;
+		}
+	}
+}
@@ -32,8 +32,10 @@
 //==========================================================================
 
 #include <inttypes.h>
+#include <stdbool.h>
 
 #include "LoconetBus.h"
+#include "LoconetTrace.h"
 
 
 //==========================================================================
@@ -58,12 +60,16 @@
 
 void loconet_bus_init( loconet_bus_t *pBus )
 {
+	pBus->lock			= xSemaphoreCreateRecursiveMutexStatic( &(pBus->lockBuffer) );
 	pBus->numConsumers	= 0;
+	pBus->pActiveSender	= NULL;
+	pBus->isLoopback	= false;
 
 	for( uint8_t idx = 0 ; LOCONET_BUS_MAX_CONSUMERS > idx ; idx++ )
 	{
 		pBus->consumerArray[ idx ]		= NULL;
 		pBus->consumerFunctions[ idx ]	= NULL;
+		pBus->loopback[ idx ]			= false;
 	}
 }
 
@@ -72,15 +78,20 @@ uint8_t loconet_bus_register_consumer( loconet_bus_t *pBus, loconet_bus_consumer
 {
 	uint8_t	error = 1;
 
+	loconet_bus_lock( pBus );
+
 	if( LOCONET_BUS_MAX_CONSUMERS > pBus->numConsumers )
 	{
 		pBus->consumerArray[ pBus->numConsumers ]		= pConsumer;
 		pBus->consumerFunctions[ pBus->numConsumers ]	= pFunc;
+		pBus->loopback[ pBus->numConsumers ]			= false;
 		pBus->numConsumers++;
 
 		error = 0;
 	}
 
+	loconet_bus_unlock( pBus );
+
 	return( error );
 }
 
@@ -91,6 +102,7 @@ uint8_t loconet_bus_unregister_consumer( loconet_bus_t *pBus, loconet_bus_consum
 	uint8_t foundIdx	= LOCONET_BUS_MAX_CONSUMERS;
 	uint8_t	idx;
 
+	loconet_bus_lock( pBus );
 
 	//-----------------------------------------------------------------
 	//	first check if there are consumers in the array
@@ -124,14 +136,18 @@ uint8_t loconet_bus_unregister_consumer( loconet_bus_t *pBus, loconet_bus_consum
 			{
 				pBus->consumerArray[ foundIdx ]		= pBus->consumerArray[ idx ];
 				pBus->consumerFunctions[ foundIdx ]	= pBus->consumerFunctions[ idx ];
+				pBus->loopback[ foundIdx ]			= pBus->loopback[ idx ];
 			}
 
 			pBus->numConsumers--;
 			pBus->consumerArray[ pBus->numConsumers ]		= NULL;
 			pBus->consumerFunctions[ pBus->numConsumers ]	= NULL;
+			pBus->loopback[ pBus->numConsumers ]			= false;
 		}
 	}
 
+	loconet_bus_unlock( pBus );
+
 	return( error );
 }
 
@@ -139,6 +155,20 @@ uint8_t loconet_bus_unregister_consumer( loconet_bus_t *pBus, loconet_bus_consum
 void loconet_bus_broadcast( loconet_bus_t *pBus, LnMsg *pMsg, loconet_bus_consumer_func pSender )
 {
 	loconet_bus_consumer_func	pFunc;
+	loconet_bus_consumer_func	pPrevSender;
+	bool						prevLoopback;
+
+	loconet_bus_lock( pBus );
+
+	pPrevSender		= pBus->pActiveSender;
+	prevLoopback	= pBus->isLoopback;
+
+	//-----------------------------------------------------------------
+	//	a consumer may broadcast a reply, so the sender of the
+	//	outer broadcast must be restored afterwards
+	//
+	pBus->pActiveSender	= pSender;
+	pBus->isLoopback	= false;
 
 	for( uint8_t idx = 0 ; idx < pBus->numConsumers ; idx++ )
 	{
@@ -146,7 +176,124 @@ void loconet_bus_broadcast( loconet_bus_t *pBus, LnMsg *pMsg, loconet_bus_consum
 
 		if( pSender != pFunc )
 		{
+			LN_TRACE( LN_TRACE_CONSUMER_ENTER, idx );
+
 			(*pFunc)( pBus->consumerArray[ idx ], pMsg );
+
+			LN_TRACE( LN_TRACE_CONSUMER_EXIT, idx );
+		}
+	}
+
+	pBus->pActiveSender	= pPrevSender;
+	pBus->isLoopback	= prevLoopback;
+
+	loconet_bus_unlock( pBus );
+}
+
+
+uint8_t loconet_bus_set_loopback( loconet_bus_t *pBus, loconet_bus_consumer_func pFunc, bool enable )
+{
+	uint8_t	error = 1;	//	consumer not found
+
+	loconet_bus_lock( pBus );
+
+	for( uint8_t idx = 0 ; (idx < pBus->numConsumers) && (0 != error) ; idx++ )
+	{
+		if( pBus->consumerFunctions[ idx ] == pFunc )
+		{
+			pBus->loopback[ idx ]	= enable;
+			error					= 0;
+		}
+	}
+
+	loconet_bus_unlock( pBus );
+
+	return( error );
+}
+
+
+bool loconet_bus_has_loopback( loconet_bus_t *pBus )
+{
+	for( uint8_t idx = 0 ; idx < pBus->numConsumers ; idx++ )
+	{
+		if( pBus->loopback[ idx ] )
+		{
+			return( true );
+		}
+	}
+
+	return( false );
+}
+
+
+void loconet_bus_loopback( loconet_bus_t *pBus, LnMsg *pMsg, loconet_bus_consumer_func pSender )
+{
+	loconet_bus_consumer_func	pPrevSender;
+	bool						prevLoopback;
+
+	loconet_bus_lock( pBus );
+
+	pPrevSender		= pBus->pActiveSender;
+	prevLoopback	= pBus->isLoopback;
+
+	pBus->pActiveSender	= pSender;
+	pBus->isLoopback	= true;
+
+	for( uint8_t idx = 0 ; idx < pBus->numConsumers ; idx++ )
+	{
+		if( pBus->loopback[ idx ] )
+		{
+			LN_TRACE( LN_TRACE_CONSUMER_ENTER, idx );
+
+			(*pBus->consumerFunctions[ idx ])( pBus->consumerArray[ idx ], pMsg );
+
+			LN_TRACE( LN_TRACE_CONSUMER_EXIT, idx );
 		}
 	}
+
+	pBus->pActiveSender	= pPrevSender;
+	pBus->isLoopback	= prevLoopback;
+
+	loconet_bus_unlock( pBus );
+}
+
+
+void loconet_bus_lock( loconet_bus_t *pBus )
+{
+	xSemaphoreTakeRecursive( pBus->lock, portMAX_DELAY );
+}
+
+
+void loconet_bus_unlock( loconet_bus_t *pBus )
+{
+	xSemaphoreGiveRecursive( pBus->lock );
+}
+
+
+bool loconet_bus_is_loopback( loconet_bus_t *pBus )
+{
+	return( pBus->isLoopback );
+}
+
+
+loconet_bus_consumer_func loconet_bus_get_sender( loconet_bus_t *pBus )
+{
+	return( pBus->pActiveSender );
+}
+
+
+bool loconet_bus_is_safety_msg( const LnMsg *pMsg )
+{
+	switch( pMsg->sz.command )
+	{
+		case OPC_GPOFF:
+		case OPC_IDLE:
+			return( true );
+
+		case OPC_LOCO_SPD:
+			return( OPC_LOCO_SPD_ESTOP == pMsg->lsp.spd );
+
+		default:
+			return( false );
+	}
 }
@@ -0,0 +1,383 @@
+//##########################################################################
+//#
+//#		LoconetCapture.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library record all loconet
+//#	messages on the bus with a timestamp (us) and the id of the sender.
+//#	The bus consumer only copies the message into a lock-free ring,
+//#	a background task writes the records into a file.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <esp_timer.h>
+
+#include "LoconetMsgBuffer.h"
+#include "LoconetCapture.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+//	fwrite() and fflush() need most of it
+#define TASK_STACK_SIZE			3072
+
+#define MAX_RECORD_SIZE			(10 + 1 + LN_BUF_SIZE)
+
+
+//==========================================================================
+//
+//		G L O B A L   V A R I A B L E S
+//
+//==========================================================================
+
+static StaticTask_t	xCaptureTaskBuffer;
+static StackType_t	xCaptureStack[ TASK_STACK_SIZE ];
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	encode_record
+//--------------------------------------------------------------------------
+//	write the record into the buffer, returns the number of bytes
+//
+static uint8_t encode_record( loconet_capture_t *pCapture, loconet_capture_record_t *pRecord, uint8_t *pBuffer )
+{
+	uint64_t	delta	= pRecord->time - pCapture->lastTime;
+	uint8_t		length	= LOCONET_PACKET_SIZE( pRecord->msg.sz.command, pRecord->msg.sz.mesg_size );
+	uint8_t		count	= 0;
+
+	if( (2 > length) || (LN_BUF_SIZE < length) )
+	{
+		return( 0 );
+	}
+
+	pCapture->lastTime = pRecord->time;
+
+	while( 0x7F < delta )
+	{
+		pBuffer[ count++ ]	 = (uint8_t)(delta & 0x7F) | 0x80;
+		delta				>>= 7;
+	}
+
+	pBuffer[ count++ ] = (uint8_t)delta;
+	pBuffer[ count++ ] = pRecord->source;
+
+	memcpy( &(pBuffer[ count ]), pRecord->msg.data, length );
+
+	return( count + length );
+}
+
+
+//**************************************************************************
+//	capture_task
+//--------------------------------------------------------------------------
+//
+static void capture_task( void *pParameter )
+{
+	loconet_capture_t	*pCapture = (loconet_capture_t *)pParameter;
+
+	while( 1 )
+	{
+		loconet_capture_flush( pCapture );
+
+		vTaskDelay( pdMS_TO_TICKS( LOCONET_CAPTURE_FLUSH_PERIOD_MS ) );
+	}
+}
+
+
+//**************************************************************************
+//	write_out
+//--------------------------------------------------------------------------
+//	only the bytes that were written are counted
+//
+static void write_out( loconet_capture_t *pCapture, const uint8_t *pData, uint16_t length )
+{
+	size_t	written = fwrite( pData, 1, length, pCapture->pFile );
+
+	pCapture->cntBytes += written;
+
+	if( length != written )
+	{
+		pCapture->cntWriteErrors++;
+	}
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_capture_init
+//--------------------------------------------------------------------------
+//	return values:
+//		0	=>	okay
+//		1	=>	no free consumer entry on the bus
+//
+uint8_t loconet_capture_init( loconet_capture_t *pCapture, loconet_bus_t *pBus )
+{
+	memset( pCapture, 0, sizeof( loconet_capture_t ) );
+
+	pCapture->pBus = pBus;
+
+	atomic_init( &(pCapture->state), LN_CAPTURE_IDLE );
+
+	loconet_ring_init(	&(pCapture->ring),
+						pCapture->records,
+						sizeof( loconet_capture_record_t ),
+						LOCONET_CAPTURE_RING_SIZE			);
+
+	return( loconet_bus_register_consumer( pBus, pCapture, loconet_capture_process ) );
+}
+
+
+//**************************************************************************
+//	loconet_capture_register_source
+//--------------------------------------------------------------------------
+//	messages of the sender 'pFunc' (see loconet_bus_broadcast) will be
+//	recorded with the source 'id'
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	no free source entry
+//
+uint8_t loconet_capture_register_source( loconet_capture_t *pCapture, loconet_bus_consumer_func pFunc, uint8_t id )
+{
+	if( LOCONET_CAPTURE_MAX_SOURCES <= pCapture->numSources )
+	{
+		return( 1 );
+	}
+
+	pCapture->pSourceFunc[ pCapture->numSources ]	= pFunc;
+	pCapture->sourceId[ pCapture->numSources ]		= id;
+	pCapture->numSources++;
+
+	return( 0 );
+}
+
+
+//**************************************************************************
+//	loconet_capture_start
+//--------------------------------------------------------------------------
+//	writes the header into the file and starts recording.
+//	The file stays owned by the caller, it may be closed after
+//	loconet_capture_is_busy() returns false.
+//	The flush does not touch the ring while the capture is idle, so
+//	the records left over from the last recording are thrown away here.
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	capture is still busy
+//		2	=>	write error
+//
+uint8_t loconet_capture_start( loconet_capture_t *pCapture, FILE *pFile )
+{
+	loconet_capture_record_t	record;
+	uint8_t						header[ LOCONET_CAPTURE_HEADER_SIZE ];
+
+	if( loconet_capture_is_busy( pCapture ) )
+	{
+		return( 1 );
+	}
+
+	while( loconet_ring_pop( &(pCapture->ring), &record ) )
+	{
+		;
+	}
+
+	memcpy( header, LOCONET_CAPTURE_MAGIC, LOCONET_CAPTURE_HEADER_SIZE - 1 );
+	header[ LOCONET_CAPTURE_HEADER_SIZE - 1 ] = LOCONET_CAPTURE_VERSION;
+
+	if( 1 != fwrite( header, sizeof( header ), 1, pFile ) )
+	{
+		return( 2 );
+	}
+
+	pCapture->pFile		= pFile;
+	pCapture->lastTime	= 0;
+	pCapture->cntBytes	= sizeof( header );
+
+	atomic_store( &(pCapture->state), LN_CAPTURE_RECORDING );
+
+	return( 0 );
+}
+
+
+//**************************************************************************
+//	loconet_capture_stop
+//--------------------------------------------------------------------------
+//	no more messages will be recorded, the records that are still
+//	in the ring will be written by the next flush
+//
+void loconet_capture_stop( loconet_capture_t *pCapture )
+{
+	unsigned char	state = LN_CAPTURE_RECORDING;
+
+	atomic_compare_exchange_strong( &(pCapture->state), &state, LN_CAPTURE_DRAINING );
+}
+
+
+//**************************************************************************
+//	loconet_capture_is_busy
+//--------------------------------------------------------------------------
+//	returns true as long as the capture is recording or not all records
+//	are written to the file
+//
+bool loconet_capture_is_busy( loconet_capture_t *pCapture )
+{
+	return( LN_CAPTURE_IDLE != atomic_load( &(pCapture->state) ) );
+}
+
+
+//**************************************************************************
+//	loconet_capture_flush
+//--------------------------------------------------------------------------
+//	the records are collected in a buffer, so there are only a few
+//	writes to the file.
+//	The state is read once: the file can only be taken by a new start
+//	after this flush set the capture idle.
+//
+void loconet_capture_flush( loconet_capture_t *pCapture )
+{
+	loconet_capture_record_t	record;
+	uint8_t						*pOut		= pCapture->outBuffer;
+	uint16_t					outLength	= 0;
+	unsigned char				state		= atomic_load( &(pCapture->state) );
+
+	if( LN_CAPTURE_IDLE == state )
+	{
+		return;
+	}
+
+	while( loconet_ring_pop( &(pCapture->ring), &record ) )
+	{
+		outLength += encode_record( pCapture, &record, &(pOut[ outLength ]) );
+
+		if( (LOCONET_CAPTURE_OUT_BUFFER_SIZE - MAX_RECORD_SIZE) < outLength )
+		{
+			write_out( pCapture, pOut, outLength );
+
+			outLength = 0;
+		}
+	}
+
+	if( 0 < outLength )
+	{
+		write_out( pCapture, pOut, outLength );
+	}
+
+	if( 0 != fflush( pCapture->pFile ) )
+	{
+		pCapture->cntWriteErrors++;
+	}
+
+	if( LN_CAPTURE_DRAINING == state )
+	{
+		//--------------------------------------------------------------
+		//	recording was stopped before we emptied the ring,
+		//	so all records are written now
+		//
+		pCapture->pFile = NULL;
+
+		atomic_store( &(pCapture->state), LN_CAPTURE_IDLE );
+	}
+}
+
+
+//**************************************************************************
+//	loconet_capture_start_task
+//--------------------------------------------------------------------------
+//
+void loconet_capture_start_task( loconet_capture_t *pCapture )
+{
+	pCapture->flushTask = xTaskCreateStatic(	capture_task,
+												"LN_capture",
+												TASK_STACK_SIZE,
+												(void *)pCapture,
+												tskIDLE_PRIORITY,
+												xCaptureStack,
+												&xCaptureTaskBuffer	);
+}
+
+
+//**************************************************************************
+//	loconet_capture_process
+//--------------------------------------------------------------------------
+//	only a copy into the ring, so the broadcast is not slowed down.
+//	The ring has one producer: the broadcasts of all tasks are
+//	serialised by the bus lock (see loconet_bus_lock).
+//
+void loconet_capture_process( loconet_bus_consumer pConsumer, LnMsg *pMsg )
+{
+	loconet_capture_t			*pCapture	= (loconet_capture_t *)pConsumer;
+	loconet_bus_consumer_func	pSender;
+	loconet_capture_record_t	record;
+
+	if( LN_CAPTURE_RECORDING != atomic_load_explicit( &(pCapture->state), memory_order_relaxed ) )
+	{
+		return;
+	}
+
+	record.time		= (uint64_t)esp_timer_get_time();
+	record.source	= LOCONET_CAPTURE_SOURCE_UNKNOWN;
+	record.msg		= *pMsg;
+
+	pSender = loconet_bus_get_sender( pCapture->pBus );
+
+	for( uint8_t idx = 0 ; idx < pCapture->numSources ; idx++ )
+	{
+		if( pCapture->pSourceFunc[ idx ] == pSender )
+		{
+			record.source = pCapture->sourceId[ idx ];
+			break;
+		}
+	}
+
+	if( loconet_ring_push( &(pCapture->ring), &record ) )
+	{
+		pCapture->cntRecords++;
+	}
+	else
+	{
+		pCapture->cntDropped++;
+	}
+}
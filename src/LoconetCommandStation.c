@@ -0,0 +1,523 @@
+//##########################################################################
+//#
+//#		LoconetCommandStation.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library emulate the slot manager
+//#	of a command station. Slot requests, slot writes, moves and links
+//#	are answered with OPC_SL_RD_DATA or OPC_LONG_ACK like a real
+//#	command station does, speed and function messages update the slots.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ln_opc.h"
+#include "LoconetMsgBuffer.h"
+#include "LoconetCommandStation.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define SLOT_MSG_SIZE		0x0E
+
+#define LACK_ACCEPTED		0x7F
+#define LACK_REJECTED		0x00
+
+#define IS_LOCO_SLOT(s)		((0 < (s)) && (LOCONET_CS_NUM_SLOTS > (s)))
+#define SLOT_ADDRESS(p)		((uint16_t)((p)->adr | ((p)->adr2 << 7)))
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	send_slot
+//--------------------------------------------------------------------------
+//	reply the data of the slot with OPC_SL_RD_DATA
+//
+static void send_slot( loconet_command_station_t *pCs, uint8_t slot )
+{
+	LnMsg	aMsg;
+
+	aMsg.sd				= pCs->slots[ slot ];
+	aMsg.sd.command		= OPC_SL_RD_DATA;
+	aMsg.sd.mesg_size	= SLOT_MSG_SIZE;
+	aMsg.sd.slot		= slot;
+	aMsg.sd.trk			= pCs->trk;
+
+	loconet_msg_set_checksum( &aMsg );
+
+	pCs->cntReplies++;
+
+	loconet_bus_broadcast( pCs->pBus, &aMsg, loconet_command_station_process );
+}
+
+
+//**************************************************************************
+//	send_long_ack
+//--------------------------------------------------------------------------
+//
+static void send_long_ack( loconet_command_station_t *pCs, uint8_t opcode, uint8_t ack1 )
+{
+	LnMsg	aMsg;
+
+	memset( &aMsg, 0, sizeof( LnMsg ) );
+
+	aMsg.lack.command	= OPC_LONG_ACK;
+	aMsg.lack.opcode	= opcode & OPC_MASK;
+	aMsg.lack.ack1		= ack1;
+
+	loconet_msg_set_checksum( &aMsg );
+
+	pCs->cntReplies++;
+
+	if( LACK_REJECTED == ack1 )
+	{
+		pCs->cntRejects++;
+	}
+
+	loconet_bus_broadcast( pCs->pBus, &aMsg, loconet_command_station_process );
+}
+
+
+//**************************************************************************
+//	set_slot_address
+//--------------------------------------------------------------------------
+//	change the loco address of the slot and keep the address index
+//	up to date
+//
+static void set_slot_address( loconet_command_station_t *pCs, uint8_t slot, uint16_t address )
+{
+	rwSlotDataMsg	*pSlot	= &(pCs->slots[ slot ]);
+	uint16_t		old		= SLOT_ADDRESS( pSlot );
+	uint8_t			idxSlot;
+
+	if(		(0 != old)
+		&&	loconet_addr_index_find( &(pCs->addrIndex), old, &idxSlot )
+		&&	(idxSlot == slot)												)
+	{
+		loconet_addr_index_remove( &(pCs->addrIndex), old );
+	}
+
+	pSlot->adr	= (uint8_t)(address & 0x7F);
+	pSlot->adr2	= (uint8_t)((address >> 7) & 0x7F);
+
+	if( 0 != address )
+	{
+		loconet_addr_index_insert( &(pCs->addrIndex), address, slot );
+	}
+}
+
+
+//**************************************************************************
+//	alloc_slot
+//--------------------------------------------------------------------------
+//	returns the first free slot or 0 if all slots are in use.
+//	Slots that never had an address are preferred, so a purged loco
+//	finds its old slot again.
+//
+static uint8_t alloc_slot( loconet_command_station_t *pCs )
+{
+	uint8_t	freeSlot = 0;
+
+	for( uint8_t slot = 1 ; LOCONET_CS_NUM_SLOTS > slot ; slot++ )
+	{
+		if( LOCO_FREE == (pCs->slots[ slot ].stat & LOCOSTAT_MASK) )
+		{
+			if( 0 == SLOT_ADDRESS( &(pCs->slots[ slot ]) ) )
+			{
+				return( slot );
+			}
+
+			if( 0 == freeSlot )
+			{
+				freeSlot = slot;
+			}
+		}
+	}
+
+	return( freeSlot );
+}
+
+
+//**************************************************************************
+//	loco_adr
+//--------------------------------------------------------------------------
+//	OPC_LOCO_ADR: find or allocate the slot of the loco
+//
+static void loco_adr( loconet_command_station_t *pCs, LnMsg *pMsg )
+{
+	uint16_t	address	= (uint16_t)((pMsg->la.adr_hi << 7) | pMsg->la.adr_lo);
+	uint8_t		slot;
+
+	if( !loconet_addr_index_find( &(pCs->addrIndex), address, &slot ) )
+	{
+		slot = alloc_slot( pCs );
+
+		if( 0 == slot )
+		{
+			send_long_ack( pCs, OPC_LOCO_ADR, LACK_REJECTED );
+			return;
+		}
+
+		set_slot_address( pCs, slot, address );
+
+		pCs->slots[ slot ].stat	= LOCONET_CS_DEFAULT_DEC_MODE | LOCO_FREE;
+		pCs->slots[ slot ].spd	= 0;
+		pCs->slots[ slot ].dirf	= 0;
+		pCs->slots[ slot ].ss2	= 0;
+		pCs->slots[ slot ].snd	= 0;
+		pCs->slots[ slot ].id1	= 0;
+		pCs->slots[ slot ].id2	= 0;
+	}
+
+	send_slot( pCs, slot );
+}
+
+
+//**************************************************************************
+//	write_slot
+//--------------------------------------------------------------------------
+//	OPC_WR_SL_DATA: take over the slot data
+//
+static void write_slot( loconet_command_station_t *pCs, LnMsg *pMsg )
+{
+	uint8_t			slot	= pMsg->sd.slot;
+	rwSlotDataMsg	*pSlot;
+
+	if( !IS_LOCO_SLOT( slot ) )
+	{
+		send_long_ack( pCs, OPC_WR_SL_DATA, LACK_REJECTED );
+		return;
+	}
+
+	pSlot = &(pCs->slots[ slot ]);
+
+	set_slot_address( pCs, slot, SLOT_ADDRESS( &(pMsg->sd) ) );
+
+	pSlot->stat	= pMsg->sd.stat;
+	pSlot->spd	= pMsg->sd.spd;
+	pSlot->dirf	= pMsg->sd.dirf;
+	pSlot->ss2	= pMsg->sd.ss2;
+	pSlot->snd	= pMsg->sd.snd;
+	pSlot->id1	= pMsg->sd.id1;
+	pSlot->id2	= pMsg->sd.id2;
+
+	send_long_ack( pCs, OPC_WR_SL_DATA, LACK_ACCEPTED );
+}
+
+
+//**************************************************************************
+//	move_slots
+//--------------------------------------------------------------------------
+//	OPC_MOVE_SLOTS:
+//		src == dest	=>	null move, the slot becomes in use
+//		src == 0	=>	dispatch get
+//		dest == 0	=>	dispatch put
+//		otherwise	=>	move the data of src to the free slot dest
+//
+static void move_slots( loconet_command_station_t *pCs, LnMsg *pMsg )
+{
+	uint8_t	src		= pMsg->sm.src;
+	uint8_t	dest	= pMsg->sm.dest;
+
+	if( (0 == src) && (0 == dest) )
+	{
+		send_long_ack( pCs, OPC_MOVE_SLOTS, LACK_REJECTED );
+		return;
+	}
+
+	if( 0 == src )
+	{
+		if( 0 == pCs->dispatchSlot )
+		{
+			send_long_ack( pCs, OPC_MOVE_SLOTS, LACK_REJECTED );
+			return;
+		}
+
+		src					= pCs->dispatchSlot;
+		pCs->dispatchSlot	= 0;
+
+		pCs->slots[ src ].stat = (pCs->slots[ src ].stat & ~LOCOSTAT_MASK) | LOCO_IN_USE;
+
+		send_slot( pCs, src );
+		return;
+	}
+
+	if( !IS_LOCO_SLOT( src ) || (CONSISTED( pCs->slots[ src ].stat )) )
+	{
+		send_long_ack( pCs, OPC_MOVE_SLOTS, LACK_REJECTED );
+		return;
+	}
+
+	if( 0 == dest )
+	{
+		pCs->dispatchSlot		= src;
+		pCs->slots[ src ].stat	= (pCs->slots[ src ].stat & ~LOCOSTAT_MASK) | LOCO_COMMON;
+
+		send_slot( pCs, src );
+	}
+	else if( src == dest )
+	{
+		pCs->slots[ src ].stat = (pCs->slots[ src ].stat & ~LOCOSTAT_MASK) | LOCO_IN_USE;
+
+		send_slot( pCs, src );
+	}
+	else if(	IS_LOCO_SLOT( dest )
+			&&	(LOCO_FREE == (pCs->slots[ dest ].stat & LOCOSTAT_MASK))	)
+	{
+		uint16_t	address = SLOT_ADDRESS( &(pCs->slots[ src ]) );
+
+		set_slot_address( pCs, dest, 0 );
+		set_slot_address( pCs, src, 0 );
+
+		pCs->slots[ dest ]		= pCs->slots[ src ];
+		pCs->slots[ src ].stat	&= ~LOCOSTAT_MASK;
+
+		set_slot_address( pCs, dest, address );
+
+		if( pCs->dispatchSlot == src )
+		{
+			pCs->dispatchSlot = 0;
+		}
+
+		send_slot( pCs, dest );
+	}
+	else
+	{
+		send_long_ack( pCs, OPC_MOVE_SLOTS, LACK_REJECTED );
+	}
+}
+
+
+//**************************************************************************
+//	link_slots
+//--------------------------------------------------------------------------
+//	OPC_LINK_SLOTS / OPC_UNLINK_SLOTS: src is the slave, dest the master.
+//	The speed byte of a sub consisted slot holds the slot it is
+//	linked to.
+//
+static void link_slots( loconet_command_station_t *pCs, LnMsg *pMsg, bool link )
+{
+	uint8_t	src		= pMsg->sm.src;
+	uint8_t	dest	= pMsg->sm.dest;
+	uint8_t	opcode	= link ? OPC_LINK_SLOTS : OPC_UNLINK_SLOTS;
+
+	if( !IS_LOCO_SLOT( src ) || !IS_LOCO_SLOT( dest ) || (src == dest) )
+	{
+		send_long_ack( pCs, opcode, LACK_REJECTED );
+		return;
+	}
+
+	if( link )
+	{
+		if( STAT1_SL_CONUP & pCs->slots[ src ].stat )
+		{
+			send_long_ack( pCs, opcode, LACK_REJECTED );
+			return;
+		}
+
+		pCs->slots[ src ].stat	|= STAT1_SL_CONUP;
+		pCs->slots[ src ].spd	 = dest;
+		pCs->slots[ dest ].stat	|= STAT1_SL_CONDN;
+	}
+	else
+	{
+		bool	hasSlaves = false;
+
+		if(		(0 == (STAT1_SL_CONUP & pCs->slots[ src ].stat))
+			||	(dest != pCs->slots[ src ].spd)					)
+		{
+			send_long_ack( pCs, opcode, LACK_REJECTED );
+			return;
+		}
+
+		pCs->slots[ src ].stat	&= ~STAT1_SL_CONUP;
+		pCs->slots[ src ].spd	 = 0;
+
+		for( uint8_t slot = 1 ; LOCONET_CS_NUM_SLOTS > slot ; slot++ )
+		{
+			if(		(STAT1_SL_CONUP & pCs->slots[ slot ].stat)
+				&&	(dest == pCs->slots[ slot ].spd)			)
+			{
+				hasSlaves = true;
+				break;
+			}
+		}
+
+		if( !hasSlaves )
+		{
+			pCs->slots[ dest ].stat &= ~STAT1_SL_CONDN;
+		}
+	}
+
+	send_slot( pCs, dest );
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_command_station_init
+//--------------------------------------------------------------------------
+//	return values:
+//		0	=>	okay
+//		1	=>	no free consumer entry on the bus
+//
+uint8_t loconet_command_station_init( loconet_command_station_t *pCs, loconet_bus_t *pBus )
+{
+	memset( pCs, 0, sizeof( loconet_command_station_t ) );
+
+	pCs->pBus	= pBus;
+	pCs->trk	= GTRK_MLOK1 | GTRK_IDLE | GTRK_POWER;
+
+	for( uint8_t slot = 1 ; LOCONET_CS_NUM_SLOTS > slot ; slot++ )
+	{
+		pCs->slots[ slot ].stat = LOCONET_CS_DEFAULT_DEC_MODE | LOCO_FREE;
+	}
+
+	loconet_addr_index_init( &(pCs->addrIndex) );
+	return( loconet_bus_register_consumer( pBus, pCs, loconet_command_station_process ) );
+}
+
+
+//**************************************************************************
+//	loconet_command_station_get_slot
+//--------------------------------------------------------------------------
+//	returns NULL for an invalid slot number
+//
+const rwSlotDataMsg *loconet_command_station_get_slot( loconet_command_station_t *pCs, uint8_t slot )
+{
+	if( LOCONET_CS_NUM_SLOTS <= slot )
+	{
+		return( NULL );
+	}
+
+	return( &(pCs->slots[ slot ]) );
+}
+
+
+//**************************************************************************
+//	loconet_command_station_process
+//--------------------------------------------------------------------------
+//
+void loconet_command_station_process( loconet_bus_consumer pConsumer, LnMsg *pMsg )
+{
+	loconet_command_station_t	*pCs = (loconet_command_station_t *)pConsumer;
+	uint8_t						slot;
+
+	switch( pMsg->sz.command )
+	{
+		case OPC_LOCO_ADR:
+			pCs->cntRequests++;
+			loco_adr( pCs, pMsg );
+			break;
+
+		case OPC_RQ_SL_DATA:
+			pCs->cntRequests++;
+			if( LOCONET_CS_NUM_SLOTS > pMsg->sr.slot )
+			{
+				send_slot( pCs, pMsg->sr.slot );
+			}
+			break;
+
+		case OPC_WR_SL_DATA:
+			if( (FC_SLOT != pMsg->sd.slot) && (PRG_SLOT != pMsg->sd.slot) )
+			{
+				pCs->cntRequests++;
+				write_slot( pCs, pMsg );
+			}
+			break;
+
+		case OPC_MOVE_SLOTS:
+			pCs->cntRequests++;
+			move_slots( pCs, pMsg );
+			break;
+
+		case OPC_LINK_SLOTS:
+		case OPC_UNLINK_SLOTS:
+			pCs->cntRequests++;
+			link_slots( pCs, pMsg, OPC_LINK_SLOTS == pMsg->sz.command );
+			break;
+
+		case OPC_LOCO_SPD:
+		case OPC_LOCO_DIRF:
+		case OPC_LOCO_SND:
+		case OPC_SLOT_STAT1:
+			slot = pMsg->lsp.slot;
+
+			if( IS_LOCO_SLOT( slot ) )
+			{
+				if( OPC_LOCO_SPD == pMsg->sz.command )
+				{
+					pCs->slots[ slot ].spd = pMsg->lsp.spd;
+				}
+				else if( OPC_LOCO_DIRF == pMsg->sz.command )
+				{
+					pCs->slots[ slot ].dirf = pMsg->ldf.dirf;
+				}
+				else if( OPC_LOCO_SND == pMsg->sz.command )
+				{
+					pCs->slots[ slot ].snd = pMsg->ls.snd;
+				}
+				else
+				{
+					pCs->slots[ slot ].stat = pMsg->ss.stat;
+				}
+			}
+			break;
+
+		case OPC_GPON:
+			pCs->trk |= GTRK_POWER | GTRK_IDLE;
+			break;
+
+		case OPC_GPOFF:
+			pCs->trk &= ~GTRK_POWER;
+			break;
+
+		case OPC_IDLE:
+			pCs->trk &= ~GTRK_IDLE;
+			break;
+
+		default:
+			break;
+	}
+}
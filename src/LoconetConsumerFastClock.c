@@ -0,0 +1,313 @@
+//##########################################################################
+//#
+//#		LoconetConsumerFastClock.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library decode the fast clock
+//#	slot and interpolate the fast time locally between the updates
+//#	of the clock master. A query will never send anything to the bus.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <esp_timer.h>
+
+#include "ln_opc.h"
+#include "LoconetMsgBuffer.h"
+#include "LoconetConsumerFastClock.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define MS_PER_MINUTE			((uint64_t)60 * 1000)
+#define MS_PER_HOUR				(60 * MS_PER_MINUTE)
+#define MS_PER_DAY				(24 * MS_PER_HOUR)
+
+#define FC_CNTRL_VALID			0x40
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	fast_ms_at
+//--------------------------------------------------------------------------
+//	interpolate the fast time for the given (real) time
+//
+static uint64_t fast_ms_at( loconet_consumer_fast_clock_t *pClock, uint64_t now )
+{
+	uint64_t	fastMs	= pClock->anchorFastMs;
+	uint64_t	slewEnd	= pClock->slewEnd;
+
+	if( now <= pClock->anchorTime )
+	{
+		return( fastMs );
+	}
+
+	if( now <= slewEnd )
+	{
+		return( fastMs + ((now - pClock->anchorTime) * pClock->effectiveRate) / 1000000 );
+	}
+
+	if( slewEnd > pClock->anchorTime )
+	{
+		fastMs	+= ((slewEnd - pClock->anchorTime) * pClock->effectiveRate) / 1000000;
+	}
+	else
+	{
+		slewEnd	 = pClock->anchorTime;
+	}
+
+	return( fastMs + ((now - slewEnd) * pClock->rate * 1000) / 1000000 );
+}
+
+
+//**************************************************************************
+//	decode_fast_ms
+//--------------------------------------------------------------------------
+//	the clock master sends the minutes as (128 - 60 + minutes)
+//	and the hours as (128 - 24 + hours).
+//	The fractional minutes are not used, so the decoded time is
+//	the start of the minute.
+//
+static uint64_t decode_fast_ms( fastClockMsg *pMsg )
+{
+	int16_t	minutes	= (int16_t)(pMsg->mins_60  & 0x7F) - (128 - 60);
+	int16_t	hours	= (int16_t)(pMsg->hours_24 & 0x7F) - (128 - 24);
+
+	if( (0 > minutes) || (59 < minutes) )
+	{
+		minutes = ((minutes % 60) + 60) % 60;
+	}
+
+	if( (0 > hours) || (23 < hours) )
+	{
+		hours = ((hours % 24) + 24) % 24;
+	}
+
+	return(		(uint64_t)pMsg->days * MS_PER_DAY
+			+	(uint64_t)hours * MS_PER_HOUR
+			+	(uint64_t)minutes * MS_PER_MINUTE	);
+}
+
+
+//**************************************************************************
+//	update_clock
+//--------------------------------------------------------------------------
+//	take the time of the clock master.
+//	A small error will be corrected over LOCONET_FAST_CLOCK_SLEW_TIME_US
+//	without any jump of the local time, bigger errors or a frozen
+//	clock will be set directly.
+//
+static void update_clock( loconet_consumer_fast_clock_t *pClock, fastClockMsg *pMsg )
+{
+	uint64_t	now			= (uint64_t)esp_timer_get_time();
+	uint64_t	masterMs	= decode_fast_ms( pMsg );
+	uint64_t	localMs		= fast_ms_at( pClock, now );
+	int64_t		errorMs		= 0;
+	int64_t		rate		= (int64_t)pMsg->clk_rate * 1000;
+
+	atomic_fetch_add( &(pClock->sequence), 1 );
+
+	//------------------------------------------------------------------
+	//	the master time is the start of a fast minute,
+	//	so the local time is okay within the whole minute
+	//
+	if( localMs < masterMs )
+	{
+		errorMs = (int64_t)(masterMs - localMs);
+	}
+	else if( localMs >= (masterMs + MS_PER_MINUTE) )
+	{
+		errorMs = -(int64_t)(localMs - masterMs - MS_PER_MINUTE + 1);
+	}
+
+	if(		!pClock->valid
+		||	(0 == pMsg->clk_rate)
+		||	(LOCONET_FAST_CLOCK_MAX_SLEW_MS < errorMs)
+		||	(-LOCONET_FAST_CLOCK_MAX_SLEW_MS > errorMs)	)
+	{
+		pClock->anchorFastMs	= masterMs;
+		pClock->effectiveRate	= (uint32_t)rate;
+		pClock->cntJumps++;
+	}
+	else
+	{
+		//--------------------------------------------------------------
+		//	go on from the current local time with the new rate
+		//	plus the correction of the error
+		//
+		rate += (errorMs * 1000000) / LOCONET_FAST_CLOCK_SLEW_TIME_US;
+
+		pClock->anchorFastMs	= localMs;
+		pClock->effectiveRate	= (0 > rate) ? 0 : (uint32_t)rate;
+	}
+
+	pClock->anchorTime	= now;
+	pClock->slewEnd		= now + LOCONET_FAST_CLOCK_SLEW_TIME_US;
+	pClock->rate		= pMsg->clk_rate;
+	pClock->id			= (uint16_t)(pMsg->id1 | (pMsg->id2 << 7));
+	pClock->valid		= true;
+	pClock->cntUpdates++;
+
+	atomic_fetch_add( &(pClock->sequence), 1 );
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_consumer_fast_clock_init
+//--------------------------------------------------------------------------
+//	return values:
+//		0	=>	okay
+//		1	=>	no free consumer entry on the bus
+//
+uint8_t loconet_consumer_fast_clock_init( loconet_consumer_fast_clock_t *pClock, loconet_bus_t *pBus )
+{
+	memset( pClock, 0, sizeof( loconet_consumer_fast_clock_t ) );
+
+	pClock->pBus = pBus;
+	atomic_init( &(pClock->sequence), 0 );
+
+	return( loconet_bus_register_consumer( pBus, pClock, loconet_consumer_fast_clock_process ) );
+}
+
+
+//**************************************************************************
+//	loconet_fast_clock_get_ms
+//--------------------------------------------------------------------------
+//	returns the interpolated fast time in ms since day 0, 00:00
+//	can be called from any task
+//
+uint64_t loconet_fast_clock_get_ms( loconet_consumer_fast_clock_t *pClock )
+{
+	unsigned int	startSeq;
+	uint64_t		fastMs;
+
+	do
+	{
+		startSeq	= atomic_load( &(pClock->sequence) );
+		fastMs		= fast_ms_at( pClock, (uint64_t)esp_timer_get_time() );
+
+		atomic_thread_fence( memory_order_acquire );
+
+	} while( (startSeq & 1) || (startSeq != atomic_load( &(pClock->sequence) )) );
+
+	return( fastMs );
+}
+
+
+//**************************************************************************
+//	loconet_fast_clock_get_time
+//--------------------------------------------------------------------------
+//	returns true if the clock got at least one update from the master
+//
+bool loconet_fast_clock_get_time(	loconet_consumer_fast_clock_t	*pClock,
+									uint16_t						*pDays,
+									uint8_t							*pHours,
+									uint8_t							*pMinutes,
+									uint8_t							*pSeconds	)
+{
+	uint64_t	fastMs = loconet_fast_clock_get_ms( pClock );
+
+	*pDays		= (uint16_t)(fastMs / MS_PER_DAY);
+	*pHours		= (uint8_t)((fastMs % MS_PER_DAY)    / MS_PER_HOUR);
+	*pMinutes	= (uint8_t)((fastMs % MS_PER_HOUR)   / MS_PER_MINUTE);
+	*pSeconds	= (uint8_t)((fastMs % MS_PER_MINUTE) / 1000);
+
+	return( pClock->valid );
+}
+
+
+//**************************************************************************
+//	loconet_fast_clock_get_rate
+//--------------------------------------------------------------------------
+//
+uint8_t loconet_fast_clock_get_rate( loconet_consumer_fast_clock_t *pClock )
+{
+	return( pClock->rate );
+}
+
+
+//**************************************************************************
+//	loconet_fast_clock_request
+//--------------------------------------------------------------------------
+//	send a slot data request for the fast clock slot
+//
+void loconet_fast_clock_request( loconet_consumer_fast_clock_t *pClock )
+{
+	LnMsg	aMsg;
+
+	memset( &aMsg, 0, sizeof( LnMsg ) );
+
+	aMsg.sr.command	= OPC_RQ_SL_DATA;
+	aMsg.sr.slot	= FC_SLOT;
+	aMsg.sr.pad		= 0;
+
+	loconet_msg_set_checksum( &aMsg );
+	loconet_bus_broadcast( pClock->pBus, &aMsg, loconet_consumer_fast_clock_process );
+}
+
+
+//**************************************************************************
+//	loconet_consumer_fast_clock_process
+//--------------------------------------------------------------------------
+//
+void loconet_consumer_fast_clock_process( loconet_bus_consumer pConsumer, LnMsg *pMsg )
+{
+	loconet_consumer_fast_clock_t	*pClock = (loconet_consumer_fast_clock_t *)pConsumer;
+
+	switch( pMsg->sz.command )
+	{
+		case OPC_SL_RD_DATA:
+		case OPC_WR_SL_DATA:
+			if(		(FC_SLOT == pMsg->fc.slot)
+				&&	(pMsg->fc.clk_cntrl & FC_CNTRL_VALID)	)
+			{
+				update_clock( pClock, &(pMsg->fc) );
+			}
+			break;
+
+		default:
+			break;
+	}
+}
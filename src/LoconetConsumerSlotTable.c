@@ -0,0 +1,334 @@
+//##########################################################################
+//#
+//#		LoconetConsumerSlotTable.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library keep a mirror of the
+//#	slot table of the command station. Speed, direction and functions
+//#	of every loco can be read locally without asking the command station.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <esp_timer.h>
+
+#include "ln_opc.h"
+#include "LoconetConsumerSlotTable.h"
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	set_field
+//--------------------------------------------------------------------------
+//	returns the 'changedBit' if the value is different
+//
+static inline uint8_t set_field( uint8_t *pField, uint8_t value, uint8_t changedBit )
+{
+	if( *pField == value )
+	{
+		return( 0 );
+	}
+
+	*pField = value;
+
+	return( changedBit );
+}
+
+
+//**************************************************************************
+//	update_address_index
+//--------------------------------------------------------------------------
+//	only slots that are not free are in the index
+//
+static void update_address_index( loconet_consumer_slot_table_t *pTable, uint8_t slot, uint16_t oldAddress, bool wasInIndex )
+{
+	loconet_slot_t	*pSlot = &(pTable->slots[ slot ]);
+	uint8_t			indexSlot;
+
+	if( wasInIndex )
+	{
+		//------------------------------------------------------------------
+		//	remove the old address only if it still belongs to us
+		//
+		if( loconet_addr_index_find( &(pTable->addrIndex), oldAddress, &indexSlot ) && (indexSlot == slot) )
+		{
+			loconet_addr_index_remove( &(pTable->addrIndex), oldAddress );
+		}
+	}
+
+	if( LOCO_FREE != (pSlot->stat & LOCOSTAT_MASK) )
+	{
+		loconet_addr_index_insert( &(pTable->addrIndex), pSlot->address, slot );
+	}
+}
+
+
+//**************************************************************************
+//	read_slot_data
+//--------------------------------------------------------------------------
+//	take all data from a read or write slot data message
+//
+static uint8_t read_slot_data( loconet_consumer_slot_table_t *pTable, rwSlotDataMsg *pData )
+{
+	loconet_slot_t	*pSlot		= &(pTable->slots[ pData->slot ]);
+	uint16_t		oldAddress	= pSlot->address;
+	bool			wasInIndex	= pSlot->valid && (LOCO_FREE != (pSlot->stat & LOCOSTAT_MASK));
+	uint16_t		address		= (uint16_t)(pData->adr | (pData->adr2 << 7));
+	uint16_t		id			= (uint16_t)(pData->id1 | (pData->id2 << 7));
+	uint8_t			changed		= 0;
+
+	if( !pSlot->valid )
+	{
+		changed = 0xFF;
+	}
+
+	changed |= set_field( &(pSlot->stat), pData->stat,	LN_SLOT_CHANGED_STATUS );
+	changed |= set_field( &(pSlot->spd),  pData->spd,	LN_SLOT_CHANGED_SPEED );
+	changed |= set_field( &(pSlot->dirf), pData->dirf,	LN_SLOT_CHANGED_DIRF );
+	changed |= set_field( &(pSlot->snd),  pData->snd,	LN_SLOT_CHANGED_SOUND );
+	changed |= set_field( &(pSlot->trk),  pData->trk,	LN_SLOT_CHANGED_OTHER );
+	changed |= set_field( &(pSlot->ss2),  pData->ss2,	LN_SLOT_CHANGED_OTHER );
+
+	if( pSlot->address != address )
+	{
+		pSlot->address	 = address;
+		changed			|= LN_SLOT_CHANGED_ADDRESS;
+	}
+
+	if( pSlot->id != id )
+	{
+		pSlot->id	 = id;
+		changed		|= LN_SLOT_CHANGED_OTHER;
+	}
+
+	pSlot->valid = true;
+
+	if( changed & (LN_SLOT_CHANGED_ADDRESS | LN_SLOT_CHANGED_STATUS) )
+	{
+		update_address_index( pTable, pData->slot, oldAddress, wasInIndex );
+	}
+
+	return( changed );
+}
+
+
+//**************************************************************************
+//	notify_listeners
+//--------------------------------------------------------------------------
+//
+static void notify_listeners( loconet_consumer_slot_table_t *pTable, uint8_t slot, uint8_t changed )
+{
+	pTable->slots[ slot ].updateTime = (uint32_t)(esp_timer_get_time() / 1000);
+
+	if( 0 == changed )
+	{
+		return;
+	}
+
+	for( uint8_t idx = 0 ; idx < pTable->numListeners ; idx++ )
+	{
+		(*pTable->pNotifyFunc[ idx ])( pTable->pNotifyContext[ idx ], slot, changed );
+	}
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_consumer_slot_table_init
+//--------------------------------------------------------------------------
+//	return values:
+//		0	=>	okay
+//		1	=>	no free consumer entry on the bus
+//
+uint8_t loconet_consumer_slot_table_init( loconet_consumer_slot_table_t *pTable, loconet_bus_t *pBus )
+{
+	memset( pTable, 0, sizeof( loconet_consumer_slot_table_t ) );
+
+	pTable->pBus = pBus;
+
+	loconet_addr_index_init( &(pTable->addrIndex) );
+	return( loconet_bus_register_consumer( pBus, pTable, loconet_consumer_slot_table_process ) );
+}
+
+
+//**************************************************************************
+//	loconet_slot_table_register_notify
+//--------------------------------------------------------------------------
+//	return values:
+//		0	=>	okay
+//		1	=>	no free listener entry
+//
+uint8_t loconet_slot_table_register_notify( loconet_consumer_slot_table_t *pTable, loconet_slot_table_func_notify pFunc, void *pContext )
+{
+	if( LOCONET_SLOT_TABLE_MAX_LISTENERS <= pTable->numListeners )
+	{
+		return( 1 );
+	}
+
+	pTable->pNotifyFunc[ pTable->numListeners ]		= pFunc;
+	pTable->pNotifyContext[ pTable->numListeners ]	= pContext;
+	pTable->numListeners++;
+
+	return( 0 );
+}
+
+
+//**************************************************************************
+//	loconet_slot_table_get_slot
+//--------------------------------------------------------------------------
+//	returns NULL for an invalid slot number
+//
+const loconet_slot_t *loconet_slot_table_get_slot( loconet_consumer_slot_table_t *pTable, uint8_t slot )
+{
+	if( LOCONET_SLOT_TABLE_SIZE <= slot )
+	{
+		return( NULL );
+	}
+
+	return( &(pTable->slots[ slot ]) );
+}
+
+
+//**************************************************************************
+//	loconet_slot_table_find_address
+//--------------------------------------------------------------------------
+//	returns true if a slot (not free) with the loco address is known
+//
+bool loconet_slot_table_find_address( loconet_consumer_slot_table_t *pTable, uint16_t address, uint8_t *pSlot )
+{
+	return( loconet_addr_index_find( &(pTable->addrIndex), address, pSlot ) );
+}
+
+
+//**************************************************************************
+//	loconet_slot_table_set_slot
+//--------------------------------------------------------------------------
+//	the listeners are notified like for a slot that was read the
+//	first time
+//
+void loconet_slot_table_set_slot( loconet_consumer_slot_table_t *pTable, uint8_t slot, const loconet_slot_t *pData )
+{
+	loconet_slot_t	*pSlot;
+	uint16_t		oldAddress;
+	bool			wasInIndex;
+
+	if( LOCONET_SLOT_TABLE_SIZE <= slot )
+	{
+		return;
+	}
+
+	pSlot		= &(pTable->slots[ slot ]);
+	oldAddress	= pSlot->address;
+	wasInIndex	= pSlot->valid && (LOCO_FREE != (pSlot->stat & LOCOSTAT_MASK));
+
+	*pSlot = *pData;
+
+	update_address_index( pTable, slot, oldAddress, wasInIndex );
+
+	notify_listeners( pTable, slot, 0xFF );
+}
+
+
+//**************************************************************************
+//	loconet_consumer_slot_table_process
+//--------------------------------------------------------------------------
+//
+void loconet_consumer_slot_table_process( loconet_bus_consumer pConsumer, LnMsg *pMsg )
+{
+	loconet_consumer_slot_table_t	*pTable	= (loconet_consumer_slot_table_t *)pConsumer;
+	loconet_slot_t					*pSlot;
+	uint8_t							slot;
+	uint8_t							changed	= 0;
+
+	switch( pMsg->sz.command )
+	{
+		case OPC_SL_RD_DATA:
+		case OPC_WR_SL_DATA:
+			slot = pMsg->sd.slot;
+
+			if( LOCONET_SLOT_TABLE_SIZE > slot )
+			{
+				changed = read_slot_data( pTable, &(pMsg->sd) );
+				notify_listeners( pTable, slot, changed );
+			}
+			break;
+
+		case OPC_LOCO_SPD:
+		case OPC_LOCO_DIRF:
+		case OPC_LOCO_SND:
+		case OPC_SLOT_STAT1:
+			slot = pMsg->lsp.slot;
+
+			if( LOCONET_SLOT_TABLE_SIZE > slot )
+			{
+				pSlot = &(pTable->slots[ slot ]);
+
+				if( OPC_LOCO_SPD == pMsg->sz.command )
+				{
+					changed = set_field( &(pSlot->spd), pMsg->lsp.spd, LN_SLOT_CHANGED_SPEED );
+				}
+				else if( OPC_LOCO_DIRF == pMsg->sz.command )
+				{
+					changed = set_field( &(pSlot->dirf), pMsg->ldf.dirf, LN_SLOT_CHANGED_DIRF );
+				}
+				else if( OPC_LOCO_SND == pMsg->sz.command )
+				{
+					changed = set_field( &(pSlot->snd), pMsg->ls.snd, LN_SLOT_CHANGED_SOUND );
+				}
+				else
+				{
+					bool	wasInIndex	= pSlot->valid && (LOCO_FREE != (pSlot->stat & LOCOSTAT_MASK));
+
+					changed = set_field( &(pSlot->stat), pMsg->ss.stat, LN_SLOT_CHANGED_STATUS );
+
+					if( changed && pSlot->valid )
+					{
+						update_address_index( pTable, slot, pSlot->address, wasInIndex );
+					}
+				}
+
+				notify_listeners( pTable, slot, changed );
+			}
+			break;
+
+		default:
+			break;
+	}
+}
@@ -0,0 +1,426 @@
+//##########################################################################
+//#
+//#		LoconetConsumerStateCache.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library keep the last known state
+//#	of all sensors and switches (turnouts) of the loconet.
+//#	The states are held in packed bitmaps, so every query is O(1).
+//#	Every change gets a generation number, so a client (e.g. an UI)
+//#	can ask for all changes since its last refresh.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <esp_timer.h>
+
+#include "ln_opc.h"
+#include "LoconetConsumerStateCache.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define JOURNAL_MASK				(LOCONET_STATE_CACHE_JOURNAL_SIZE - 1)
+
+#define SENSOR_ITEM( address )		((uint16_t)((address) - 1))
+#define SWITCH_ITEM( address )		((uint16_t)(LOCONET_STATE_CACHE_MAX_SENSORS + (address) - 1))
+
+#define BIT_WORD( idx )				((idx) >> 5)
+#define BIT_MASK( idx )				((uint32_t)1 << ((idx) & 0x1F))
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	bitmap_get
+//--------------------------------------------------------------------------
+//
+static inline bool bitmap_get( const uint32_t *pBitmap, uint16_t idx )
+{
+	return( 0 != (pBitmap[ BIT_WORD( idx ) ] & BIT_MASK( idx )) );
+}
+
+
+//**************************************************************************
+//	bitmap_set
+//--------------------------------------------------------------------------
+//	set the bit to the given value, returns true if the bit changed
+//
+static inline bool bitmap_set( uint32_t *pBitmap, uint16_t idx, bool value )
+{
+	uint32_t	oldWord	= pBitmap[ BIT_WORD( idx ) ];
+	uint32_t	newWord	= value ? (oldWord | BIT_MASK( idx )) : (oldWord & ~BIT_MASK( idx ));
+
+	pBitmap[ BIT_WORD( idx ) ] = newWord;
+
+	return( oldWord != newWord );
+}
+
+
+//**************************************************************************
+//	record_change
+//--------------------------------------------------------------------------
+//	give the changed item a new generation and put it into the journal
+//
+static void record_change( loconet_consumer_state_cache_t *pCache, uint16_t item )
+{
+	uint32_t	generation = pCache->state.generation + 1;
+
+	pCache->state.generation			= generation;
+	pCache->changeGeneration[ item ]	= generation;
+	pCache->changeTime[ item ]			= (uint32_t)(esp_timer_get_time() / 1000);
+	pCache->journal[ generation & JOURNAL_MASK ] = item;
+}
+
+
+//**************************************************************************
+//	update_sensor
+//--------------------------------------------------------------------------
+//
+static void update_sensor( loconet_consumer_state_cache_t *pCache, uint16_t address, bool state )
+{
+	uint16_t	bit = address - 1;
+	bool		changed;
+
+	if( (0 == address) || (LOCONET_STATE_CACHE_MAX_SENSORS < address) )
+	{
+		return;
+	}
+
+	atomic_fetch_add( &(pCache->sequence), 1 );
+
+	changed  = bitmap_set( pCache->state.sensorState, bit, state );
+	changed |= bitmap_set( pCache->state.sensorKnown, bit, true );
+
+	if( changed )
+	{
+		record_change( pCache, SENSOR_ITEM( address ) );
+	}
+
+	atomic_fetch_add( &(pCache->sequence), 1 );
+}
+
+
+//**************************************************************************
+//	update_switch
+//--------------------------------------------------------------------------
+//	if 'positionValid' is false only the output state will be updated
+//
+static void update_switch( loconet_consumer_state_cache_t *pCache, uint16_t address, bool positionValid, bool closed, bool output )
+{
+	uint16_t	bit = address - 1;
+	bool		changed;
+
+	if( (0 == address) || (LOCONET_STATE_CACHE_MAX_SWITCHES < address) )
+	{
+		return;
+	}
+
+	atomic_fetch_add( &(pCache->sequence), 1 );
+
+	changed = bitmap_set( pCache->state.switchOutput, bit, output );
+
+	if( positionValid )
+	{
+		changed |= bitmap_set( pCache->state.switchClosed, bit, closed );
+		changed |= bitmap_set( pCache->state.switchKnown,  bit, true );
+	}
+
+	if( changed )
+	{
+		record_change( pCache, SWITCH_ITEM( address ) );
+	}
+
+	atomic_fetch_add( &(pCache->sequence), 1 );
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_consumer_state_cache_init
+//--------------------------------------------------------------------------
+//	all states are unknown after the init
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	no free consumer entry on the bus
+//
+uint8_t loconet_consumer_state_cache_init( loconet_consumer_state_cache_t *pCache, loconet_bus_t *pBus )
+{
+	memset( pCache, 0, sizeof( loconet_consumer_state_cache_t ) );
+
+	pCache->pBus = pBus;
+	atomic_init( &(pCache->sequence), 0 );
+
+	return( loconet_bus_register_consumer( pBus, pCache, loconet_consumer_state_cache_process ) );
+}
+
+
+//**************************************************************************
+//	loconet_state_cache_get_sensor
+//--------------------------------------------------------------------------
+//	returns true if the state of the sensor is known
+//
+bool loconet_state_cache_get_sensor( loconet_consumer_state_cache_t *pCache, uint16_t address, bool *pState )
+{
+	if( (0 == address) || (LOCONET_STATE_CACHE_MAX_SENSORS < address) )
+	{
+		return( false );
+	}
+
+	*pState = bitmap_get( pCache->state.sensorState, address - 1 );
+
+	return( bitmap_get( pCache->state.sensorKnown, address - 1 ) );
+}
+
+
+//**************************************************************************
+//	loconet_state_cache_get_switch
+//--------------------------------------------------------------------------
+//	returns true if the position of the switch is known
+//
+bool loconet_state_cache_get_switch( loconet_consumer_state_cache_t *pCache, uint16_t address, bool *pClosed, bool *pOutput )
+{
+	if( (0 == address) || (LOCONET_STATE_CACHE_MAX_SWITCHES < address) )
+	{
+		return( false );
+	}
+
+	*pClosed = bitmap_get( pCache->state.switchClosed, address - 1 );
+	*pOutput = bitmap_get( pCache->state.switchOutput, address - 1 );
+
+	return( bitmap_get( pCache->state.switchKnown, address - 1 ) );
+}
+
+
+//**************************************************************************
+//	loconet_state_cache_get_sensor_time
+//--------------------------------------------------------------------------
+//	returns the time of the last change in ms since start
+//
+uint32_t loconet_state_cache_get_sensor_time( loconet_consumer_state_cache_t *pCache, uint16_t address )
+{
+	if( (0 == address) || (LOCONET_STATE_CACHE_MAX_SENSORS < address) )
+	{
+		return( 0 );
+	}
+
+	return( pCache->changeTime[ SENSOR_ITEM( address ) ] );
+}
+
+
+//**************************************************************************
+//	loconet_state_cache_get_switch_time
+//--------------------------------------------------------------------------
+//	returns the time of the last change in ms since start
+//
+uint32_t loconet_state_cache_get_switch_time( loconet_consumer_state_cache_t *pCache, uint16_t address )
+{
+	if( (0 == address) || (LOCONET_STATE_CACHE_MAX_SWITCHES < address) )
+	{
+		return( 0 );
+	}
+
+	return( pCache->changeTime[ SWITCH_ITEM( address ) ] );
+}
+
+
+//**************************************************************************
+//	loconet_state_cache_get_generation
+//--------------------------------------------------------------------------
+//
+uint32_t loconet_state_cache_get_generation( loconet_consumer_state_cache_t *pCache )
+{
+	return( pCache->state.generation );
+}
+
+
+//**************************************************************************
+//	loconet_state_cache_changed_since
+//--------------------------------------------------------------------------
+//	this function will call 'pFunc' once for every item that changed
+//	after 'generation'. The current generation will be returned in
+//	'pNewGeneration' and should be used for the next call.
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	the journal does not reach back to 'generation',
+//				take a full snapshot instead
+//
+//	NOTE:
+//	this function must be called from the task that runs the bus.
+//
+uint8_t loconet_state_cache_changed_since(	loconet_consumer_state_cache_t	*pCache,
+											uint32_t						generation,
+											loconet_state_cache_func_delta	pFunc,
+											void							*pContext,
+											uint32_t						*pNewGeneration	)
+{
+	uint32_t	current = pCache->state.generation;
+	uint16_t	item;
+
+	*pNewGeneration = current;
+
+	if( (current - generation) > LOCONET_STATE_CACHE_JOURNAL_SIZE )
+	{
+		return( 1 );
+	}
+
+	for( uint32_t gen = generation + 1 ; gen != (current + 1) ; gen++ )
+	{
+		item = pCache->journal[ gen & JOURNAL_MASK ];
+
+		//------------------------------------------------------------------
+		//	if the item changed again later, it will be reported
+		//	with that later generation
+		//
+		if( gen == pCache->changeGeneration[ item ] )
+		{
+			if( LOCONET_STATE_CACHE_MAX_SENSORS > item )
+			{
+				(*pFunc)( pContext, LN_STATE_ITEM_SENSOR, item + 1 );
+			}
+			else
+			{
+				(*pFunc)( pContext, LN_STATE_ITEM_SWITCH, item - LOCONET_STATE_CACHE_MAX_SENSORS + 1 );
+			}
+		}
+	}
+
+	return( 0 );
+}
+
+
+//**************************************************************************
+//	loconet_state_cache_snapshot
+//--------------------------------------------------------------------------
+//	copy the complete state, can be called from any task
+//
+void loconet_state_cache_snapshot( loconet_consumer_state_cache_t *pCache, loconet_state_snapshot_t *pSnapshot )
+{
+	unsigned int	startSeq;
+
+	do
+	{
+		startSeq = atomic_load( &(pCache->sequence) );
+
+		memcpy( pSnapshot, &(pCache->state), sizeof( loconet_state_snapshot_t ) );
+
+		atomic_thread_fence( memory_order_acquire );
+
+	} while( (startSeq & 1) || (startSeq != atomic_load( &(pCache->sequence) )) );
+}
+
+
+//**************************************************************************
+//	loconet_state_cache_set_sensor
+//--------------------------------------------------------------------------
+//
+void loconet_state_cache_set_sensor( loconet_consumer_state_cache_t *pCache, uint16_t address, bool state )
+{
+	update_sensor( pCache, address, state );
+}
+
+
+//**************************************************************************
+//	loconet_state_cache_set_switch
+//--------------------------------------------------------------------------
+//
+void loconet_state_cache_set_switch( loconet_consumer_state_cache_t *pCache, uint16_t address, bool closed, bool output )
+{
+	update_switch( pCache, address, true, closed, output );
+}
+
+
+//**************************************************************************
+//	loconet_consumer_state_cache_process
+//--------------------------------------------------------------------------
+//	the addresses are decoded the same way as in
+//	loconet_consumer_switch_sensor_process()
+//
+void loconet_consumer_state_cache_process( loconet_bus_consumer pConsumer, LnMsg *pMsg )
+{
+	loconet_consumer_state_cache_t	*pCache	= (loconet_consumer_state_cache_t *)pConsumer;
+	uint16_t	Address;
+	bool		closed;
+	bool		thrown;
+
+
+	Address = (pMsg->srq.sw1 | ((pMsg->srq.sw2 & 0x0F) << 7));
+
+	switch( pMsg->sz.command )
+	{
+		case OPC_INPUT_REP:
+			Address <<= 1;
+			Address += (pMsg->ir.in2 & OPC_INPUT_REP_SW) ? 2 : 1;
+
+			update_sensor( pCache, Address, 0 != (pMsg->ir.in2 & OPC_INPUT_REP_HI) );
+			break;
+
+		case OPC_SW_REQ:
+		case OPC_SW_ACK:
+			update_switch(	pCache,
+							Address + 1,
+							true,
+							0 != (pMsg->srq.sw2 & OPC_SW_REQ_DIR),
+							0 != (pMsg->srq.sw2 & OPC_SW_REQ_OUT)	);
+			break;
+
+		case OPC_SW_REP:
+			if( 0 == (pMsg->srp.sn2 & OPC_SW_REP_INPUTS) )
+			{
+				//----------------------------------------------------------
+				//	output status report, if no line is on the
+				//	position is not changed
+				//
+				closed = (0 != (pMsg->srp.sn2 & OPC_SW_REP_CLOSED));
+				thrown = (0 != (pMsg->srp.sn2 & OPC_SW_REP_THROWN));
+
+				update_switch( pCache, Address + 1, closed != thrown, closed, closed || thrown );
+			}
+			break;
+
+		default:
+			break;
+	}
+}
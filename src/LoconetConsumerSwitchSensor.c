@@ -33,6 +33,9 @@
 //==========================================================================
 
 #include <inttypes.h>
+#include <string.h>
+
+#include <esp_timer.h>
 
 #include "ln_opc.h"
 #include "LoconetConsumerSwitchSensor.h"
@@ -48,6 +51,15 @@
 	#define NULL	((void *)0)
 #endif
 
+#define DEBOUNCE_NO_ENTRY		0xFFFF
+#define DEBOUNCE_WHEEL_MASK		(LOCONET_DEBOUNCE_WHEEL_SLOTS - 1)
+#define DEBOUNCE_TICK_US		((uint64_t)LOCONET_DEBOUNCE_TICK_MS * 1000)
+
+#define DEBOUNCE_FLAG_REPORTED	0x01	//	state that was reported last
+#define DEBOUNCE_FLAG_PENDING	0x02	//	state that waits for the hold-off
+#define DEBOUNCE_FLAG_KNOWN		0x04	//	a state was reported
+#define DEBOUNCE_FLAG_ARMED		0x08	//	sensor is linked into the wheel
+
 
 //==========================================================================
 //
@@ -56,6 +68,473 @@
 //==========================================================================
 
 
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	listener_index_init
+//--------------------------------------------------------------------------
+//	an empty index has one segment without any listener
+//
+static void listener_index_init( loconet_consumer_listener_index_t *pIndex )
+{
+	memset( pIndex, 0, sizeof( loconet_consumer_listener_index_t ) );
+
+	pIndex->numSegments = 1;
+}
+
+
+//**************************************************************************
+//	insert_border
+//--------------------------------------------------------------------------
+//	insert a segment border into the sorted array, if it is not
+//	already there. Returns the new number of borders.
+//
+static uint8_t insert_border( uint16_t *pBorders, uint8_t num, uint16_t border )
+{
+	uint8_t	idx;
+
+	for( idx = 0 ; idx < num ; idx++ )
+	{
+		if( pBorders[ idx ] == border )
+		{
+			return( num );
+		}
+	}
+
+	for( idx = num ; (0 < idx) && (pBorders[ idx - 1 ] > border) ; idx-- )
+	{
+		pBorders[ idx ] = pBorders[ idx - 1 ];
+	}
+
+	pBorders[ idx ] = border;
+
+	return( num + 1 );
+}
+
+
+//**************************************************************************
+//	listener_index_rebuild
+//--------------------------------------------------------------------------
+//	will be called after a listener was added or removed
+//
+static void listener_index_rebuild( loconet_consumer_listener_index_t *pIndex )
+{
+	loconet_consumer_listener_t	*pListener;
+	uint16_t					start;
+	uint8_t						num = 0;
+
+	num = insert_border( pIndex->segmentStart, num, 0 );
+
+	for( uint8_t idx = 0 ; LOCONET_CONSUMER_MAX_LISTENERS > idx ; idx++ )
+	{
+		if( pIndex->usedMask & ((uint32_t)1 << idx) )
+		{
+			pListener	= &(pIndex->listeners[ idx ]);
+			num			= insert_border( pIndex->segmentStart, num, pListener->firstAddress );
+			num			= insert_border( pIndex->segmentStart, num, pListener->lastAddress + 1 );
+		}
+	}
+
+	for( uint8_t seg = 0 ; seg < num ; seg++ )
+	{
+		start							= pIndex->segmentStart[ seg ];
+		pIndex->segmentMask[ seg ]	= 0;
+
+		for( uint8_t idx = 0 ; LOCONET_CONSUMER_MAX_LISTENERS > idx ; idx++ )
+		{
+			pListener = &(pIndex->listeners[ idx ]);
+
+			if(		(pIndex->usedMask & ((uint32_t)1 << idx))
+				&&	(pListener->firstAddress <= start)
+				&&	(pListener->lastAddress  >= start)		)
+			{
+				pIndex->segmentMask[ seg ] |= ((uint32_t)1 << idx);
+			}
+		}
+	}
+
+	pIndex->numSegments = num;
+}
+
+
+//**************************************************************************
+//	listener_index_lookup
+//--------------------------------------------------------------------------
+//	binary search for the segment of the address,
+//	returns the mask of the listeners for this segment
+//
+static uint32_t listener_index_lookup( loconet_consumer_listener_index_t *pIndex, uint16_t address )
+{
+	uint8_t	low		= 0;
+	uint8_t	high	= pIndex->numSegments - 1;
+	uint8_t	mid;
+
+	while( low < high )
+	{
+		mid = (low + high + 1) / 2;
+
+		if( pIndex->segmentStart[ mid ] <= address )
+		{
+			low = mid;
+		}
+		else
+		{
+			high = mid - 1;
+		}
+	}
+
+	return( pIndex->segmentMask[ low ] );
+}
+
+
+//**************************************************************************
+//	listener_index_add
+//--------------------------------------------------------------------------
+//	the handle holds the generation of the entry, the function index
+//	and the entry index + 1, so it is never 0 and a handle of a
+//	removed listener does not match a new one in the same entry
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	no free listener entry
+//		2	=>	invalid address range
+//		4	=>	no listener function
+//
+static uint8_t listener_index_add(	loconet_consumer_listener_index_t		*pIndex,
+									uint8_t									funcIdx,
+									uint16_t								firstAddress,
+									uint16_t								lastAddress,
+									const uint32_t							*pAddressSet,
+									loconet_consumer_func_listener_sensor	pSensorFunc,
+									loconet_consumer_func_listener_switch	pSwitchFunc,
+									void									*pContext,
+									loconet_consumer_listener_handle_t		*pHandle		)
+{
+	loconet_consumer_listener_t	*pListener;
+
+	if( (NULL == pSensorFunc) && (NULL == pSwitchFunc) )
+	{
+		return( 4 );
+	}
+
+	if( (firstAddress > lastAddress) || (0xFFFF == lastAddress) )
+	{
+		return( 2 );
+	}
+
+	for( uint8_t idx = 0 ; LOCONET_CONSUMER_MAX_LISTENERS > idx ; idx++ )
+	{
+		if( 0 == (pIndex->usedMask & ((uint32_t)1 << idx)) )
+		{
+			pListener = &(pIndex->listeners[ idx ]);
+
+			pListener->pSensorFunc	= pSensorFunc;
+			pListener->pSwitchFunc	= pSwitchFunc;
+			pListener->pContext		= pContext;
+			pListener->pAddressSet	= pAddressSet;
+			pListener->firstAddress	= firstAddress;
+			pListener->lastAddress	= lastAddress;
+			pListener->generation++;
+
+			pIndex->usedMask |= ((uint32_t)1 << idx);
+
+			listener_index_rebuild( pIndex );
+
+			if( NULL != pHandle )
+			{
+				*pHandle = ((uint32_t)pListener->generation << 16) | ((uint32_t)funcIdx << 8) | (idx + 1);
+			}
+
+			return( 0 );
+		}
+	}
+
+	return( 1 );
+}
+
+
+//**************************************************************************
+//	listener_matches
+//--------------------------------------------------------------------------
+//
+static bool listener_matches( loconet_consumer_listener_t *pListener, uint16_t address )
+{
+	if( NULL == pListener->pAddressSet )
+	{
+		return( true );
+	}
+
+	return( 0 != (pListener->pAddressSet[ (address - 1) >> 5 ] & ((uint32_t)1 << ((address - 1) & 0x1F))) );
+}
+
+
+//**************************************************************************
+//	notify_sensor
+//--------------------------------------------------------------------------
+//	call the registered notify function and all matching listeners
+//
+static void notify_sensor( loconet_consumer_switch_sensor_t *pConsumer, uint16_t address, bool state )
+{
+	loconet_consumer_listener_index_t	*pIndex	= &(pConsumer->listenerIndex[ NOTIFY_FUNC_IDX_SENSOR ]);
+	loconet_consumer_listener_t			*pListener;
+	uint32_t							mask;
+
+	if( pConsumer->pNotifySensor )
+	{
+		(*pConsumer->pNotifySensor)( address, state );
+	}
+
+	mask = listener_index_lookup( pIndex, address );
+
+	while( mask )
+	{
+		pListener	 = &(pIndex->listeners[ __builtin_ctz( mask ) ]);
+		mask		&= mask - 1;
+
+		if( listener_matches( pListener, address ) )
+		{
+			(*pListener->pSensorFunc)( pListener->pContext, address, state );
+		}
+	}
+}
+
+
+//**************************************************************************
+//	notify_switch
+//--------------------------------------------------------------------------
+//	call the registered notify function and all matching listeners
+//
+static void notify_switch(	loconet_consumer_switch_sensor_t	*pConsumer,
+							uint8_t								funcIdx,
+							loconet_consumer_func_notify_switch	pNotifyFunc,
+							uint16_t							address,
+							bool								output,
+							bool								direction	)
+{
+	loconet_consumer_listener_index_t	*pIndex	= &(pConsumer->listenerIndex[ funcIdx ]);
+	loconet_consumer_listener_t			*pListener;
+	uint32_t							mask;
+
+	if( pNotifyFunc )
+	{
+		(*pNotifyFunc)( address, output, direction );
+	}
+
+	mask = listener_index_lookup( pIndex, address );
+
+	while( mask )
+	{
+		pListener	 = &(pIndex->listeners[ __builtin_ctz( mask ) ]);
+		mask		&= mask - 1;
+
+		if( listener_matches( pListener, address ) )
+		{
+			(*pListener->pSwitchFunc)( pListener->pContext, address, output, direction );
+		}
+	}
+}
+
+
+//**************************************************************************
+//	debounce_get_hold_off
+//--------------------------------------------------------------------------
+//	the last matching range wins, so single addresses can be
+//	added after a wider range
+//
+static uint16_t debounce_get_hold_off( loconet_sensor_debounce_t *pDebounce, uint16_t address )
+{
+	uint16_t	holdOffMs = pDebounce->defaultHoldOffMs;
+
+	for( uint8_t idx = 0 ; idx < pDebounce->numRanges ; idx++ )
+	{
+		if(		(pDebounce->ranges[ idx ].firstAddress <= address)
+			&&	(pDebounce->ranges[ idx ].lastAddress  >= address)	)
+		{
+			holdOffMs = pDebounce->ranges[ idx ].holdOffMs;
+		}
+	}
+
+	return( holdOffMs );
+}
+
+
+//**************************************************************************
+//	debounce_arm
+//--------------------------------------------------------------------------
+//	link the sensor into the wheel slot of its expiry tick
+//
+static void debounce_arm( loconet_sensor_debounce_t *pDebounce, uint16_t idx, uint16_t holdOffMs )
+{
+	loconet_debounce_sensor_t	*pSensor	= &(pDebounce->sensors[ idx ]);
+	uint32_t					ticks		= (holdOffMs + LOCONET_DEBOUNCE_TICK_MS - 1) / LOCONET_DEBOUNCE_TICK_MS;
+	uint16_t					slot;
+
+	slot				= (pDebounce->currentTick + ticks) & DEBOUNCE_WHEEL_MASK;
+	pSensor->slot		= (uint8_t)slot;
+	pSensor->rounds		= (ticks - 1) / LOCONET_DEBOUNCE_WHEEL_SLOTS;
+	pSensor->prev		= DEBOUNCE_NO_ENTRY;
+	pSensor->next		= pDebounce->wheel[ slot ];
+	pSensor->flags	   |= DEBOUNCE_FLAG_ARMED;
+
+	if( DEBOUNCE_NO_ENTRY != pSensor->next )
+	{
+		pDebounce->sensors[ pSensor->next ].prev = idx;
+	}
+
+	pDebounce->wheel[ slot ] = idx;
+}
+
+
+//**************************************************************************
+//	debounce_disarm
+//--------------------------------------------------------------------------
+//	unlink the sensor from its wheel slot
+//
+static void debounce_disarm( loconet_sensor_debounce_t *pDebounce, uint16_t idx )
+{
+	loconet_debounce_sensor_t	*pSensor = &(pDebounce->sensors[ idx ]);
+
+	if( DEBOUNCE_NO_ENTRY != pSensor->prev )
+	{
+		pDebounce->sensors[ pSensor->prev ].next = pSensor->next;
+	}
+	else
+	{
+		pDebounce->wheel[ pSensor->slot ] = pSensor->next;
+	}
+
+	if( DEBOUNCE_NO_ENTRY != pSensor->next )
+	{
+		pDebounce->sensors[ pSensor->next ].prev = pSensor->prev;
+	}
+
+	pSensor->next	 = DEBOUNCE_NO_ENTRY;
+	pSensor->prev	 = DEBOUNCE_NO_ENTRY;
+	pSensor->flags	&= ~DEBOUNCE_FLAG_ARMED;
+}
+
+
+//**************************************************************************
+//	debounce_sensor
+//--------------------------------------------------------------------------
+//	handle a new (raw) sensor state
+//
+static void debounce_sensor( loconet_consumer_switch_sensor_t *pConsumer, uint16_t address, bool state )
+{
+	loconet_sensor_debounce_t	*pDebounce	= pConsumer->pDebounce;
+	loconet_debounce_sensor_t	*pSensor;
+	uint16_t					idx			= address - 1;
+	uint16_t					holdOffMs;
+	bool						reported;
+
+	if( (0 == address) || (LOCONET_DEBOUNCE_MAX_SENSORS < address) )
+	{
+		notify_sensor( pConsumer, address, state );
+		return;
+	}
+
+	pSensor		= &(pDebounce->sensors[ idx ]);
+	holdOffMs	= debounce_get_hold_off( pDebounce, address );
+	reported	= (0 != (pSensor->flags & DEBOUNCE_FLAG_REPORTED));
+
+	if( pSensor->flags & DEBOUNCE_FLAG_ARMED )
+	{
+		if( 0 == (pSensor->flags & DEBOUNCE_FLAG_KNOWN) )
+		{
+			//----------------------------------------------------------
+			//	no state was reported yet, so there is nothing to bounce
+			//	back to: a changed state waits for a new hold-off
+			//
+			if( state != (0 != (pSensor->flags & DEBOUNCE_FLAG_PENDING)) )
+			{
+				debounce_disarm( pDebounce, idx );
+
+				pSensor->flags = (pSensor->flags & ~DEBOUNCE_FLAG_PENDING) | (state ? DEBOUNCE_FLAG_PENDING : 0);
+
+				debounce_arm( pDebounce, idx, holdOffMs );
+			}
+		}
+		else if( state == reported )
+		{
+			//----------------------------------------------------------
+			//	the sensor bounced back before it was stable
+			//
+			debounce_disarm( pDebounce, idx );
+
+			if( 0xFFFF > pSensor->flapCount )
+			{
+				pSensor->flapCount++;
+			}
+
+			pDebounce->cntFlaps++;
+		}
+
+		//--------------------------------------------------------------
+		//	else: the pending state is reported again, keep the timer
+		//
+	}
+	else if( (pSensor->flags & DEBOUNCE_FLAG_KNOWN) && (state == reported) )
+	{
+		;	//	nothing changed
+	}
+	else if( 0 == holdOffMs )
+	{
+		pSensor->flags = (pSensor->flags & ~DEBOUNCE_FLAG_REPORTED) | DEBOUNCE_FLAG_KNOWN | (state ? DEBOUNCE_FLAG_REPORTED : 0);
+		pDebounce->cntReports++;
+
+		notify_sensor( pConsumer, address, state );
+	}
+	else
+	{
+		pSensor->flags = (pSensor->flags & ~DEBOUNCE_FLAG_PENDING) | (state ? DEBOUNCE_FLAG_PENDING : 0);
+
+		debounce_arm( pDebounce, idx, holdOffMs );
+	}
+}
+
+
+//**************************************************************************
+//	debounce_expire_slot
+//--------------------------------------------------------------------------
+//	report all sensors of the slot whose hold-off time is over
+//
+static void debounce_expire_slot( loconet_consumer_switch_sensor_t *pConsumer, uint16_t slot )
+{
+	loconet_sensor_debounce_t	*pDebounce	= pConsumer->pDebounce;
+	loconet_debounce_sensor_t	*pSensor;
+	uint16_t					idx			= pDebounce->wheel[ slot ];
+	uint16_t					next;
+	bool						state;
+
+	while( DEBOUNCE_NO_ENTRY != idx )
+	{
+		pSensor	= &(pDebounce->sensors[ idx ]);
+		next	= pSensor->next;
+
+		if( 0 < pSensor->rounds )
+		{
+			pSensor->rounds--;
+		}
+		else
+		{
+			debounce_disarm( pDebounce, idx );
+
+			state			= (0 != (pSensor->flags & DEBOUNCE_FLAG_PENDING));
+			pSensor->flags	= (pSensor->flags & ~DEBOUNCE_FLAG_REPORTED) | DEBOUNCE_FLAG_KNOWN | (state ? DEBOUNCE_FLAG_REPORTED : 0);
+			pDebounce->cntReports++;
+
+			notify_sensor( pConsumer, idx + 1, state );
+		}
+
+		idx = next;
+	}
+}
+
+
 //==========================================================================
 //
 //		F U N C T I O N S
@@ -71,6 +550,13 @@ void loconet_consumer_switch_sensor_init( loconet_consumer_switch_sensor_t *pCon
 	pConsumer->pNotifySwitchOutputs	= NULL;
 	pConsumer->pNotifySwitchState	= NULL;
 
+	pConsumer->pDebounce			= NULL;
+
+	for( uint8_t idx = 0 ; NOTIFY_FUNC_IDX_MAX > idx ; idx++ )
+	{
+		listener_index_init( &(pConsumer->listenerIndex[ idx ]) );
+	}
+
 	loconet_bus_register_consumer( pBus, pConsumer, loconet_consumer_switch_sensor_process );
 }
 
@@ -150,6 +636,216 @@ extern uint8_t	loconet_consumer_register_notify_switch_state(   loconet_consumer
 }
 
 
+//**************************************************************************
+//	loconet_consumer_add_listener_sensor
+//--------------------------------------------------------------------------
+//	add a listener for sensor reports of the addresses
+//	[firstAddress .. lastAddress]. If 'pAddressSet' is not NULL, only
+//	addresses with a set bit (address - 1) in this bitmap are notified.
+//	'pHandle' (can be NULL) gets the handle for the removal.
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	no free listener entry
+//		2	=>	invalid address range
+//		4	=>	no listener function
+//
+uint8_t	loconet_consumer_add_listener_sensor(	loconet_consumer_switch_sensor_t		*pConsumer,
+												uint16_t								firstAddress,
+												uint16_t								lastAddress,
+												const uint32_t							*pAddressSet,
+												loconet_consumer_func_listener_sensor	pFunc,
+												void									*pContext,
+												loconet_consumer_listener_handle_t		*pHandle		)
+{
+	return( listener_index_add(	&(pConsumer->listenerIndex[ NOTIFY_FUNC_IDX_SENSOR ]),
+								NOTIFY_FUNC_IDX_SENSOR,
+								firstAddress, lastAddress, pAddressSet,
+								pFunc, NULL, pContext, pHandle								) );
+}
+
+
+//**************************************************************************
+//	loconet_consumer_add_listener_switch
+//--------------------------------------------------------------------------
+//	add a listener for one of the switch messages, 'funcIdx' must be one
+//	of the NOTIFY_FUNC_IDX_SWITCH_xxx values.
+//	'pHandle' (can be NULL) gets the handle for the removal.
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	no free listener entry
+//		2	=>	invalid address range
+//		3	=>	invalid function index
+//		4	=>	no listener function
+//
+uint8_t	loconet_consumer_add_listener_switch(	loconet_consumer_switch_sensor_t		*pConsumer,
+												uint8_t									funcIdx,
+												uint16_t								firstAddress,
+												uint16_t								lastAddress,
+												const uint32_t							*pAddressSet,
+												loconet_consumer_func_listener_switch	pFunc,
+												void									*pContext,
+												loconet_consumer_listener_handle_t		*pHandle		)
+{
+	if( (NOTIFY_FUNC_IDX_SENSOR == funcIdx) || (NOTIFY_FUNC_IDX_MAX <= funcIdx) )
+	{
+		return( 3 );
+	}
+
+	return( listener_index_add(	&(pConsumer->listenerIndex[ funcIdx ]),
+								funcIdx,
+								firstAddress, lastAddress, pAddressSet,
+								NULL, pFunc, pContext, pHandle				) );
+}
+
+
+//**************************************************************************
+//	loconet_consumer_remove_listener
+//--------------------------------------------------------------------------
+//	remove the listener that got 'handle' when it was added
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	no listener with this handle
+//
+uint8_t loconet_consumer_remove_listener( loconet_consumer_switch_sensor_t *pConsumer, loconet_consumer_listener_handle_t handle )
+{
+	loconet_consumer_listener_index_t	*pIndex;
+	uint8_t								funcIdx	= (uint8_t)(handle >> 8);
+	uint8_t								idx		= (uint8_t)handle - 1;
+
+	if( (NOTIFY_FUNC_IDX_MAX <= funcIdx) || (LOCONET_CONSUMER_MAX_LISTENERS <= idx) )
+	{
+		return( 1 );
+	}
+
+	pIndex = &(pConsumer->listenerIndex[ funcIdx ]);
+
+	if(		(0 == (pIndex->usedMask & ((uint32_t)1 << idx)))
+		||	(pIndex->listeners[ idx ].generation != (uint16_t)(handle >> 16))	)
+	{
+		return( 1 );
+	}
+
+	pIndex->usedMask &= ~((uint32_t)1 << idx);
+
+	listener_index_rebuild( pIndex );
+
+	return( 0 );
+}
+
+
+//**************************************************************************
+//	loconet_consumer_debounce_init
+//--------------------------------------------------------------------------
+//	a default hold-off time of 0 means: no debouncing for addresses
+//	without an own range
+//
+void loconet_consumer_debounce_init( loconet_sensor_debounce_t *pDebounce, uint16_t defaultHoldOffMs )
+{
+	memset( pDebounce, 0, sizeof( loconet_sensor_debounce_t ) );
+
+	for( uint16_t idx = 0 ; LOCONET_DEBOUNCE_MAX_SENSORS > idx ; idx++ )
+	{
+		pDebounce->sensors[ idx ].next	= DEBOUNCE_NO_ENTRY;
+		pDebounce->sensors[ idx ].prev	= DEBOUNCE_NO_ENTRY;
+	}
+
+	for( uint16_t slot = 0 ; LOCONET_DEBOUNCE_WHEEL_SLOTS > slot ; slot++ )
+	{
+		pDebounce->wheel[ slot ] = DEBOUNCE_NO_ENTRY;
+	}
+
+	pDebounce->defaultHoldOffMs	= defaultHoldOffMs;
+	pDebounce->lastTickTime		= (uint64_t)esp_timer_get_time();
+}
+
+
+//**************************************************************************
+//	loconet_consumer_debounce_add_range
+//--------------------------------------------------------------------------
+//	return values:
+//		0	=>	okay
+//		1	=>	no free range entry
+//		2	=>	invalid address range
+//
+uint8_t loconet_consumer_debounce_add_range( loconet_sensor_debounce_t *pDebounce, uint16_t firstAddress, uint16_t lastAddress, uint16_t holdOffMs )
+{
+	if( LOCONET_DEBOUNCE_MAX_RANGES <= pDebounce->numRanges )
+	{
+		return( 1 );
+	}
+
+	if( (0 == firstAddress) || (firstAddress > lastAddress) )
+	{
+		return( 2 );
+	}
+
+	pDebounce->ranges[ pDebounce->numRanges ].firstAddress	= firstAddress;
+	pDebounce->ranges[ pDebounce->numRanges ].lastAddress	= lastAddress;
+	pDebounce->ranges[ pDebounce->numRanges ].holdOffMs		= holdOffMs;
+	pDebounce->numRanges++;
+
+	return( 0 );
+}
+
+
+//**************************************************************************
+//	loconet_consumer_debounce_get_flaps
+//--------------------------------------------------------------------------
+//	returns the number of bounces of the sensor
+//
+uint16_t loconet_consumer_debounce_get_flaps( loconet_sensor_debounce_t *pDebounce, uint16_t address )
+{
+	if( (0 == address) || (LOCONET_DEBOUNCE_MAX_SENSORS < address) )
+	{
+		return( 0 );
+	}
+
+	return( pDebounce->sensors[ address - 1 ].flapCount );
+}
+
+
+//**************************************************************************
+//	loconet_consumer_set_debounce
+//--------------------------------------------------------------------------
+//	after this call all sensor reports will be debounced
+//	a NULL pointer will switch debouncing off
+//
+void loconet_consumer_set_debounce( loconet_consumer_switch_sensor_t *pConsumer, loconet_sensor_debounce_t *pDebounce )
+{
+	pConsumer->pDebounce = pDebounce;
+}
+
+
+//**************************************************************************
+//	loconet_consumer_switch_sensor_tick
+//--------------------------------------------------------------------------
+//	advance the timer wheel up to the current time
+//
+void loconet_consumer_switch_sensor_tick( loconet_consumer_switch_sensor_t *pConsumer )
+{
+	loconet_sensor_debounce_t	*pDebounce	= pConsumer->pDebounce;
+	uint64_t					now;
+
+	if( NULL == pDebounce )
+	{
+		return;
+	}
+
+	now = (uint64_t)esp_timer_get_time();
+
+	while( (now - pDebounce->lastTickTime) >= DEBOUNCE_TICK_US )
+	{
+		pDebounce->lastTickTime += DEBOUNCE_TICK_US;
+		pDebounce->currentTick++;
+
+		debounce_expire_slot( pConsumer, pDebounce->currentTick & DEBOUNCE_WHEEL_MASK );
+	}
+}
+
+
 void loconet_consumer_switch_sensor_process( loconet_bus_consumer pConsumer, LnMsg *pMsg )
 {
 	loconet_consumer_switch_sensor_t	*myConsumer	=	(loconet_consumer_switch_sensor_t *)pConsumer;
@@ -168,57 +864,53 @@ void loconet_consumer_switch_sensor_process( loconet_bus_consumer pConsumer, LnM
 	switch( pMsg->sr.command )
 	{
 		case OPC_INPUT_REP:
-			if( myConsumer->pNotifySensor )
-			{
-				Address <<= 1;
-				Address += (pMsg->ir.in2 & OPC_INPUT_REP_SW) ? 2 : 1;
-				Output	= pMsg->ir.in2 & OPC_INPUT_REP_HI;
+			Address <<= 1;
+			Address += (pMsg->ir.in2 & OPC_INPUT_REP_SW) ? 2 : 1;
+			Output	= pMsg->ir.in2 & OPC_INPUT_REP_HI;
 
-				(*myConsumer->pNotifySensor)( Address, Output );
+			if( myConsumer->pDebounce )
+			{
+				debounce_sensor( myConsumer, Address, Output );
+			}
+			else
+			{
+				notify_sensor( myConsumer, Address, Output );
 			}
 			break;
 
 		case OPC_SW_REQ:
-			if( myConsumer->pNotifySwitchRequest )
-			{
-				Direction	= pMsg->srq.sw2 & OPC_SW_REQ_DIR;
-				Output		= pMsg->srq.sw2 & OPC_SW_REQ_OUT;
+			Direction	= pMsg->srq.sw2 & OPC_SW_REQ_DIR;
+			Output		= pMsg->srq.sw2 & OPC_SW_REQ_OUT;
 
-				(*myConsumer->pNotifySwitchRequest)( Address, Output, Direction );
-			}
+			notify_switch(	myConsumer, NOTIFY_FUNC_IDX_SWITCH_REQUEST, myConsumer->pNotifySwitchRequest,
+							Address, Output, Direction													);
 			break;
 
 		case OPC_SW_REP:
 			if( pMsg->srp.sn2 & OPC_SW_REP_INPUTS )
 			{
-				if( myConsumer->pNotifySwitchReport )
-				{
-					Direction	= pMsg->srp.sn2 & OPC_SW_REP_SW;
-					Output		= pMsg->srp.sn2 & OPC_SW_REP_HI;
+				Direction	= pMsg->srp.sn2 & OPC_SW_REP_SW;
+				Output		= pMsg->srp.sn2 & OPC_SW_REP_HI;
 
-					(*myConsumer->pNotifySwitchReport)( Address, Output, Direction );
-				}
+				notify_switch(	myConsumer, NOTIFY_FUNC_IDX_SWITCH_REPORT, myConsumer->pNotifySwitchReport,
+								Address, Output, Direction													);
 			}
 			else
 			{
-				if( myConsumer->pNotifySwitchOutputs )
-				{
-					Direction	= pMsg->srp.sn2 & OPC_SW_REP_THROWN;
-					Output		= pMsg->srp.sn2 & OPC_SW_REP_CLOSED;
+				Direction	= pMsg->srp.sn2 & OPC_SW_REP_THROWN;
+				Output		= pMsg->srp.sn2 & OPC_SW_REP_CLOSED;
 
-					(*myConsumer->pNotifySwitchOutputs)( Address, Output, Direction );
-				}
+				notify_switch(	myConsumer, NOTIFY_FUNC_IDX_SWITCH_OUTPUTS, myConsumer->pNotifySwitchOutputs,
+								Address, Output, Direction													);
 			}
 			break;
 
 		case OPC_SW_STATE:
-			if( myConsumer->pNotifySwitchState )
-			{
-				Direction	= pMsg->srq.sw2 & OPC_SW_REQ_DIR;
-				Output		= pMsg->srq.sw2 & OPC_SW_REQ_OUT;
+			Direction	= pMsg->srq.sw2 & OPC_SW_REQ_DIR;
+			Output		= pMsg->srq.sw2 & OPC_SW_REQ_OUT;
 
-				(*myConsumer->pNotifySwitchState)( Address, Output, Direction);
-			}
+			notify_switch(	myConsumer, NOTIFY_FUNC_IDX_SWITCH_STATE, myConsumer->pNotifySwitchState,
+							Address, Output, Direction												);
 			break;
 	}
 }
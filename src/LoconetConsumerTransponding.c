@@ -0,0 +1,352 @@
+//##########################################################################
+//#
+//#		LoconetConsumerTransponding.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library decode transponding
+//#	messages (OPC_MULTI_SENSE) and keep an index of which loco is in
+//#	which zone and which locos are in a zone.
+//#	Updates and lookups are O(1).
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <esp_timer.h>
+
+#include "ln_opc.h"
+#include "LoconetConsumerTransponding.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define NO_ENTRY		LOCONET_TRANSPONDING_NO_ENTRY
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	zone_unlink
+//--------------------------------------------------------------------------
+//	remove the entry from the list of its zone
+//
+static void zone_unlink( loconet_consumer_transponding_t *pTransp, uint8_t idx )
+{
+	loconet_transponding_entry_t	*pEntry = &(pTransp->entries[ idx ]);
+
+	if( NO_ENTRY != pEntry->prev )
+	{
+		pTransp->entries[ pEntry->prev ].next = pEntry->next;
+	}
+	else
+	{
+		pTransp->zoneHead[ pEntry->zone - 1 ] = pEntry->next;
+	}
+
+	if( NO_ENTRY != pEntry->next )
+	{
+		pTransp->entries[ pEntry->next ].prev = pEntry->prev;
+	}
+
+	pEntry->next = NO_ENTRY;
+	pEntry->prev = NO_ENTRY;
+}
+
+
+//**************************************************************************
+//	zone_link
+//--------------------------------------------------------------------------
+//	put the entry at the head of the list of the zone
+//
+static void zone_link( loconet_consumer_transponding_t *pTransp, uint8_t idx, uint16_t zone )
+{
+	loconet_transponding_entry_t	*pEntry = &(pTransp->entries[ idx ]);
+
+	pEntry->zone	= zone;
+	pEntry->prev	= NO_ENTRY;
+	pEntry->next	= pTransp->zoneHead[ zone - 1 ];
+
+	if( NO_ENTRY != pEntry->next )
+	{
+		pTransp->entries[ pEntry->next ].prev = idx;
+	}
+
+	pTransp->zoneHead[ zone - 1 ] = idx;
+}
+
+
+//**************************************************************************
+//	loco_present
+//--------------------------------------------------------------------------
+//	a loco is always located in the zone of its last present message
+//
+static void loco_present( loconet_consumer_transponding_t *pTransp, uint16_t locoAddress, uint16_t zone )
+{
+	uint8_t	idx;
+
+	if( loconet_addr_index_find( &(pTransp->locoIndex), locoAddress, &idx ) )
+	{
+		if( pTransp->entries[ idx ].zone == zone )
+		{
+			pTransp->entries[ idx ].time = (uint32_t)(esp_timer_get_time() / 1000);
+			return;
+		}
+
+		zone_unlink( pTransp, idx );
+	}
+	else
+	{
+		idx = pTransp->freeHead;
+
+		if( NO_ENTRY == idx )
+		{
+			pTransp->cntOverflow++;
+			return;
+		}
+
+		pTransp->freeHead = pTransp->entries[ idx ].next;
+
+		if( loconet_addr_index_insert( &(pTransp->locoIndex), locoAddress, idx ) )
+		{
+			pTransp->entries[ idx ].next	= pTransp->freeHead;
+			pTransp->freeHead				= idx;
+			pTransp->cntOverflow++;
+			return;
+		}
+
+		pTransp->entries[ idx ].locoAddress = locoAddress;
+	}
+
+	pTransp->entries[ idx ].time = (uint32_t)(esp_timer_get_time() / 1000);
+
+	zone_link( pTransp, idx, zone );
+
+	if( pTransp->pNotifyFunc )
+	{
+		(*pTransp->pNotifyFunc)( pTransp->pNotifyContext, locoAddress, zone, true );
+	}
+}
+
+
+//**************************************************************************
+//	loco_absent
+//--------------------------------------------------------------------------
+//	only if the loco is still located in this zone it will be removed
+//
+static void loco_absent( loconet_consumer_transponding_t *pTransp, uint16_t locoAddress, uint16_t zone )
+{
+	uint8_t	idx;
+
+	if(		!loconet_addr_index_find( &(pTransp->locoIndex), locoAddress, &idx )
+		||	(pTransp->entries[ idx ].zone != zone)							)
+	{
+		return;
+	}
+
+	zone_unlink( pTransp, idx );
+	loconet_addr_index_remove( &(pTransp->locoIndex), locoAddress );
+
+	pTransp->entries[ idx ].next	= pTransp->freeHead;
+	pTransp->freeHead				= idx;
+
+	if( pTransp->pNotifyFunc )
+	{
+		(*pTransp->pNotifyFunc)( pTransp->pNotifyContext, locoAddress, zone, false );
+	}
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_consumer_transponding_init
+//--------------------------------------------------------------------------
+//	return values:
+//		0	=>	okay
+//		1	=>	no free consumer entry on the bus
+//
+uint8_t loconet_consumer_transponding_init( loconet_consumer_transponding_t *pTransp, loconet_bus_t *pBus )
+{
+	memset( pTransp, 0, sizeof( loconet_consumer_transponding_t ) );
+
+	pTransp->pBus = pBus;
+
+	for( uint8_t idx = 0 ; LOCONET_TRANSPONDING_MAX_LOCOS > idx ; idx++ )
+	{
+		pTransp->entries[ idx ].next = ((idx + 1) < LOCONET_TRANSPONDING_MAX_LOCOS) ? (idx + 1) : NO_ENTRY;
+		pTransp->entries[ idx ].prev = NO_ENTRY;
+	}
+
+	pTransp->freeHead = 0;
+
+	memset( pTransp->zoneHead, NO_ENTRY, sizeof( pTransp->zoneHead ) );
+
+	loconet_addr_index_init( &(pTransp->locoIndex) );
+	return( loconet_bus_register_consumer( pBus, pTransp, loconet_consumer_transponding_process ) );
+}
+
+
+//**************************************************************************
+//	loconet_transponding_register_notify
+//--------------------------------------------------------------------------
+//	return values:
+//		0	=>	okay
+//		1	=>	there is already a notify function
+//
+uint8_t loconet_transponding_register_notify( loconet_consumer_transponding_t *pTransp, loconet_transponding_func_notify pFunc, void *pContext )
+{
+	if( NULL == pTransp->pNotifyFunc )
+	{
+		pTransp->pNotifyFunc	= pFunc;
+		pTransp->pNotifyContext	= pContext;
+
+		return( 0 );
+	}
+	else
+	{
+		return( 1 );
+	}
+}
+
+
+//**************************************************************************
+//	loconet_transponding_find_loco
+//--------------------------------------------------------------------------
+//	returns true if the loco is located in a zone
+//
+bool loconet_transponding_find_loco( loconet_consumer_transponding_t *pTransp, uint16_t locoAddress, uint16_t *pZone )
+{
+	uint8_t	idx;
+
+	if( !loconet_addr_index_find( &(pTransp->locoIndex), locoAddress, &idx ) )
+	{
+		return( false );
+	}
+
+	*pZone = pTransp->entries[ idx ].zone;
+
+	return( true );
+}
+
+
+//**************************************************************************
+//	loconet_transponding_first_loco
+//--------------------------------------------------------------------------
+//	returns the address of the loco that entered the zone last
+//	or 0 if the zone is empty
+//
+uint16_t loconet_transponding_first_loco( loconet_consumer_transponding_t *pTransp, uint16_t zone )
+{
+	uint8_t	idx;
+
+	if( (0 == zone) || (LOCONET_TRANSPONDING_MAX_ZONES < zone) )
+	{
+		return( 0 );
+	}
+
+	idx = pTransp->zoneHead[ zone - 1 ];
+
+	return( (NO_ENTRY == idx) ? 0 : pTransp->entries[ idx ].locoAddress );
+}
+
+
+//**************************************************************************
+//	loconet_transponding_get_zone_locos
+//--------------------------------------------------------------------------
+//	copy up to 'maxLocos' loco addresses of the zone into the array,
+//	returns the number of copied addresses
+//
+uint8_t loconet_transponding_get_zone_locos(	loconet_consumer_transponding_t	*pTransp,
+												uint16_t						zone,
+												uint16_t						*pLocos,
+												uint8_t							maxLocos	)
+{
+	uint8_t	count = 0;
+	uint8_t	idx;
+
+	if( (0 == zone) || (LOCONET_TRANSPONDING_MAX_ZONES < zone) )
+	{
+		return( 0 );
+	}
+
+	for( idx = pTransp->zoneHead[ zone - 1 ] ; (NO_ENTRY != idx) && (count < maxLocos) ; idx = pTransp->entries[ idx ].next )
+	{
+		pLocos[ count++ ] = pTransp->entries[ idx ].locoAddress;
+	}
+
+	return( count );
+}
+
+
+//**************************************************************************
+//	loconet_consumer_transponding_process
+//--------------------------------------------------------------------------
+//
+void loconet_consumer_transponding_process( loconet_bus_consumer pConsumer, LnMsg *pMsg )
+{
+	loconet_consumer_transponding_t	*pTransp = (loconet_consumer_transponding_t *)pConsumer;
+	uint16_t	zone;
+	uint16_t	locoAddress;
+
+	if( OPC_MULTI_SENSE != pMsg->sz.command )
+	{
+		return;
+	}
+
+	zone		= OPC_MULTI_SENSE_BOARD_ADDRESS( pMsg->mstr.zone, pMsg->mstr.type );
+	locoAddress	= OPC_MULTI_SENSE_LOCO_ADDRESS( pMsg->mstr.adr1, pMsg->mstr.adr2 );
+
+	switch( pMsg->mstr.type & OPC_MULTI_SENSE_MSG )
+	{
+		case OPC_MULTI_SENSE_PRESENT:
+			pTransp->cntPresent++;
+			loco_present( pTransp, locoAddress, zone );
+			break;
+
+		case OPC_MULTI_SENSE_ABSENT:
+			pTransp->cntAbsent++;
+			loco_absent( pTransp, locoAddress, zone );
+			break;
+
+		default:
+			break;
+	}
+}
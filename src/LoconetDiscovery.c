@@ -0,0 +1,594 @@
+//##########################################################################
+//#
+//#		LoconetDiscovery.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library find out the state of the
+//#	sensors and switches after a start with pipelined queries.
+//#	Another program must not ask switch states at the same time, its
+//#	OPC_LONG_ACK replies could not be told apart from ours.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <esp_timer.h>
+
+#include "ln_opc.h"
+#include "LoconetMsgBuffer.h"
+#include "LoconetDiscovery.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+//	wire time of one byte (start, 8 data, stop bit at 60 us)
+#define BYTE_TIME_US		(10 * 60)
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	send_switch_msg
+//--------------------------------------------------------------------------
+//
+static void send_switch_msg( loconet_discovery_t *pDiscovery, uint8_t opcode, uint16_t address, uint8_t flags )
+{
+	LnMsg	aMsg;
+
+	memset( &aMsg, 0, sizeof( LnMsg ) );
+
+	aMsg.srq.command	= opcode;
+	aMsg.srq.sw1		= (uint8_t)((address - 1) & 0x7F);
+	aMsg.srq.sw2		= (uint8_t)(((address - 1) >> 7) & 0x0F) | flags;
+
+	loconet_msg_set_checksum( &aMsg );
+
+	loconet_bus_broadcast( pDiscovery->pBus, &aMsg, loconet_discovery_receive );
+}
+
+
+//**************************************************************************
+//	send_window
+//--------------------------------------------------------------------------
+//	repeated queries are sent first
+//
+static void send_window( loconet_discovery_t *pDiscovery, uint64_t now )
+{
+	loconet_discovery_query_t	*pQuery;
+
+	while( pDiscovery->numInFlight < pDiscovery->window )
+	{
+		pQuery = &(pDiscovery->inFlight[ pDiscovery->numInFlight ]);
+
+		if( 0 < pDiscovery->numRepeat )
+		{
+			*pQuery = pDiscovery->repeat[ --pDiscovery->numRepeat ];
+		}
+		else if( pDiscovery->nextAddress <= pDiscovery->lastAddress )
+		{
+			pQuery->address	= pDiscovery->nextAddress++;
+			pQuery->retries	= 0;
+		}
+		else
+		{
+			break;
+		}
+
+		pDiscovery->numInFlight++;
+		pDiscovery->cntQueries++;
+
+		send_switch_msg( pDiscovery, OPC_SW_STATE, pQuery->address, 0 );
+	}
+
+	pDiscovery->numReplies	= 0;
+	pDiscovery->numStale	= 0;		//	the ones not here yet are lost
+	pDiscovery->numOnWire	= 0;
+	pDiscovery->replyTime	= now;
+}
+
+
+//**************************************************************************
+//	handle_timeout
+//--------------------------------------------------------------------------
+//	it is not known which reply was lost, so the whole window is
+//	repeated with half the size. Only a query that was alone in its
+//	window used up a retry, but not if it was not sent at all.
+//
+static void handle_timeout( loconet_discovery_t *pDiscovery, uint64_t now )
+{
+	loconet_discovery_query_t	*pQuery;
+	bool						localDrop;
+
+	localDrop = pDiscovery->useLoopback && (pDiscovery->numOnWire < pDiscovery->numInFlight);
+
+	if( localDrop )
+	{
+		pDiscovery->cntLocalDrops++;
+	}
+	else
+	{
+		pDiscovery->cntTimeouts++;
+	}
+
+	for( uint8_t idx = 0 ; idx < pDiscovery->numInFlight ; idx++ )
+	{
+		pQuery = &(pDiscovery->inFlight[ idx ]);
+
+		if( (1 == pDiscovery->numInFlight) && !localDrop )
+		{
+			if( pQuery->retries >= pDiscovery->maxRetries )
+			{
+				pDiscovery->cntFailed++;
+				continue;
+			}
+
+			pQuery->retries++;
+		}
+
+		pDiscovery->repeat[ pDiscovery->numRepeat++ ] = *pQuery;
+	}
+
+	pDiscovery->numInFlight	= 0;
+	pDiscovery->window		= (1 < pDiscovery->window) ? (pDiscovery->window / 2) : 1;
+	pDiscovery->drainEnd	= now + (pDiscovery->timeoutUs / 4);
+}
+
+
+//**************************************************************************
+//	extend_drain
+//--------------------------------------------------------------------------
+//	each stale reply may take as long as a reply of a window, but the
+//	drain ends at 'drainLimit', so foreign queries that come faster
+//	than the timeout can not hold it open after a reply was lost
+//
+static void extend_drain( loconet_discovery_t *pDiscovery, uint64_t now )
+{
+	pDiscovery->drainEnd = now + pDiscovery->timeoutUs;
+
+	if( pDiscovery->drainEnd > pDiscovery->drainLimit )
+	{
+		pDiscovery->drainEnd = pDiscovery->drainLimit;
+	}
+}
+
+
+//**************************************************************************
+//	drop_window
+//--------------------------------------------------------------------------
+//	another sender asked for a switch state, so its reply is between
+//	ours and they can not be matched any more. The window is repeated
+//	with half the size after the open replies and the foreign one
+//	are over, no retry is used up.
+//
+static void drop_window( loconet_discovery_t *pDiscovery, uint64_t now )
+{
+	for( uint8_t idx = 0 ; idx < pDiscovery->numInFlight ; idx++ )
+	{
+		pDiscovery->repeat[ pDiscovery->numRepeat++ ] = pDiscovery->inFlight[ idx ];
+	}
+
+	pDiscovery->cntForeign++;
+	pDiscovery->numStale	+= (pDiscovery->numInFlight - pDiscovery->numReplies) + 1;
+	pDiscovery->numInFlight	= 0;
+	pDiscovery->window		= (1 < pDiscovery->window) ? (pDiscovery->window / 2) : 1;
+	pDiscovery->drainLimit	= now + ((uint64_t)pDiscovery->numStale * pDiscovery->timeoutUs);
+
+	extend_drain( pDiscovery, now );
+}
+
+
+//**************************************************************************
+//	finish_window
+//--------------------------------------------------------------------------
+//	all replies came, the n-th reply belongs to the n-th query
+//
+static void finish_window( loconet_discovery_t *pDiscovery )
+{
+	loconet_discovery_query_t	*pQuery;
+	bool						closed;
+	bool						output;
+
+	for( uint8_t idx = 0 ; idx < pDiscovery->numInFlight ; idx++ )
+	{
+		pQuery	= &(pDiscovery->inFlight[ idx ]);
+		closed	= (0 != (pQuery->ack1 & OPC_SW_ACK_CLOSED));
+		output	= (0 != (pQuery->ack1 & OPC_SW_ACK_OUTPUT));
+
+		pDiscovery->cntSwitches++;
+
+		if( NULL != pDiscovery->pCache )
+		{
+			loconet_state_cache_set_switch( pDiscovery->pCache, pQuery->address, closed, output );
+		}
+
+		if( pDiscovery->pSwitchFunc )
+		{
+			(*pDiscovery->pSwitchFunc)( pDiscovery->pSwitchContext, pQuery->address, closed, output );
+		}
+	}
+
+	pDiscovery->numInFlight = 0;
+
+	if( pDiscovery->window < pDiscovery->maxWindow )
+	{
+		pDiscovery->window++;
+	}
+}
+
+
+//**************************************************************************
+//	update_load
+//--------------------------------------------------------------------------
+//
+static void update_load( loconet_discovery_t *pDiscovery, uint64_t now )
+{
+	uint64_t	length = now - pDiscovery->periodStart;
+
+	if( LOCONET_DISCOVERY_LOAD_PERIOD_US > length )
+	{
+		return;
+	}
+
+	pDiscovery->load		= (uint16_t)(((uint64_t)pDiscovery->periodBytes * BYTE_TIME_US * 1000) / length);
+	pDiscovery->periodBytes	= 0;
+	pDiscovery->periodStart	= now;
+}
+
+
+//**************************************************************************
+//	is_finished
+//--------------------------------------------------------------------------
+//
+static bool is_finished( loconet_discovery_t *pDiscovery, uint64_t now )
+{
+	return(		(0 == pDiscovery->numInFlight)
+			&&	(0 == pDiscovery->numRepeat)
+			&&	(pDiscovery->nextAddress > pDiscovery->lastAddress)
+			&&	(LOCONET_DISCOVERY_INTERROGATE_STEPS <= pDiscovery->interrogateStep)
+			&&	((now - pDiscovery->lastSensorTime) >= LOCONET_DISCOVERY_SENSOR_QUIET_US)	);
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_discovery_init
+//--------------------------------------------------------------------------
+//	return values:
+//		0	=>	okay
+//		1	=>	no free consumer entry on the bus
+//
+uint8_t loconet_discovery_init(	loconet_discovery_t				*pDiscovery,
+								loconet_bus_t					*pBus,
+								loconet_consumer_state_cache_t	*pCache		)
+{
+	memset( pDiscovery, 0, sizeof( loconet_discovery_t ) );
+
+	pDiscovery->pBus		= pBus;
+	pDiscovery->pCache		= pCache;
+	pDiscovery->maxWindow	= LOCONET_DISCOVERY_DEFAULT_WINDOW;
+	pDiscovery->maxRetries	= LOCONET_DISCOVERY_DEFAULT_RETRIES;
+	pDiscovery->timeoutUs	= LOCONET_DISCOVERY_DEFAULT_TIMEOUT_US;
+	pDiscovery->maxLoad		= LOCONET_DISCOVERY_DEFAULT_MAX_LOAD;
+
+	return( loconet_bus_register_consumer( pBus, pDiscovery, loconet_discovery_receive ) );
+}
+
+
+//**************************************************************************
+//	loconet_discovery_use_loopback
+//--------------------------------------------------------------------------
+//
+void loconet_discovery_use_loopback( loconet_discovery_t *pDiscovery, bool enable )
+{
+	pDiscovery->useLoopback = enable;
+
+	loconet_bus_set_loopback( pDiscovery->pBus, loconet_discovery_receive, enable );
+}
+
+
+//**************************************************************************
+//	loconet_discovery_register_notify
+//--------------------------------------------------------------------------
+//
+void loconet_discovery_register_notify(	loconet_discovery_t				*pDiscovery,
+										loconet_discovery_func_switch	pFunc,
+										void							*pContext	)
+{
+	pDiscovery->pSwitchFunc		= pFunc;
+	pDiscovery->pSwitchContext	= pContext;
+}
+
+
+//**************************************************************************
+//	loconet_discovery_start
+//--------------------------------------------------------------------------
+//	the first window has two queries, it grows up to 'maxWindow'
+//
+uint8_t loconet_discovery_start(	loconet_discovery_t			*pDiscovery,
+									uint16_t					firstAddress,
+									uint16_t					numSwitches,
+									bool						interrogate,
+									loconet_discovery_func_done	pFunc,
+									void						*pContext		)
+{
+	uint64_t	now = (uint64_t)esp_timer_get_time();
+
+	if( pDiscovery->running )
+	{
+		return( 1 );
+	}
+
+	if(		(0 == firstAddress)
+		||	((firstAddress + numSwitches - 1) > LOCONET_DISCOVERY_MAX_SWITCHES)	)
+	{
+		return( 2 );
+	}
+
+	if( pDiscovery->maxWindow > LOCONET_DISCOVERY_MAX_WINDOW )
+	{
+		pDiscovery->maxWindow = LOCONET_DISCOVERY_MAX_WINDOW;
+	}
+
+	if( 0 == pDiscovery->maxWindow )
+	{
+		pDiscovery->maxWindow = 1;
+	}
+
+	pDiscovery->pDoneFunc			= pFunc;
+	pDiscovery->pDoneContext		= pContext;
+	pDiscovery->nextAddress			= firstAddress;
+	pDiscovery->lastAddress			= firstAddress + numSwitches - 1;
+	pDiscovery->numInFlight			= 0;
+	pDiscovery->numReplies			= 0;
+	pDiscovery->numStale			= 0;
+	pDiscovery->numOnWire			= 0;
+	pDiscovery->numRepeat			= 0;
+	pDiscovery->window				= (2 < pDiscovery->maxWindow) ? 2 : pDiscovery->maxWindow;
+	pDiscovery->drainEnd			= 0;
+	pDiscovery->drainLimit			= 0;
+	pDiscovery->interrogateStep		= interrogate ? 0 : LOCONET_DISCOVERY_INTERROGATE_STEPS;
+	pDiscovery->interrogateTime		= 0;
+	pDiscovery->lastSensorTime		= interrogate ? now : 0;
+	pDiscovery->periodStart			= now;
+	pDiscovery->periodBytes			= 0;
+	pDiscovery->load				= 0;
+	pDiscovery->startTime			= now;
+	pDiscovery->durationUs			= 0;
+	pDiscovery->cntSwitches			= 0;
+	pDiscovery->cntFailed			= 0;
+	pDiscovery->cntSensorReports	= 0;
+	pDiscovery->cntQueries			= 0;
+	pDiscovery->cntTimeouts			= 0;
+	pDiscovery->cntLocalDrops		= 0;
+	pDiscovery->cntUnexpected		= 0;
+	pDiscovery->running				= true;
+
+	return( 0 );
+}
+
+
+//**************************************************************************
+//	loconet_discovery_is_running
+//--------------------------------------------------------------------------
+//
+bool loconet_discovery_is_running( loconet_discovery_t *pDiscovery )
+{
+	return( pDiscovery->running );
+}
+
+
+//**************************************************************************
+//	loconet_discovery_process
+//--------------------------------------------------------------------------
+//	first handle a timeout, then send the interrogate sequence and
+//	the next window
+//
+void loconet_discovery_process( loconet_discovery_t *pDiscovery )
+{
+	uint64_t	now = (uint64_t)esp_timer_get_time();
+
+	if( !pDiscovery->running )
+	{
+		return;
+	}
+
+	update_load( pDiscovery, now );
+
+	if(		(0 < pDiscovery->numInFlight)
+		&&	((now - pDiscovery->replyTime) > pDiscovery->timeoutUs)	)
+	{
+		handle_timeout( pDiscovery, now );
+	}
+
+	//------------------------------------------------------------------
+	//	interrogate: every step closed and thrown to 1017 .. 1020,
+	//	the devices answer with the state of all their inputs
+	//
+	if(		(LOCONET_DISCOVERY_INTERROGATE_STEPS > pDiscovery->interrogateStep)
+		&&	((now - pDiscovery->interrogateTime) >= LOCONET_DISCOVERY_INTERROGATE_GAP_US)
+		&&	(pDiscovery->load < pDiscovery->maxLoad)										)
+	{
+		send_switch_msg(	pDiscovery,
+							OPC_SW_REQ,
+							LOCONET_DISCOVERY_INTERROGATE_ADDRESS + (pDiscovery->interrogateStep & 0x03),
+							(4 > pDiscovery->interrogateStep) ? OPC_SW_REQ_DIR : 0							);
+
+		pDiscovery->interrogateStep++;
+		pDiscovery->interrogateTime	= now;
+		pDiscovery->lastSensorTime	= now;
+	}
+
+	if(		(0 == pDiscovery->numInFlight)
+		&&	(now >= pDiscovery->drainEnd)
+		&&	(pDiscovery->load < pDiscovery->maxLoad)	)
+	{
+		send_window( pDiscovery, now );
+	}
+
+	if( is_finished( pDiscovery, now ) )
+	{
+		pDiscovery->running		= false;
+		pDiscovery->durationUs	= (uint32_t)(now - pDiscovery->startTime);
+
+		if( pDiscovery->pDoneFunc )
+		{
+			(*pDiscovery->pDoneFunc)( pDiscovery->pDoneContext, pDiscovery->cntSwitches, pDiscovery->cntFailed, pDiscovery->durationUs );
+		}
+	}
+}
+
+
+//**************************************************************************
+//	loconet_discovery_receive
+//--------------------------------------------------------------------------
+//	the queries and their replies are not counted for the bus load,
+//	the discovery shall only give way to the other messages
+//
+void loconet_discovery_receive( loconet_bus_consumer pConsumer, LnMsg *pMsg )
+{
+	loconet_discovery_t	*pDiscovery	= (loconet_discovery_t *)pConsumer;
+	uint64_t			now;
+
+	if( !pDiscovery->running )
+	{
+		return;
+	}
+
+	now = (uint64_t)esp_timer_get_time();
+
+	//------------------------------------------------------------------
+	//	an own query is on the loconet, the replies are waited for
+	//	from now on. The loopbacks of the other senders are ignored,
+	//	their messages came already by the broadcast.
+	//
+	if( loconet_bus_is_loopback( pDiscovery->pBus ) )
+	{
+		if(		(loconet_discovery_receive == loconet_bus_get_sender( pDiscovery->pBus ))
+			&&	(OPC_SW_STATE == pMsg->sz.command)
+			&&	(pDiscovery->numOnWire < pDiscovery->numInFlight)						)
+		{
+			pDiscovery->numOnWire++;
+			pDiscovery->replyTime = now;
+		}
+		return;
+	}
+
+	if(		(OPC_SW_STATE != pMsg->sz.command)
+		&&	((OPC_LONG_ACK != pMsg->sz.command) || ((OPC_SW_STATE & OPC_MASK) != pMsg->lack.opcode))	)
+	{
+		pDiscovery->periodBytes += LOCONET_PACKET_SIZE( pMsg->sz.command, pMsg->sz.mesg_size );
+	}
+
+	switch( pMsg->sz.command )
+	{
+		case OPC_SW_STATE:
+			//----------------------------------------------------------
+			//	our own queries are not spread to us, so this one
+			//	is from another sender
+			//
+			if( 0 < pDiscovery->numInFlight )
+			{
+				drop_window( pDiscovery, now );
+			}
+			else
+			{
+				//------------------------------------------------------
+				//	no window yet, but its reply must be over before
+				//
+				if( 0 == pDiscovery->numStale )
+				{
+					pDiscovery->drainLimit = now + pDiscovery->timeoutUs;
+				}
+
+				pDiscovery->numStale++;
+				extend_drain( pDiscovery, now );
+			}
+			break;
+
+		case OPC_INPUT_REP:
+			pDiscovery->lastSensorTime = now;
+			pDiscovery->cntSensorReports++;
+			break;
+
+		case OPC_LONG_ACK:
+			if( (OPC_SW_STATE & OPC_MASK) != pMsg->lack.opcode )
+			{
+				break;
+			}
+
+			if( now < pDiscovery->drainEnd )
+			{
+				//------------------------------------------------------
+				//	the drain of a dropped window is over with its
+				//	last reply, a lost one ends it at 'drainEnd'
+				//
+				if( 0 < pDiscovery->numStale )
+				{
+					pDiscovery->numStale--;
+
+					if( 0 == pDiscovery->numStale )
+					{
+						pDiscovery->drainEnd = now;
+					}
+					else
+					{
+						extend_drain( pDiscovery, now );
+					}
+				}
+				break;
+			}
+
+			if( pDiscovery->numReplies >= pDiscovery->numInFlight )
+			{
+				pDiscovery->cntUnexpected++;
+				break;
+			}
+
+			pDiscovery->inFlight[ pDiscovery->numReplies++ ].ack1 = pMsg->lack.ack1;
+			pDiscovery->replyTime = now;
+
+			if( pDiscovery->numReplies == pDiscovery->numInFlight )
+			{
+				finish_window( pDiscovery );
+			}
+			break;
+	}
+}
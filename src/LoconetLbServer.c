@@ -0,0 +1,679 @@
+//##########################################################################
+//#
+//#		LoconetLbServer.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library connect TCP clients
+//#	(e.g. JMRI or Rocrail) with the LbServer protocol to the bus.
+//#	The sockets are non-blocking. The lines for a client are collected
+//#	in a bounded buffer that is written with one send() per call of
+//#	loconet_lbserver_process(). A client that can not keep up is
+//#	disconnected, so the bus never waits for the network.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <esp_timer.h>
+
+#include "LoconetMsgBuffer.h"
+#include "LoconetLbServer.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#ifndef MSG_NOSIGNAL
+	#define MSG_NOSIGNAL	0
+#endif
+
+#define LBSERVER_VERSION_LINE	"VERSION LoconetBus LbServer 1.0\r\n"
+
+//	"RECEIVE " + 3 chars per byte + "\r\n"
+#define MAX_LINE_LENGTH			(8 + (3 * LN_BUF_SIZE) + 2)
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	set_non_blocking
+//--------------------------------------------------------------------------
+//
+static bool set_non_blocking( int fd )
+{
+	int	flags = fcntl( fd, F_GETFL, 0 );
+
+	return( (0 <= flags) && (0 == fcntl( fd, F_SETFL, flags | O_NONBLOCK )) );
+}
+
+
+//**************************************************************************
+//	drop_client
+//--------------------------------------------------------------------------
+//
+static void drop_client( loconet_lbserver_client_t *pClient )
+{
+	if( 0 <= pClient->fd )
+	{
+		close( pClient->fd );
+	}
+
+	pClient->fd		= -1;
+	pClient->rxLen	= 0;
+	pClient->txLen	= 0;
+}
+
+
+//**************************************************************************
+//	queue_line
+//--------------------------------------------------------------------------
+//	the line is only copied into the output buffer of the client,
+//	a client whose buffer is full is too slow and will be dropped
+//
+static void queue_line( loconet_lbserver_t *pServer, loconet_lbserver_client_t *pClient, const char *pLine, uint16_t length )
+{
+	if( 0 > pClient->fd )
+	{
+		return;
+	}
+
+	if( (LOCONET_LBSERVER_TX_BUF_SIZE - pClient->txLen) < length )
+	{
+		pServer->cntDropped++;
+
+		drop_client( pClient );
+		return;
+	}
+
+	memcpy( &(pClient->txBuf[ pClient->txLen ]), pLine, length );
+
+	pClient->txLen += length;
+}
+
+
+//**************************************************************************
+//	format_msg
+//--------------------------------------------------------------------------
+//	"<pPrefix> 81 7E\r\n", returns the length of the line
+//
+static uint16_t format_msg( char *pLine, const char *pPrefix, LnMsg *pMsg )
+{
+	static const char	hexDigits[] = "0123456789ABCDEF";
+	uint8_t				length		= LOCONET_PACKET_SIZE( pMsg->sz.command, pMsg->sz.mesg_size );
+	uint16_t			pos			= (uint16_t)strlen( pPrefix );
+
+	memcpy( pLine, pPrefix, pos );
+
+	if( LN_BUF_SIZE < length )
+	{
+		length = LN_BUF_SIZE;
+	}
+
+	for( uint8_t idx = 0 ; idx < length ; idx++ )
+	{
+		pLine[ pos++ ] = ' ';
+		pLine[ pos++ ] = hexDigits[ pMsg->data[ idx ] >> 4 ];
+		pLine[ pos++ ] = hexDigits[ pMsg->data[ idx ] & 0x0F ];
+	}
+
+	pLine[ pos++ ] = '\r';
+	pLine[ pos++ ] = '\n';
+
+	return( pos );
+}
+
+
+//**************************************************************************
+//	queue_msg_to_all
+//--------------------------------------------------------------------------
+//
+static void queue_msg_to_all( loconet_lbserver_t *pServer, LnMsg *pMsg )
+{
+	char		line[ MAX_LINE_LENGTH ];
+	uint16_t	length = format_msg( line, "RECEIVE", pMsg );
+
+	for( uint8_t idx = 0 ; LOCONET_LBSERVER_MAX_CLIENTS > idx ; idx++ )
+	{
+		queue_line( pServer, &(pServer->clients[ idx ]), line, length );
+	}
+}
+
+
+//**************************************************************************
+//	reply_pending
+//--------------------------------------------------------------------------
+//	the client of the SEND gets the answer and the entry is removed
+//
+static void reply_pending( loconet_lbserver_t *pServer, uint8_t idx, const char *pReply )
+{
+	uint8_t	client = pServer->pending[ idx ].client;
+
+	if( LOCONET_LBSERVER_MAX_CLIENTS > client )
+	{
+		queue_line( pServer, &(pServer->clients[ client ]), pReply, (uint16_t)strlen( pReply ) );
+	}
+
+	pServer->numPending--;
+
+	memmove(	&(pServer->pending[ idx ]),
+				&(pServer->pending[ idx + 1 ]),
+				(pServer->numPending - idx) * sizeof( loconet_lbserver_pending_t )	);
+}
+
+
+//**************************************************************************
+//	confirm_pending
+//--------------------------------------------------------------------------
+//	one of our messages is on the loconet. The oldest SEND with the
+//	same bytes is answered, older ones wait for their timeout.
+//	The message is echoed to all clients in any case.
+//
+static void confirm_pending( loconet_lbserver_t *pServer, LnMsg *pMsg )
+{
+	uint8_t	length = LOCONET_PACKET_SIZE( pMsg->sz.command, pMsg->sz.mesg_size );
+
+	if( LN_BUF_SIZE < length )
+	{
+		length = LN_BUF_SIZE;
+	}
+
+	for( uint8_t idx = 0 ; idx < pServer->numPending ; idx++ )
+	{
+		if( 0 == memcmp( pServer->pending[ idx ].msg.data, pMsg->data, length ) )
+		{
+			reply_pending( pServer, idx, "SENT OK\r\n" );
+			break;
+		}
+	}
+
+	queue_msg_to_all( pServer, pMsg );
+}
+
+
+//**************************************************************************
+//	expire_pending
+//--------------------------------------------------------------------------
+//	the entries are in the order of the SEND commands, so only the
+//	oldest ones can be over
+//
+static void expire_pending( loconet_lbserver_t *pServer )
+{
+	uint64_t	now = (uint64_t)esp_timer_get_time();
+
+	while(		(0 < pServer->numPending)
+			&&	((now - pServer->pending[ 0 ].time) > LOCONET_LBSERVER_SEND_TIMEOUT_US)	)
+	{
+		pServer->cntFailed++;
+
+		reply_pending( pServer, 0, "SENT ERROR Not sent\r\n" );
+	}
+}
+
+
+//**************************************************************************
+//	handle_send
+//--------------------------------------------------------------------------
+//	'pArgs' are the hex bytes of a SEND command. The bytes must form
+//	exactly one message with a correct check sum.
+//	With loopback the answer and the echo wait until the message is
+//	on the loconet (see confirm_pending).
+//
+static void handle_send( loconet_lbserver_t *pServer, loconet_lbserver_client_t *pClient, char *pArgs )
+{
+	loconet_msg_buffer_t		msgBuffer;
+	loconet_lbserver_pending_t	*pPending;
+	LnMsg						*pMsg	= NULL;
+	LnMsg						aMsg;
+	const char					*pReply	= "SENT OK\r\n";
+	char						*pEnd;
+	unsigned long				value;
+
+	loconet_msg_buffer_init( &msgBuffer );
+
+	while( 1 )
+	{
+		value = strtoul( pArgs, &pEnd, 16 );
+
+		if( pEnd == pArgs )
+		{
+			break;
+		}
+
+		if( (0xFF < value) || (NULL != pMsg) )
+		{
+			pMsg = NULL;
+			break;
+		}
+
+		pMsg = loconet_msg_buffer_add_byte( &msgBuffer, (uint8_t)value );
+		pArgs = pEnd;
+	}
+
+	if( NULL == pMsg )
+	{
+		pServer->cntErrors++;
+
+		pReply = "SENT ERROR Bad message\r\n";
+	}
+	else if( pServer->useLoopback )
+	{
+		if( LOCONET_LBSERVER_MAX_PENDING <= pServer->numPending )
+		{
+			pServer->cntFailed++;
+
+			pReply = "SENT ERROR Busy\r\n";
+		}
+		else
+		{
+			pPending = &(pServer->pending[ pServer->numPending++ ]);
+
+			memcpy( &(pPending->msg), pMsg, sizeof( LnMsg ) );
+			memcpy( &aMsg, pMsg, sizeof( LnMsg ) );
+
+			pPending->time		= (uint64_t)esp_timer_get_time();
+			pPending->client	= (uint8_t)(pClient - pServer->clients);
+			pReply				= NULL;
+
+			pServer->cntSent++;
+
+			loconet_bus_broadcast( pServer->pBus, &aMsg, loconet_lbserver_send );
+		}
+	}
+	else
+	{
+		//----------------------------------------------------------
+		//	every client gets the message, like the echo of a
+		//	LocoBuffer, the other consumers of the bus too
+		//
+		memcpy( &aMsg, pMsg, sizeof( LnMsg ) );
+
+		pServer->cntSent++;
+
+		queue_msg_to_all( pServer, &aMsg );
+
+		loconet_bus_broadcast( pServer->pBus, &aMsg, loconet_lbserver_send );
+	}
+
+	if( NULL != pReply )
+	{
+		queue_line( pServer, pClient, pReply, (uint16_t)strlen( pReply ) );
+	}
+}
+
+
+//**************************************************************************
+//	handle_line
+//--------------------------------------------------------------------------
+//
+static void handle_line( loconet_lbserver_t *pServer, loconet_lbserver_client_t *pClient, char *pLine )
+{
+	if( 0 == strncmp( pLine, "SEND ", 5 ) )
+	{
+		handle_send( pServer, pClient, &(pLine[ 5 ]) );
+	}
+	else if( '\0' != pLine[ 0 ] )
+	{
+		pServer->cntErrors++;
+
+		queue_line( pServer, pClient, "ERROR Unknown command\r\n", 23 );
+	}
+}
+
+
+//**************************************************************************
+//	read_client
+//--------------------------------------------------------------------------
+//	read all available bytes and handle every complete line
+//
+static void read_client( loconet_lbserver_t *pServer, loconet_lbserver_client_t *pClient )
+{
+	ssize_t		count;
+	uint16_t	start;
+
+	while( 0 <= pClient->fd )
+	{
+		count = recv(	pClient->fd,
+						&(pClient->rxBuf[ pClient->rxLen ]),
+						LOCONET_LBSERVER_RX_BUF_SIZE - 1 - pClient->rxLen,
+						0													);
+
+		if( 0 == count )
+		{
+			drop_client( pClient );
+			return;
+		}
+
+		if( 0 > count )
+		{
+			if( (EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno) )
+			{
+				drop_client( pClient );
+			}
+
+			return;
+		}
+
+		pClient->rxLen	+= (uint16_t)count;
+		start			 = 0;
+
+		for( uint16_t idx = 0 ; (idx < pClient->rxLen) && (0 <= pClient->fd) ; idx++ )
+		{
+			if( ('\n' == pClient->rxBuf[ idx ]) || ('\r' == pClient->rxBuf[ idx ]) )
+			{
+				pClient->rxBuf[ idx ] = '\0';
+
+				handle_line( pServer, pClient, &(pClient->rxBuf[ start ]) );
+
+				start = idx + 1;
+			}
+		}
+
+		if( 0 > pClient->fd )
+		{
+			return;
+		}
+
+		pClient->rxLen -= start;
+
+		memmove( pClient->rxBuf, &(pClient->rxBuf[ start ]), pClient->rxLen );
+
+		if( (LOCONET_LBSERVER_RX_BUF_SIZE - 1) <= pClient->rxLen )
+		{
+			//----------------------------------------------------------
+			//	a line that long is no command, throw it away
+			//
+			pServer->cntErrors++;
+			pClient->rxLen = 0;
+		}
+	}
+}
+
+
+//**************************************************************************
+//	flush_client
+//--------------------------------------------------------------------------
+//	all collected lines are written with one send()
+//
+static void flush_client( loconet_lbserver_client_t *pClient )
+{
+	ssize_t	count;
+
+	if( (0 > pClient->fd) || (0 == pClient->txLen) )
+	{
+		return;
+	}
+
+	count = send( pClient->fd, pClient->txBuf, pClient->txLen, MSG_NOSIGNAL );
+
+	if( 0 > count )
+	{
+		if( (EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno) )
+		{
+			drop_client( pClient );
+		}
+
+		return;
+	}
+
+	pClient->txLen -= (uint16_t)count;
+
+	memmove( pClient->txBuf, &(pClient->txBuf[ count ]), pClient->txLen );
+}
+
+
+//**************************************************************************
+//	accept_clients
+//--------------------------------------------------------------------------
+//
+static void accept_clients( loconet_lbserver_t *pServer )
+{
+	loconet_lbserver_client_t	*pClient;
+	int							fd;
+
+	while( 0 <= (fd = accept( pServer->listenFd, NULL, NULL )) )
+	{
+		pClient = NULL;
+
+		for( uint8_t idx = 0 ; LOCONET_LBSERVER_MAX_CLIENTS > idx ; idx++ )
+		{
+			if( 0 > pServer->clients[ idx ].fd )
+			{
+				pClient = &(pServer->clients[ idx ]);
+				break;
+			}
+		}
+
+		if( (NULL == pClient) || !set_non_blocking( fd ) )
+		{
+			close( fd );
+			continue;
+		}
+
+		pServer->cntConnects++;
+
+		//--------------------------------------------------------------
+		//	the answers for a former client of this entry are lost
+		//
+		for( uint8_t idx = 0 ; idx < pServer->numPending ; idx++ )
+		{
+			if( (pClient - pServer->clients) == pServer->pending[ idx ].client )
+			{
+				pServer->pending[ idx ].client = LOCONET_LBSERVER_MAX_CLIENTS;
+			}
+		}
+
+		pClient->fd		= fd;
+		pClient->rxLen	= 0;
+		pClient->txLen	= 0;
+
+		queue_line( pServer, pClient, LBSERVER_VERSION_LINE, (uint16_t)strlen( LBSERVER_VERSION_LINE ) );
+	}
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_lbserver_init
+//--------------------------------------------------------------------------
+//	opens the listening socket on 'port' (all interfaces) and
+//	registers the server at the bus
+//
+uint8_t loconet_lbserver_init( loconet_lbserver_t *pServer, loconet_bus_t *pBus, uint16_t port )
+{
+	struct sockaddr_in	addr;
+	int					option = 1;
+
+	memset( pServer, 0, sizeof( loconet_lbserver_t ) );
+
+	pServer->pBus = pBus;
+
+	for( uint8_t idx = 0 ; LOCONET_LBSERVER_MAX_CLIENTS > idx ; idx++ )
+	{
+		pServer->clients[ idx ].fd = -1;
+	}
+
+	pServer->listenFd = socket( AF_INET, SOCK_STREAM, 0 );
+
+	if( (0 > pServer->listenFd) || !set_non_blocking( pServer->listenFd ) )
+	{
+		loconet_lbserver_close( pServer );
+		return( 1 );
+	}
+
+	setsockopt( pServer->listenFd, SOL_SOCKET, SO_REUSEADDR, &option, sizeof( option ) );
+
+	memset( &addr, 0, sizeof( addr ) );
+
+	addr.sin_family			= AF_INET;
+	addr.sin_addr.s_addr	= htonl( INADDR_ANY );
+	addr.sin_port			= htons( port );
+
+	if( 0 != bind( pServer->listenFd, (struct sockaddr *)&addr, sizeof( addr ) ) )
+	{
+		loconet_lbserver_close( pServer );
+		return( 2 );
+	}
+
+	if( 0 != listen( pServer->listenFd, LOCONET_LBSERVER_MAX_CLIENTS ) )
+	{
+		loconet_lbserver_close( pServer );
+		return( 3 );
+	}
+
+	if( 0 != loconet_bus_register_consumer( pBus, pServer, loconet_lbserver_send ) )
+	{
+		loconet_lbserver_close( pServer );
+		return( 4 );
+	}
+
+	return( 0 );
+}
+
+
+//**************************************************************************
+//	loconet_lbserver_close
+//--------------------------------------------------------------------------
+//
+void loconet_lbserver_close( loconet_lbserver_t *pServer )
+{
+	for( uint8_t idx = 0 ; LOCONET_LBSERVER_MAX_CLIENTS > idx ; idx++ )
+	{
+		drop_client( &(pServer->clients[ idx ]) );
+	}
+
+	if( 0 <= pServer->listenFd )
+	{
+		close( pServer->listenFd );
+	}
+
+	pServer->listenFd = -1;
+}
+
+
+//**************************************************************************
+//	loconet_lbserver_num_clients
+//--------------------------------------------------------------------------
+//
+uint8_t loconet_lbserver_num_clients( loconet_lbserver_t *pServer )
+{
+	uint8_t	count = 0;
+
+	for( uint8_t idx = 0 ; LOCONET_LBSERVER_MAX_CLIENTS > idx ; idx++ )
+	{
+		if( 0 <= pServer->clients[ idx ].fd )
+		{
+			count++;
+		}
+	}
+
+	return( count );
+}
+
+
+//**************************************************************************
+//	loconet_lbserver_use_loopback
+//--------------------------------------------------------------------------
+//
+void loconet_lbserver_use_loopback( loconet_lbserver_t *pServer, bool enable )
+{
+	pServer->useLoopback = enable;
+
+	loconet_bus_set_loopback( pServer->pBus, loconet_lbserver_send, enable );
+}
+
+
+//**************************************************************************
+//	loconet_lbserver_process
+//--------------------------------------------------------------------------
+//
+void loconet_lbserver_process( loconet_lbserver_t *pServer )
+{
+	if( 0 > pServer->listenFd )
+	{
+		return;
+	}
+
+	expire_pending( pServer );
+	accept_clients( pServer );
+
+	for( uint8_t idx = 0 ; LOCONET_LBSERVER_MAX_CLIENTS > idx ; idx++ )
+	{
+		read_client( pServer, &(pServer->clients[ idx ]) );
+	}
+
+	for( uint8_t idx = 0 ; LOCONET_LBSERVER_MAX_CLIENTS > idx ; idx++ )
+	{
+		flush_client( &(pServer->clients[ idx ]) );
+	}
+}
+
+
+//**************************************************************************
+//	loconet_lbserver_send
+//--------------------------------------------------------------------------
+//	every message of the bus is queued for all clients,
+//	it will be written with the next call of loconet_lbserver_process().
+//	Of the loopbacks only our own messages are used, the others were
+//	already spread on the bus.
+//
+void loconet_lbserver_send( loconet_bus_consumer pConsumer, LnMsg *pMsg )
+{
+	loconet_lbserver_t	*pServer = (loconet_lbserver_t *)pConsumer;
+
+	if( loconet_bus_is_loopback( pServer->pBus ) )
+	{
+		if( loconet_lbserver_send == loconet_bus_get_sender( pServer->pBus ) )
+		{
+			confirm_pending( pServer, pMsg );
+		}
+		return;
+	}
+
+	queue_msg_to_all( pServer, pMsg );
+}
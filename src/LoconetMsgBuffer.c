@@ -34,6 +34,7 @@
 #include <inttypes.h>
 
 #include "LoconetMsgBuffer.h"
+#include "LoconetTrace.h"
 
 
 //==========================================================================
@@ -92,6 +93,8 @@ static lnMsg * loconet_msg_buffer_get_msg( loconet_msg_buffer_t *pBuffer )
 		//
 		if( 0 == pBuffer->checkSum )
 		{
+			LN_TRACE( LN_TRACE_RX_FRAME, pBuffer->buffer[ 0 ] );
+
 			return( (lnMsg *)pBuffer->buffer );
 		}
 	}
@@ -151,3 +154,27 @@ lnMsg *loconet_msg_buffer_add_byte( loconet_msg_buffer_t *pBuffer, uint8_t newBy
 
 	return( loconet_msg_buffer_get_msg( pBuffer ) );
 }
+
+
+//**********************************************************************
+//	loconet_msg_set_checksum
+//----------------------------------------------------------------------
+//	the check sum is the last byte of the message
+//
+void loconet_msg_set_checksum( lnMsg *pMsg )
+{
+	uint8_t	length		= LOCONET_PACKET_SIZE( pMsg->sz.command, pMsg->sz.mesg_size );
+	uint8_t	checkSum	= LN_CHECKSUM_SEED;
+
+	if( (LN_MSG_HEAD_SIZE > length) || (LN_BUF_SIZE < length) )
+	{
+		return;
+	}
+
+	for( uint8_t idx = 0 ; idx < (length - 1) ; idx++ )
+	{
+		checkSum ^= pMsg->data[ idx ];
+	}
+
+	pMsg->data[ length - 1 ] = checkSum;
+}
@@ -0,0 +1,573 @@
+//##########################################################################
+//#
+//#		LoconetPersist.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library save the state of the
+//#	sensors, switches and slots as a versioned binary image and restore
+//#	it after a restart. The image is divided into pages with an own CRC,
+//#	a checkpoint only writes the pages that changed since the last one.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef __linux__
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#include "LoconetPersist.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define SENSOR_WORDS		LN_STATE_BITMAP_WORDS( LOCONET_STATE_CACHE_MAX_SENSORS )
+#define SWITCH_WORDS		LN_STATE_BITMAP_WORDS( LOCONET_STATE_CACHE_MAX_SWITCHES )
+
+#define PAGE_OFFSET( page )	(LOCONET_PERSIST_HEADER_SIZE + ((uint32_t)(page) * LOCONET_PERSIST_PAGE_RECORD_SIZE))
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	crc32
+//--------------------------------------------------------------------------
+//	CRC-32 (IEEE 802.3) with a table of 16 entries
+//
+static uint32_t crc32( uint32_t crc, const uint8_t *pData, uint32_t length )
+{
+	static const uint32_t	table[ 16 ] =
+	{
+		0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+		0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+		0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+		0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+	};
+
+	crc = ~crc;
+
+	for( uint32_t idx = 0 ; idx < length ; idx++ )
+	{
+		crc = (crc >> 4) ^ table[ (crc ^ pData[ idx ]) & 0x0F ];
+		crc = (crc >> 4) ^ table[ (crc ^ (pData[ idx ] >> 4)) & 0x0F ];
+	}
+
+	return( ~crc );
+}
+
+
+//**************************************************************************
+//	put_u16 / put_u32 / get_u16 / get_u32
+//--------------------------------------------------------------------------
+//	the image is little endian on every platform
+//
+static inline void put_u16( uint8_t *pData, uint16_t value )
+{
+	pData[ 0 ] = (uint8_t)value;
+	pData[ 1 ] = (uint8_t)(value >> 8);
+}
+
+static inline void put_u32( uint8_t *pData, uint32_t value )
+{
+	put_u16( pData, (uint16_t)value );
+	put_u16( &(pData[ 2 ]), (uint16_t)(value >> 16) );
+}
+
+static inline uint16_t get_u16( const uint8_t *pData )
+{
+	return( (uint16_t)(pData[ 0 ] | (pData[ 1 ] << 8)) );
+}
+
+static inline uint32_t get_u32( const uint8_t *pData )
+{
+	return( get_u16( pData ) | ((uint32_t)get_u16( &(pData[ 2 ]) ) << 16) );
+}
+
+
+//**************************************************************************
+//	put_bitmap / get_bitmap
+//--------------------------------------------------------------------------
+//	returns the position behind the bitmap
+//
+static uint32_t put_bitmap( uint8_t *pImage, uint32_t pos, const uint32_t *pBitmap, uint16_t words )
+{
+	for( uint16_t idx = 0 ; idx < words ; idx++, pos += 4 )
+	{
+		put_u32( &(pImage[ pos ]), pBitmap[ idx ] );
+	}
+
+	return( pos );
+}
+
+static uint32_t get_bitmap( const uint8_t *pImage, uint32_t pos, uint32_t *pBitmap, uint16_t words )
+{
+	for( uint16_t idx = 0 ; idx < words ; idx++, pos += 4 )
+	{
+		pBitmap[ idx ] = get_u32( &(pImage[ pos ]) );
+	}
+
+	return( pos );
+}
+
+
+//**************************************************************************
+//	build_header
+//--------------------------------------------------------------------------
+//	the layout is part of the header, an image of a build with
+//	other sizes is not used
+//
+static void build_header( uint8_t *pHeader )
+{
+	memcpy( pHeader, LOCONET_PERSIST_MAGIC, 4 );
+
+	pHeader[ 4 ] = LOCONET_PERSIST_VERSION;
+	pHeader[ 5 ] = 0;
+
+	put_u16( &(pHeader[  6 ]), LOCONET_PERSIST_PAGE_SIZE );
+	put_u16( &(pHeader[  8 ]), LOCONET_PERSIST_NUM_PAGES );
+	put_u16( &(pHeader[ 10 ]), LOCONET_STATE_CACHE_MAX_SENSORS );
+	put_u16( &(pHeader[ 12 ]), LOCONET_STATE_CACHE_MAX_SWITCHES );
+	put_u16( &(pHeader[ 14 ]), LOCONET_SLOT_TABLE_SIZE );
+	put_u32( &(pHeader[ 16 ]), crc32( 0, pHeader, 16 ) );
+}
+
+
+//**************************************************************************
+//	build_image
+//--------------------------------------------------------------------------
+//	serialize the current state into 'image'
+//
+static void build_image( loconet_persist_t *pPersist )
+{
+	loconet_state_snapshot_t	*pState	= &(pPersist->snapshot);
+	uint8_t						*pImage	= pPersist->image;
+	const loconet_slot_t		*pSlot;
+	uint32_t					pos;
+
+	loconet_state_cache_snapshot( pPersist->pCache, pState );
+
+	memset( pImage, 0, sizeof( pPersist->image ) );
+
+	pos = put_bitmap( pImage, 0,   pState->sensorState,  SENSOR_WORDS );
+	pos = put_bitmap( pImage, pos, pState->sensorKnown,  SENSOR_WORDS );
+	pos = put_bitmap( pImage, pos, pState->switchClosed, SWITCH_WORDS );
+	pos = put_bitmap( pImage, pos, pState->switchOutput, SWITCH_WORDS );
+	pos = put_bitmap( pImage, pos, pState->switchKnown,  SWITCH_WORDS );
+
+	for( uint8_t slot = 0 ; LOCONET_SLOT_TABLE_SIZE > slot ; slot++, pos += LOCONET_PERSIST_SLOT_SIZE )
+	{
+		pSlot = loconet_slot_table_get_slot( pPersist->pTable, slot );
+
+		put_u16( &(pImage[ pos ]),     pSlot->address );
+		put_u16( &(pImage[ pos + 2 ]), pSlot->id );
+
+		pImage[ pos +  4 ] = pSlot->stat;
+		pImage[ pos +  5 ] = pSlot->spd;
+		pImage[ pos +  6 ] = pSlot->dirf;
+		pImage[ pos +  7 ] = pSlot->snd;
+		pImage[ pos +  8 ] = pSlot->trk;
+		pImage[ pos +  9 ] = pSlot->ss2;
+		pImage[ pos + 10 ] = pSlot->valid ? 1 : 0;
+	}
+}
+
+
+//**************************************************************************
+//	range_valid
+//--------------------------------------------------------------------------
+//	true if all pages with bytes of the range were restored
+//
+static bool range_valid( loconet_persist_t *pPersist, uint32_t offset, uint32_t length )
+{
+	for(	uint32_t page = offset / LOCONET_PERSIST_PAGE_SIZE ;
+			page <= ((offset + length - 1) / LOCONET_PERSIST_PAGE_SIZE) ;
+			page++																)
+	{
+		if( !pPersist->pageValid[ page ] )
+		{
+			return( false );
+		}
+	}
+
+	return( true );
+}
+
+
+//**************************************************************************
+//	bit_valid
+//--------------------------------------------------------------------------
+//	true if the word with 'bit' of the bitmap at 'offset' was restored
+//
+static bool bit_valid( loconet_persist_t *pPersist, uint32_t offset, uint16_t bit )
+{
+	return( range_valid( pPersist, offset + ((uint32_t)(bit >> 5) * 4), 4 ) );
+}
+
+
+//**************************************************************************
+//	apply_image
+//--------------------------------------------------------------------------
+//	set the restored state in the state cache and the slot table.
+//	The state and the known bits of an item are on different pages,
+//	so an item is only set if the pages of all its bits are okay.
+//
+static void apply_image( loconet_persist_t *pPersist )
+{
+	loconet_state_snapshot_t	*pState	= &(pPersist->snapshot);
+	const uint8_t				*pImage	= pPersist->stored;
+	loconet_slot_t				slot;
+	uint32_t					offSensorState	= 0;
+	uint32_t					offSensorKnown;
+	uint32_t					offSwitchClosed;
+	uint32_t					offSwitchOutput;
+	uint32_t					offSwitchKnown;
+	uint32_t					pos;
+	uint32_t					mask;
+	uint16_t					bit;
+
+	offSensorKnown	= get_bitmap( pImage, offSensorState,  pState->sensorState,  SENSOR_WORDS );
+	offSwitchClosed	= get_bitmap( pImage, offSensorKnown,  pState->sensorKnown,  SENSOR_WORDS );
+	offSwitchOutput	= get_bitmap( pImage, offSwitchClosed, pState->switchClosed, SWITCH_WORDS );
+	offSwitchKnown	= get_bitmap( pImage, offSwitchOutput, pState->switchOutput, SWITCH_WORDS );
+	pos				= get_bitmap( pImage, offSwitchKnown,  pState->switchKnown,  SWITCH_WORDS );
+
+	for( bit = 0 ; LOCONET_STATE_CACHE_MAX_SENSORS > bit ; bit++ )
+	{
+		mask = 1UL << (bit & 31);
+
+		if(		(pState->sensorKnown[ bit >> 5 ] & mask)
+			&&	bit_valid( pPersist, offSensorState, bit )
+			&&	bit_valid( pPersist, offSensorKnown, bit )	)
+		{
+			loconet_state_cache_set_sensor( pPersist->pCache, bit + 1, 0 != (pState->sensorState[ bit >> 5 ] & mask) );
+		}
+	}
+
+	for( bit = 0 ; LOCONET_STATE_CACHE_MAX_SWITCHES > bit ; bit++ )
+	{
+		mask = 1UL << (bit & 31);
+
+		if(		(pState->switchKnown[ bit >> 5 ] & mask)
+			&&	bit_valid( pPersist, offSwitchClosed, bit )
+			&&	bit_valid( pPersist, offSwitchOutput, bit )
+			&&	bit_valid( pPersist, offSwitchKnown, bit )	)
+		{
+			loconet_state_cache_set_switch(	pPersist->pCache,
+											bit + 1,
+											0 != (pState->switchClosed[ bit >> 5 ] & mask),
+											0 != (pState->switchOutput[ bit >> 5 ] & mask)	);
+		}
+	}
+
+	for( uint8_t idx = 0 ; LOCONET_SLOT_TABLE_SIZE > idx ; idx++, pos += LOCONET_PERSIST_SLOT_SIZE )
+	{
+		if(		(0 == pImage[ pos + 10 ])
+			||	!range_valid( pPersist, pos, LOCONET_PERSIST_SLOT_SIZE )	)
+		{
+			continue;
+		}
+
+		memset( &slot, 0, sizeof( slot ) );
+
+		slot.address	= get_u16( &(pImage[ pos ]) );
+		slot.id			= get_u16( &(pImage[ pos + 2 ]) );
+		slot.stat		= pImage[ pos + 4 ];
+		slot.spd		= pImage[ pos + 5 ];
+		slot.dirf		= pImage[ pos + 6 ];
+		slot.snd		= pImage[ pos + 7 ];
+		slot.trk		= pImage[ pos + 8 ];
+		slot.ss2		= pImage[ pos + 9 ];
+		slot.valid		= true;
+
+		loconet_slot_table_set_slot( pPersist->pTable, idx, &slot );
+	}
+}
+
+
+//**************************************************************************
+//	write_page
+//--------------------------------------------------------------------------
+//	a page is written with its index and a CRC, so a page that was
+//	not written completely is found by the restore
+//
+static uint8_t write_page( loconet_persist_t *pPersist, uint16_t page )
+{
+	uint8_t	record[ LOCONET_PERSIST_PAGE_RECORD_SIZE ];
+
+	put_u32( record, page );
+	memcpy( &(record[ 4 ]), &(pPersist->image[ page * LOCONET_PERSIST_PAGE_SIZE ]), LOCONET_PERSIST_PAGE_SIZE );
+	put_u32( &(record[ 4 + LOCONET_PERSIST_PAGE_SIZE ]), crc32( 0, record, 4 + LOCONET_PERSIST_PAGE_SIZE ) );
+
+	return( (*pPersist->backend.pWrite)( pPersist->backend.pContext, PAGE_OFFSET( page ), record, sizeof( record ) ) );
+}
+
+
+//**************************************************************************
+//	slot_changed
+//--------------------------------------------------------------------------
+//	notify function of the slot table
+//
+static void slot_changed( void *pContext, uint8_t slot, uint8_t changed )
+{
+	((loconet_persist_t *)pContext)->slotsChanged = true;
+}
+
+
+#ifdef __linux__
+//**************************************************************************
+//	file_read / file_write / file_sync
+//--------------------------------------------------------------------------
+//	the functions of the file backend
+//
+static uint8_t file_read( void *pContext, uint32_t offset, void *pData, uint32_t length )
+{
+	loconet_persist_file_t	*pFile = (loconet_persist_file_t *)pContext;
+
+	return( ((ssize_t)length == pread( pFile->fd, pData, length, offset )) ? 0 : 1 );
+}
+
+static uint8_t file_write( void *pContext, uint32_t offset, const void *pData, uint32_t length )
+{
+	loconet_persist_file_t	*pFile = (loconet_persist_file_t *)pContext;
+
+	return( ((ssize_t)length == pwrite( pFile->fd, pData, length, offset )) ? 0 : 1 );
+}
+
+static uint8_t file_sync( void *pContext )
+{
+	loconet_persist_file_t	*pFile = (loconet_persist_file_t *)pContext;
+
+	return( (0 == fdatasync( pFile->fd )) ? 0 : 1 );
+}
+#endif
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_persist_init
+//--------------------------------------------------------------------------
+//
+void loconet_persist_init(	loconet_persist_t					*pPersist,
+							loconet_consumer_state_cache_t		*pCache,
+							loconet_consumer_slot_table_t		*pTable,
+							const loconet_persist_backend_t		*pBackend	)
+{
+	memset( pPersist, 0, sizeof( loconet_persist_t ) );
+
+	pPersist->pCache	= pCache;
+	pPersist->pTable	= pTable;
+	pPersist->backend	= *pBackend;
+
+	loconet_slot_table_register_notify( pTable, slot_changed, pPersist );
+}
+
+
+//**************************************************************************
+//	loconet_persist_restore
+//--------------------------------------------------------------------------
+//
+uint8_t loconet_persist_restore( loconet_persist_t *pPersist )
+{
+	uint8_t		header[ LOCONET_PERSIST_HEADER_SIZE ];
+	uint8_t		expected[ LOCONET_PERSIST_HEADER_SIZE ];
+	uint8_t		record[ LOCONET_PERSIST_PAGE_RECORD_SIZE ];
+	uint16_t	cntBroken = 0;
+
+	if( 0 != (*pPersist->backend.pRead)( pPersist->backend.pContext, 0, header, sizeof( header ) ) )
+	{
+		return( 1 );
+	}
+
+	if( 0 != memcmp( header, LOCONET_PERSIST_MAGIC, 4 ) )
+	{
+		return( 1 );
+	}
+
+	build_header( expected );
+
+	if( 0 != memcmp( header, expected, sizeof( header ) ) )
+	{
+		return( 2 );
+	}
+
+	pPersist->headerValid = true;
+
+	for( uint16_t page = 0 ; LOCONET_PERSIST_NUM_PAGES > page ; page++ )
+	{
+		if(		(0 != (*pPersist->backend.pRead)( pPersist->backend.pContext, PAGE_OFFSET( page ), record, sizeof( record ) ))
+			||	(page != get_u32( record ))
+			||	(crc32( 0, record, 4 + LOCONET_PERSIST_PAGE_SIZE ) != get_u32( &(record[ 4 + LOCONET_PERSIST_PAGE_SIZE ]) ))	)
+		{
+			cntBroken++;
+			continue;
+		}
+
+		memcpy( &(pPersist->stored[ page * LOCONET_PERSIST_PAGE_SIZE ]), &(record[ 4 ]), LOCONET_PERSIST_PAGE_SIZE );
+
+		pPersist->pageValid[ page ] = true;
+	}
+
+	apply_image( pPersist );
+
+	//------------------------------------------------------------------
+	//	the restored state is not a change that must be written again
+	//
+	pPersist->lastGeneration	= loconet_state_cache_get_generation( pPersist->pCache );
+	pPersist->slotsChanged		= (0 < cntBroken);
+
+	return( (0 < cntBroken) ? 3 : 0 );
+}
+
+
+//**************************************************************************
+//	loconet_persist_checkpoint
+//--------------------------------------------------------------------------
+//
+uint8_t loconet_persist_checkpoint( loconet_persist_t *pPersist )
+{
+	uint8_t		header[ LOCONET_PERSIST_HEADER_SIZE ];
+	uint32_t	generation	= loconet_state_cache_get_generation( pPersist->pCache );
+	uint16_t	cntWritten	= 0;
+	uint8_t		result		= 0;
+
+	if(		pPersist->headerValid
+		&&	(generation == pPersist->lastGeneration)
+		&&	!pPersist->slotsChanged						)
+	{
+		return( 0 );
+	}
+
+	pPersist->cntCheckpoints++;
+
+	if( !pPersist->headerValid )
+	{
+		build_header( header );
+
+		if( 0 != (*pPersist->backend.pWrite)( pPersist->backend.pContext, 0, header, sizeof( header ) ) )
+		{
+			pPersist->cntErrors++;
+			return( 1 );
+		}
+
+		pPersist->headerValid = true;
+	}
+
+	pPersist->slotsChanged = false;
+
+	build_image( pPersist );
+
+	for( uint16_t page = 0 ; LOCONET_PERSIST_NUM_PAGES > page ; page++ )
+	{
+		uint8_t	*pImage		= &(pPersist->image[ page * LOCONET_PERSIST_PAGE_SIZE ]);
+		uint8_t	*pStored	= &(pPersist->stored[ page * LOCONET_PERSIST_PAGE_SIZE ]);
+
+		if(		pPersist->pageValid[ page ]
+			&&	(0 == memcmp( pImage, pStored, LOCONET_PERSIST_PAGE_SIZE ))	)
+		{
+			continue;
+		}
+
+		if( 0 != write_page( pPersist, page ) )
+		{
+			pPersist->cntErrors++;
+			pPersist->slotsChanged = true;		//	try again next time
+			result = 1;
+			continue;
+		}
+
+		memcpy( pStored, pImage, LOCONET_PERSIST_PAGE_SIZE );
+
+		pPersist->pageValid[ page ] = true;
+		pPersist->cntPagesWritten++;
+		cntWritten++;
+	}
+
+	if( (0 < cntWritten) && (NULL != pPersist->backend.pSync) )
+	{
+		(*pPersist->backend.pSync)( pPersist->backend.pContext );
+	}
+
+	pPersist->lastGeneration = generation;
+
+	return( result );
+}
+
+
+#ifdef __linux__
+//**************************************************************************
+//	loconet_persist_file_open
+//--------------------------------------------------------------------------
+//
+uint8_t loconet_persist_file_open(	loconet_persist_file_t		*pFile,
+									const char					*pPath,
+									loconet_persist_backend_t	*pBackend	)
+{
+	pFile->fd = open( pPath, O_RDWR | O_CREAT | O_CLOEXEC, 0644 );
+
+	if( 0 > pFile->fd )
+	{
+		return( 1 );
+	}
+
+	pBackend->pRead		= file_read;
+	pBackend->pWrite	= file_write;
+	pBackend->pSync		= file_sync;
+	pBackend->pContext	= pFile;
+
+	return( 0 );
+}
+
+
+//**************************************************************************
+//	loconet_persist_file_close
+//--------------------------------------------------------------------------
+//
+void loconet_persist_file_close( loconet_persist_file_t *pFile )
+{
+	if( 0 <= pFile->fd )
+	{
+		close( pFile->fd );
+	}
+
+	pFile->fd = -1;
+}
+#endif
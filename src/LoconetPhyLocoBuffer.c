@@ -0,0 +1,403 @@
+//##########################################################################
+//#
+//#		LoconetPhyLocoBuffer.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library connect the bus to a
+//#	serial stream with the LocoBuffer / PR3 protocol: the raw loconet
+//#	messages in both directions, 57600 baud or faster.
+//#	Received bytes are read in blocks, messages for the stream are
+//#	collected and written with one write() per call of
+//#	loconet_phy_locobuffer_process().
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#ifdef __linux__
+	#define _GNU_SOURCE		//	ptsname_r()
+#endif
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+#include "LoconetPhyLocoBuffer.h"
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	baud_to_speed
+//--------------------------------------------------------------------------
+//	returns 0 for a baud rate that is not supported
+//
+static speed_t baud_to_speed( uint32_t baud )
+{
+	switch( baud )
+	{
+		case 57600:		return( B57600 );
+		case 115200:	return( B115200 );
+#ifdef B230400
+		case 230400:	return( B230400 );
+#endif
+#ifdef B460800
+		case 460800:	return( B460800 );
+#endif
+#ifdef B921600
+		case 921600:	return( B921600 );
+#endif
+		default:		return( 0 );
+	}
+}
+
+
+//**************************************************************************
+//	queue_msg
+//--------------------------------------------------------------------------
+//	copy the message into the tx buffer, it will be written with
+//	the next call of loconet_phy_locobuffer_process()
+//
+static void queue_msg( loconet_phy_locobuffer_t *pPhy, LnMsg *pMsg )
+{
+	uint8_t	length = LOCONET_PACKET_SIZE( pMsg->sz.command, pMsg->sz.mesg_size );
+
+	if(		(LN_BUF_SIZE < length)
+		||	((LOCONET_LOCOBUFFER_TX_BUF_SIZE - pPhy->txLen) < length)	)
+	{
+		pPhy->cntTxDropped++;
+		pPhy->txStats.txErrors++;
+		return;
+	}
+
+	memcpy( &(pPhy->txBuf[ pPhy->txLen ]), pMsg->data, length );
+
+	pPhy->txLen += length;
+	pPhy->txStats.txPackets++;
+}
+
+
+//**************************************************************************
+//	receive_bytes
+//--------------------------------------------------------------------------
+//	frame the bytes of one block and spread the messages over the bus
+//
+static void receive_bytes( loconet_phy_locobuffer_t *pPhy, uint16_t count )
+{
+	LnMsg	*pMsg;
+	LnMsg	aMsg;
+
+	for( uint16_t idx = 0 ; idx < count ; idx++ )
+	{
+		if(		(pPhy->rxBlock[ idx ] & LOCONET_OPC_MASK)
+			&&	(0 < pPhy->rxMsg.index)
+			&&	(	(pPhy->rxMsg.index != pPhy->rxMsg.expLen)
+				||	(0 != pPhy->rxMsg.checkSum)					)	)
+		{
+			pPhy->rxStats.rxErrors++;
+		}
+
+		pMsg = loconet_msg_buffer_add_byte( &(pPhy->rxMsg), pPhy->rxBlock[ idx ] );
+
+		if( NULL != pMsg )
+		{
+			//----------------------------------------------------------
+			//	a consumer may send a reply, so the msg buffer
+			//	must not be used while the bus is busy
+			//
+			memcpy( &aMsg, pMsg, sizeof( LnMsg ) );
+
+			pPhy->rxStats.rxPackets++;
+
+			if( pPhy->echo && !pPhy->useLoopback )
+			{
+				queue_msg( pPhy, &aMsg );
+			}
+
+			loconet_bus_broadcast( pPhy->pBus, &aMsg, loconet_phy_locobuffer_send );
+		}
+	}
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_phy_locobuffer_init
+//--------------------------------------------------------------------------
+//	the stream is switched to non-blocking mode
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	no free consumer entry on the bus
+//
+uint8_t loconet_phy_locobuffer_init(	loconet_phy_locobuffer_t	*pPhy,
+									loconet_bus_t				*pBus,
+									int							fd,
+									bool						echo	)
+{
+	int	flags = fcntl( fd, F_GETFL, 0 );
+
+	memset( pPhy, 0, sizeof( loconet_phy_locobuffer_t ) );
+
+	pPhy->pBus	= pBus;
+	pPhy->fd	= fd;
+	pPhy->echo	= echo;
+
+	if( 0 <= flags )
+	{
+		fcntl( fd, F_SETFL, flags | O_NONBLOCK );
+	}
+
+	loconet_msg_buffer_init( &(pPhy->rxMsg) );
+
+	return( loconet_bus_register_consumer( pBus, pPhy, loconet_phy_locobuffer_send ) );
+}
+
+
+//**************************************************************************
+//	loconet_phy_locobuffer_open
+//--------------------------------------------------------------------------
+//
+uint8_t loconet_phy_locobuffer_open(	loconet_phy_locobuffer_t	*pPhy,
+										loconet_bus_t				*pBus,
+										const char					*pPath,
+										uint32_t					baud,
+										bool						echo	)
+{
+	struct termios	tio;
+	speed_t			speed	= baud_to_speed( baud );
+	int				fd;
+
+	if( 0 == speed )
+	{
+		return( 2 );
+	}
+
+	fd = open( pPath, O_RDWR | O_NOCTTY | O_NONBLOCK );
+
+	if( 0 > fd )
+	{
+		return( 1 );
+	}
+
+	if( isatty( fd ) )
+	{
+		if( 0 != tcgetattr( fd, &tio ) )
+		{
+			close( fd );
+			return( 2 );
+		}
+
+		//--------------------------------------------------------------
+		//	raw 8N1, the PR3 and LocoBuffer-USB use CTS flow control,
+		//	but a stream without the lines must work too
+		//
+		tio.c_iflag		&= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF);
+		tio.c_oflag		&= ~OPOST;
+		tio.c_lflag		&= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+		tio.c_cflag		&= ~(CSIZE | PARENB | CSTOPB);
+		tio.c_cflag		|= CS8 | CREAD | CLOCAL;
+		tio.c_cc[ VMIN ]	= 0;
+		tio.c_cc[ VTIME ]	= 0;
+
+		cfsetispeed( &tio, speed );
+		cfsetospeed( &tio, speed );
+
+		if( 0 != tcsetattr( fd, TCSANOW, &tio ) )
+		{
+			close( fd );
+			return( 2 );
+		}
+	}
+
+	if( 0 != loconet_phy_locobuffer_init( pPhy, pBus, fd, echo ) )
+	{
+		close( fd );
+		return( 3 );
+	}
+
+	return( 0 );
+}
+
+
+#ifdef __linux__
+//**************************************************************************
+//	loconet_phy_locobuffer_open_pty
+//--------------------------------------------------------------------------
+//	the phy uses the master side of the pty
+//
+uint8_t loconet_phy_locobuffer_open_pty(	loconet_phy_locobuffer_t	*pPhy,
+											loconet_bus_t				*pBus,
+											char						*pSlaveName,
+											size_t						nameSize,
+											bool						echo	)
+{
+	struct termios	tio;
+	int				fd = posix_openpt( O_RDWR | O_NOCTTY );
+
+	if( 0 > fd )
+	{
+		return( 1 );
+	}
+
+	if(		(0 != grantpt( fd ))
+		||	(0 != unlockpt( fd ))
+		||	(0 != ptsname_r( fd, pSlaveName, nameSize ))	)
+	{
+		close( fd );
+		return( 1 );
+	}
+
+	//------------------------------------------------------------------
+	//	no line discipline on the master side, the bytes must not
+	//	be changed (e.g. 0x0D => 0x0A)
+	//
+	if( 0 == tcgetattr( fd, &tio ) )
+	{
+		cfmakeraw( &tio );
+		tcsetattr( fd, TCSANOW, &tio );
+	}
+
+	if( 0 != loconet_phy_locobuffer_init( pPhy, pBus, fd, echo ) )
+	{
+		close( fd );
+		return( 3 );
+	}
+
+	return( 0 );
+}
+#endif
+
+
+//**************************************************************************
+//	loconet_phy_locobuffer_close
+//--------------------------------------------------------------------------
+//
+void loconet_phy_locobuffer_close( loconet_phy_locobuffer_t *pPhy )
+{
+	if( 0 <= pPhy->fd )
+	{
+		close( pPhy->fd );
+	}
+
+	pPhy->fd	= -1;
+	pPhy->txLen	= 0;
+}
+
+
+//**************************************************************************
+//	loconet_phy_locobuffer_use_loopback
+//--------------------------------------------------------------------------
+//
+void loconet_phy_locobuffer_use_loopback( loconet_phy_locobuffer_t *pPhy, bool enable )
+{
+	pPhy->useLoopback = enable;
+
+	loconet_bus_set_loopback( pPhy->pBus, loconet_phy_locobuffer_send, enable );
+}
+
+
+//**************************************************************************
+//	loconet_phy_locobuffer_process
+//--------------------------------------------------------------------------
+//
+void loconet_phy_locobuffer_process( loconet_phy_locobuffer_t *pPhy )
+{
+	ssize_t	count;
+
+	if( 0 > pPhy->fd )
+	{
+		return;
+	}
+
+	//------------------------------------------------------------------
+	//	read everything that is available, block by block
+	//
+	while( 0 < (count = read( pPhy->fd, pPhy->rxBlock, LOCONET_LOCOBUFFER_RX_BLOCK_SIZE )) )
+	{
+		receive_bytes( pPhy, (uint16_t)count );
+
+		if( LOCONET_LOCOBUFFER_RX_BLOCK_SIZE > count )
+		{
+			break;
+		}
+	}
+
+	//------------------------------------------------------------------
+	//	write all collected messages at once, what the stream
+	//	does not take now is written with the next call
+	//
+	if( 0 < pPhy->txLen )
+	{
+		count = write( pPhy->fd, pPhy->txBuf, pPhy->txLen );
+
+		if( 0 < count )
+		{
+			pPhy->txLen -= (uint16_t)count;
+
+			memmove( pPhy->txBuf, &(pPhy->txBuf[ count ]), pPhy->txLen );
+		}
+	}
+}
+
+
+//**************************************************************************
+//	loconet_phy_locobuffer_send
+//--------------------------------------------------------------------------
+//	the message is only queued, it will be written with the next call
+//	of loconet_phy_locobuffer_process().
+//	Of the loopbacks only our own messages are used as echo, the
+//	others were already spread on the bus.
+//
+void loconet_phy_locobuffer_send( loconet_bus_consumer pConsumer, LnMsg *pMsg )
+{
+	loconet_phy_locobuffer_t	*pPhy = (loconet_phy_locobuffer_t *)pConsumer;
+
+	if(		loconet_bus_is_loopback( pPhy->pBus )
+		&&	(	!pPhy->echo
+			||	(loconet_phy_locobuffer_send != loconet_bus_get_sender( pPhy->pBus ))	)	)
+	{
+		return;
+	}
+
+	if( 0 <= pPhy->fd )
+	{
+		queue_msg( pPhy, pMsg );
+	}
+}
@@ -37,12 +37,14 @@
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include <hal/uart_hal.h>
 #include <esp_timer.h>
 #include <driver/gpio.h>
 
 #include "LoconetPhyUART.h"
+#include "LoconetTrace.h"
 
 
 //==========================================================================
@@ -51,16 +53,24 @@
 //
 //==========================================================================
 
-#define TASK_STACK_SIZE					1024
-
 #define RX_QUEUE_LENGTH					64
-#define TX_QUEUE_LENGTH					32
+#define TX_PRIO_QUEUE_LENGTH			8
+
+#define TX_MAX_TRIES					25
+
+//	state of a tx track entry
+#define TRACK_FREE						0
+#define TRACK_BUSY						1		//	owned by the sender and the rx/tx task
+#define TRACK_DONE						2		//	to be given to the completion function
 
 
 #define LOCONET_TICK_TIME				60
 #define LOCONET_CARRIER_TICKS			20
 #define LOCONET_COLLISION_TICKS			15
 
+//	one byte takes 600 us on the wire
+#define ECHO_WAIT_TICKS					2
+
 #define COLLISION_TIMEOUT_INCREMENT		(LOCONET_COLLISION_TICKS * LOCONET_TICK_TIME)
 #define CD_BACKOFF_TIMEOUT_INCREMENT	(LOCONET_CARRIER_TICKS   * LOCONET_TICK_TIME)
 
@@ -71,6 +81,17 @@
 //
 //==========================================================================
 
+//----------------------------------------------------------------------
+//	an entry of the tx priority queue
+//
+typedef struct tx_prio_entry
+{
+	LnMsg		msg;
+	const void	*pSender;
+	uint8_t		tag;
+
+} tx_prio_entry_t;
+
 
 //==========================================================================
 //
@@ -79,13 +100,17 @@
 //==========================================================================
 
 StaticTask_t	xTaskBuffer;
-StackType_t		xStack[ TASK_STACK_SIZE ];
+StackType_t		xStack[ LOCONET_PHY_TASK_STACK_SIZE ];
+
+StaticTask_t	xDispatchTaskBuffer;
+StackType_t		xDispatchStack[ LOCONET_PHY_DISPATCH_STACK_SIZE ];
 
 StaticQueue_t	rxQueueBuffer;
-StaticQueue_t	txQueueBuffer;
+StaticQueue_t	txPrioQueueBuffer;
 
-uint8_t			rxQueueStorage[ RX_QUEUE_LENGTH * sizeof( LnMsg ) ];
-uint8_t			txQueueStorage[ TX_QUEUE_LENGTH * sizeof( LnMsg ) ];
+uint8_t			rxQueueStorage[ RX_QUEUE_LENGTH * sizeof( loconet_phy_rx_entry_t ) ];
+uint8_t			txPrioQueueStorage[ TX_PRIO_QUEUE_LENGTH * sizeof( tx_prio_entry_t ) ];
+uint8_t			rxRingStorage[ LOCONET_PHY_RX_RING_SIZE * sizeof( loconet_phy_rx_entry_t ) ];
 
 uart_config_t uart_config =
 {
@@ -168,6 +193,218 @@ bool isCDBackoffTimerElapsed( loconet_phy_uart_t *pUart )
 }
 
 
+//**************************************************************************
+//	dispatch_safety_msg
+//--------------------------------------------------------------------------
+//	call the safety handlers directly from the rx/tx task, so a safety
+//	message does not wait in the rx queue. The latency is measured
+//	from the first byte of the message until all handlers are done.
+//
+static void dispatch_safety_msg( loconet_phy_uart_t *pUart, LnMsg *pMsg )
+{
+	uint32_t	latency;
+
+	for( uint8_t idx = 0 ; idx < pUart->numSafetyHandlers ; idx++ )
+	{
+		(*pUart->pSafetyFunc[ idx ])( pUart->pSafetyContext[ idx ], pMsg );
+	}
+
+	latency = (uint32_t)((uint64_t)esp_timer_get_time() - pUart->rxStartTime);
+
+	pUart->cntSafetyRx++;
+	pUart->safetyLatencyLast = latency;
+
+	if( pUart->safetyLatencyMax < latency )
+	{
+		pUart->safetyLatencyMax = latency;
+	}
+}
+
+
+//**************************************************************************
+//	complete_tx_track
+//--------------------------------------------------------------------------
+//	called by the rx/tx task at the end of a tracked message
+//
+static void complete_tx_track( loconet_phy_uart_t *pUart, uint8_t tag, loconet_tx_done_t status )
+{
+	loconet_phy_tx_track_t	*pTrack;
+
+	if( (0 == tag) || (LOCONET_PHY_MAX_TX_TRACK < tag) )
+	{
+		return;
+	}
+
+	pTrack = &(pUart->txTrack[ tag - 1 ]);
+
+	pTrack->completion.status		= status;
+	pTrack->completion.cntRetries	= TX_MAX_TRIES - pUart->cntTry;
+	pTrack->completion.timeDone		= (uint64_t)esp_timer_get_time();
+
+	atomic_store_explicit( &(pTrack->state), TRACK_DONE, memory_order_release );
+
+	if( pUart->pipeline )
+	{
+		xTaskNotifyGive( pUart->dispatchTask );
+	}
+}
+
+
+//**************************************************************************
+//	deliver_tx_completions
+//--------------------------------------------------------------------------
+//	call the completion functions of the finished tracked messages.
+//	The entry is free again before the function is called, so the
+//	function can send the next message.
+//
+static void deliver_tx_completions( loconet_phy_uart_t *pUart )
+{
+	loconet_phy_tx_track_t			*pTrack;
+	loconet_phy_tx_completion_t		completion;
+	loconet_phy_uart_func_tx_done	pFunc;
+	void							*pContext;
+	uint32_t						latency;
+
+	for( uint8_t idx = 0 ; LOCONET_PHY_MAX_TX_TRACK > idx ; idx++ )
+	{
+		pTrack = &(pUart->txTrack[ idx ]);
+
+		if( TRACK_DONE != atomic_load_explicit( &(pTrack->state), memory_order_acquire ) )
+		{
+			continue;
+		}
+
+		completion	= pTrack->completion;
+		pFunc		= pTrack->pFunc;
+		pContext	= pTrack->pContext;
+
+		atomic_store_explicit( &(pTrack->state), TRACK_FREE, memory_order_release );
+
+		if( LN_TX_DONE_OK == completion.status )
+		{
+			latency = (uint32_t)(completion.timeDone - completion.timeQueued);
+
+			pUart->txLatencyLast = latency;
+
+			if( pUart->txLatencyMax < latency )
+			{
+				pUart->txLatencyMax = latency;
+			}
+		}
+
+		if( NULL != pFunc )
+		{
+			(*pFunc)( pContext, &completion );
+		}
+	}
+}
+
+
+//**************************************************************************
+//	enqueue_rx_entry
+//--------------------------------------------------------------------------
+//	hand over a received or an own message to the dispatching,
+//	an own message only if a consumer wants the loopback
+//
+static void enqueue_rx_entry( loconet_phy_uart_t *pUart, loconet_phy_rx_entry_t *pEntry )
+{
+	if(		(pEntry->flags & LOCONET_PHY_RX_OWN)
+		&&	!loconet_bus_has_loopback( pUart->pBus )	)
+	{
+		return;
+	}
+
+	if( !pUart->pipeline )
+	{
+		if( pdTRUE != xQueueSendToBack( pUart->rxQueue, (void *)pEntry, 0 ) )
+		{
+			pUart->cntRxQueueFull++;
+		}
+	}
+	else if( loconet_ring_push( &(pUart->rxRing), pEntry ) )
+	{
+		xTaskNotifyGive( pUart->dispatchTask );
+	}
+	else
+	{
+		pUart->cntRxRingFull++;
+	}
+}
+
+
+//**************************************************************************
+//	dispatch_rx_entry
+//--------------------------------------------------------------------------
+//	a received message goes to all other consumers, an own message
+//	only to the consumers with loopback
+//
+static void dispatch_rx_entry( loconet_phy_uart_t *pUart, loconet_phy_rx_entry_t *pEntry )
+{
+	LN_TRACE( LN_TRACE_RX_DEQUEUE, pEntry->msg.sz.command );
+
+	if( pEntry->flags & LOCONET_PHY_RX_OWN )
+	{
+		loconet_bus_loopback( pUart->pBus, &(pEntry->msg), pEntry->pSender );
+	}
+	else
+	{
+		loconet_bus_broadcast( pUart->pBus, &(pEntry->msg), loconet_phy_uart_send );
+	}
+}
+
+
+//**************************************************************************
+//	overrule_waiting
+//--------------------------------------------------------------------------
+//	a safety msg took the lane, the msgs still waiting must not undo
+//	it: after an emergency stop a speed of the slot in the ring or put
+//	aside is turned into a stop and a direction of the slot put aside
+//	is dropped, after power off or idle the speed put aside is dropped
+//
+static void overrule_waiting( loconet_phy_uart_t *pUart, const LnMsg *pSafety )
+{
+	LnMsg	*pDeferred	= &(pUart->txDeferred);
+	bool	drop		= false;
+
+	if( OPC_LOCO_SPD == pSafety->sz.command )
+	{
+		loconet_tx_ring_override_speed( &(pUart->txRing), pSafety->lsp.slot, pSafety->lsp.spd );
+	}
+
+	if( 0x00 == pDeferred->sz.command )
+	{
+		return;
+	}
+
+	if( OPC_LOCO_SPD == pSafety->sz.command )
+	{
+		if(		(OPC_LOCO_SPD == pDeferred->sz.command)
+			&&	(pSafety->lsp.slot == pDeferred->lsp.slot)	)
+		{
+			pDeferred->lsp.spd = OPC_LOCO_SPD_ESTOP;
+
+			loconet_msg_set_checksum( pDeferred );
+		}
+		else if(	(OPC_LOCO_DIRF == pDeferred->sz.command)
+				&&	(pSafety->lsp.slot == pDeferred->ldf.slot)	)
+		{
+			drop = true;
+		}
+	}
+	else if( OPC_LOCO_SPD == pDeferred->sz.command )
+	{
+		drop = true;
+	}
+
+	if( drop )
+	{
+		pDeferred->sz.command = 0x00;
+
+		complete_tx_track( pUart, pUart->txTagDeferred, LN_TX_DONE_DROPPED );
+	}
+}
+
+
 //**************************************************************************
 //	loconet_phy_uart_rxtx_task
 //--------------------------------------------------------------------------
@@ -175,9 +412,11 @@ bool isCDBackoffTimerElapsed( loconet_phy_uart_t *pUart )
 //
 void loconet_phy_uart_rxtx_task( void *pParameter )
 {
-	loconet_phy_uart_t	*pUart;
-	LnMsg				*pMsg;
-	uint8_t				dataByte;
+	loconet_phy_uart_t		*pUart;
+	LnMsg					*pMsg;
+	loconet_phy_rx_entry_t	entry;
+	tx_prio_entry_t			prioEntry;
+	uint8_t					dataByte;
 
 	pUart = (loconet_phy_uart_t *)pParameter;
 
@@ -192,11 +431,53 @@ void loconet_phy_uart_rxtx_task( void *pParameter )
 
 			do
 			{
+				LN_TRACE( LN_TRACE_RX_BYTE, dataByte );
+
+				if( dataByte & LOCONET_OPC_MASK )
+				{
+					pUart->rxStartTime	= (uint64_t)esp_timer_get_time();
+					pUart->rxResync		= false;
+
+					//----------------------------------------------
+					//	a new opcode while the last message is
+					//	incomplete or has a wrong check sum
+					//
+					if(		(0 < pUart->rxMsg.index)
+						&&	(	(pUart->rxMsg.index != pUart->rxMsg.expLen)
+							||	(0 != pUart->rxMsg.checkSum)				)	)
+					{
+						pUart->rxStats.rxErrors++;
+					}
+				}
+
+				else if( pUart->rxResync )
+				{
+					//----------------------------------------------
+					//	the rest of an echo or the break after a
+					//	collision, this is no message
+					//
+					pUart->cntEchoDiscarded++;
+					continue;
+				}
+
 				pMsg = loconet_msg_buffer_add_byte( &(pUart->rxMsg), dataByte );
 
 				if( NULL != pMsg )
 				{
-					xQueueSendToBack( pUart->rxQueue, (void *)pMsg, 0 );
+					pUart->rxStats.rxPackets++;
+
+					if( loconet_bus_is_safety_msg( pMsg ) )
+					{
+						dispatch_safety_msg( pUart, pMsg );
+					}
+
+					entry.msg		= *pMsg;
+					entry.pSender	= NULL;
+					entry.flags		= 0;
+
+					enqueue_rx_entry( pUart, &entry );
+
+					LN_TRACE( LN_TRACE_RX_ENQUEUE, pMsg->sz.command );
 				}
 
 			} while ( 0 < uart_read_bytes( pUart->uartNum, &dataByte, (uint32_t)1, 0 ) );
@@ -207,8 +488,10 @@ void loconet_phy_uart_rxtx_task( void *pParameter )
 		//	after receiving a loconet message wait Backoff time
 		//	before we go back into IDLE state
 		//
-		else if( (RX == pUart->state) && isCDBackoffTimerElapsed( pUart ) )
+		else if( (CD_BACKOFF == pUart->state) && isCDBackoffTimerElapsed( pUart ) )
 		{
+			LN_TRACE( LN_TRACE_BACKOFF_END, 0 );
+
 			pUart->state = IDLE;
 		}
 		//--------------------------------------------------------------
@@ -217,20 +500,54 @@ void loconet_phy_uart_rxtx_task( void *pParameter )
 		//
 		else if( IDLE == pUart->state )
 		{
-			if( 0x00 == pUart->txMsg.sz.command )
+			if(		uxQueueMessagesWaiting( pUart->txPrioQueue )
+				&&	!loconet_bus_is_safety_msg( &(pUart->txMsg) )	)
+			{
+				//--------------------------------------------------
+				//	a safety msg is pending, it goes first.
+				//	A msg that is still to be retried is put aside
+				//	and will be sent afterwards
+				//
+				if( 0x00 != pUart->txMsg.sz.command )
+				{
+					pUart->txDeferred			= pUart->txMsg;
+					pUart->cntTryDeferred		= pUart->cntTry;
+					pUart->pTxSenderDeferred	= pUart->pTxSender;
+					pUart->txTagDeferred		= pUart->txTag;
+				}
+
+				xQueueReceive( pUart->txPrioQueue, &prioEntry, 0 );
+
+				overrule_waiting( pUart, &(prioEntry.msg) );
+
+				pUart->txMsg		= prioEntry.msg;
+				pUart->pTxSender	= prioEntry.pSender;
+				pUart->txTag		= prioEntry.tag;
+
+				pUart->cntTry	= TX_MAX_TRIES;
+				pUart->state	= TX;
+			}
+			else if( 0x00 == pUart->txMsg.sz.command )
 			{
 				//--------------------------------------------------
 				//	the txMsg is empty so check if there is a
-				//	new loconet message pending
+				//	put aside or a new loconet message pending
 				//
-				if( uxQueueMessagesWaiting( pUart->rxQueue ) )
+				if( 0x00 != pUart->txDeferred.sz.command )
+				{
+					pUart->txMsg					= pUart->txDeferred;
+					pUart->cntTry					= pUart->cntTryDeferred;
+					pUart->pTxSender				= pUart->pTxSenderDeferred;
+					pUart->txTag					= pUart->txTagDeferred;
+					pUart->txDeferred.sz.command	= 0x00;
+					pUart->state					= TX;
+				}
+				else if( loconet_tx_ring_pop( &(pUart->txRing), &(pUart->txMsg), &(pUart->pTxSender), &(pUart->txTag) ) )
 				{
 					//----------------------------------------------
 					//	we should send a loconet msg
 					//
-					xQueueReceive( pUart->txQueue, &(pUart->txMsg), 0 );
-
-					pUart->cntTry	= 25;
+					pUart->cntTry	= TX_MAX_TRIES;
 					pUart->state	= TX;
 				}
 			}
@@ -248,23 +565,47 @@ void loconet_phy_uart_rxtx_task( void *pParameter )
 				uint8_t	recvByte;
 				uint8_t	length = LOCONET_PACKET_SIZE( pUart->txMsg.sz.command, pUart->txMsg.sz.mesg_size );
 
+				LN_TRACE( LN_TRACE_TX_START, pUart->txMsg.sz.command );
+
+				//------------------------------------------------------
+				//	from now on every byte we read is an echo
+				//
+				loconet_msg_buffer_init( &(pUart->rxMsg) );
+
+				if(		(0 != pUart->txTag)
+					&&	(0 == pUart->txTrack[ pUart->txTag - 1 ].completion.timeFirstTry)	)
+				{
+					pUart->txTrack[ pUart->txTag - 1 ].completion.timeFirstTry = (uint64_t)esp_timer_get_time();
+				}
+
 				for( uint8_t idx = 0 ; (idx < length) && (TX == pUart->state) ; idx++ )
 				{
 					sendByte = pUart->txMsg.data[ idx ];
 
 					uart_write_bytes( pUart->uartNum, &sendByte, 1 );
 
-					while( 0 < uart_read_bytes( pUart->uartNum, &recvByte, (uint32_t)1, 0 ) )
-					{
-						;	//	just wait until we receive one byte
-					}
-					
-					if( (sendByte != recvByte) || did_collision_happen_since_last_check( pUart ) )
+					//--------------------------------------------------
+					//	wait for the echo of this byte, a missing echo
+					//	is handled like a collision
+					//
+					if(		(1 != uart_read_bytes( pUart->uartNum, &recvByte, (uint32_t)1, ECHO_WAIT_TICKS ))
+						||	(sendByte != recvByte)
+						||	did_collision_happen_since_last_check( pUart )								)
 					{
+						//----------------------------------------------
+						//	the echo of the bytes sent so far and the
+						//	break must not end up in the next message
+						//
+						loconet_msg_buffer_init( &(pUart->rxMsg) );
+						pUart->rxResync = true;
+
 						startCollisionTimer( pUart );
 
 						pUart->cntTry--;
 						pUart->cntCollisionError++;
+						pUart->txStats.collisions++;
+
+						LN_TRACE( LN_TRACE_TX_COLLISION, pUart->cntTry );
 					}
 				}
 
@@ -273,8 +614,18 @@ void loconet_phy_uart_rxtx_task( void *pParameter )
 					//--------------------------------------------------
 					//	sending of loconet message successfuly done
 					//
+					LN_TRACE( LN_TRACE_TX_ECHO_OK, pUart->txMsg.sz.command );
+
+					entry.msg		= pUart->txMsg;
+					entry.pSender	= (loconet_bus_consumer_func)pUart->pTxSender;
+					entry.flags		= LOCONET_PHY_RX_OWN;
+
+					enqueue_rx_entry( pUart, &entry );
+					complete_tx_track( pUart, pUart->txTag, LN_TX_DONE_OK );
+
 					pUart->txMsg.sz.command		= 0x00;
 					pUart->txMsg.sz.mesg_size	= 0;
+					pUart->txStats.txPackets++;
 
 					startCDBackoffTimer( pUart );
 				}
@@ -286,6 +637,9 @@ void loconet_phy_uart_rxtx_task( void *pParameter )
 					pUart->txMsg.sz.command		= 0x00;
 					pUart->txMsg.sz.mesg_size	= 0;
 					pUart->cntRetryError++;
+					pUart->txStats.txErrors++;
+
+					complete_tx_track( pUart, pUart->txTag, LN_TX_DONE_FAILED );
 				}
 			}
 		}
@@ -308,6 +662,84 @@ void loconet_phy_uart_rxtx_task( void *pParameter )
 }
 
 
+//**************************************************************************
+//	loconet_phy_uart_dispatch_task
+//--------------------------------------------------------------------------
+//	pipeline mode: spread the messages of the rx ring over the bus.
+//	The consumers run in this task, so they can not disturb the
+//	timing of the rx/tx task on the other core.
+//	The bus lock keeps the application tasks out meanwhile.
+//
+static void loconet_phy_uart_dispatch_task( void *pParameter )
+{
+	loconet_phy_uart_t		*pUart = (loconet_phy_uart_t *)pParameter;
+	loconet_phy_rx_entry_t	entry;
+
+	while( 1 )
+	{
+		ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+		loconet_bus_lock( pUart->pBus );
+
+		while( loconet_ring_pop( &(pUart->rxRing), &entry ) )
+		{
+			dispatch_rx_entry( pUart, &entry );
+		}
+
+		deliver_tx_completions( pUart );
+
+		loconet_bus_unlock( pUart->pBus );
+	}
+}
+
+
+//**************************************************************************
+//	send_message
+//--------------------------------------------------------------------------
+//	safety messages go to the priority queue, all others to the tx
+//	ring. 'tag' is the index + 1 of a tx track entry or 0.
+//
+static loconet_tx_status_t send_message( loconet_phy_uart_t *pUart, const void *pProducer, LnMsg *pMsg, TickType_t maxWait, uint8_t tag )
+{
+	loconet_tx_status_t	status;
+	tx_prio_entry_t		prioEntry;
+
+	if( loconet_bus_is_safety_msg( pMsg ) )
+	{
+		prioEntry.msg		= *pMsg;
+		prioEntry.pSender	= pProducer;
+		prioEntry.tag		= tag;
+
+		if( pdTRUE == xQueueSendToBack( pUart->txPrioQueue, (void *)&prioEntry, maxWait ) )
+		{
+			return( LN_TX_QUEUED );
+		}
+
+		return( LN_TX_DROPPED );
+	}
+
+	while( 1 )
+	{
+		if( 0 == tag )
+		{
+			status = loconet_tx_ring_push( &(pUart->txRing), pProducer, pMsg );
+		}
+		else
+		{
+			status = loconet_tx_ring_push_tagged( &(pUart->txRing), pProducer, pMsg, tag );
+		}
+
+		if( (LN_TX_DROPPED != status) || (0 == maxWait) )
+		{
+			return( status );
+		}
+
+		vTaskDelay( 1 );
+		maxWait--;
+	}
+}
+
+
 //==========================================================================
 //
 //		E X T E R N   F U N C T I O N S
@@ -333,13 +765,35 @@ void loconet_phy_uart_init( loconet_phy_uart_t *pUart )
 		inversMask |= UART_SIGNAL_TXD_INV;
 	}
 
-	pUart->rxQueue	= xQueueCreateStatic( RX_QUEUE_LENGTH, sizeof( LnMsg ), rxQueueStorage, &rxQueueBuffer );
-	pUart->txQueue	= xQueueCreateStatic( TX_QUEUE_LENGTH, sizeof( LnMsg ), txQueueStorage, &txQueueBuffer );
+	pUart->rxQueue	= xQueueCreateStatic( RX_QUEUE_LENGTH, sizeof( loconet_phy_rx_entry_t ), rxQueueStorage, &rxQueueBuffer );
 
-	for( uint8_t idx = 0 ; sizeof( LnMsg ) > idx ; idx++ )
-	{
-		pUart->txMsg.data[ idx ] = 0;
-	}
+	pUart->txPrioQueue	= xQueueCreateStatic( TX_PRIO_QUEUE_LENGTH, sizeof( tx_prio_entry_t ), txPrioQueueStorage, &txPrioQueueBuffer );
+
+	loconet_tx_ring_init( &(pUart->txRing) );
+
+	memset( &(pUart->txMsg), 0, sizeof( LnMsg ) );
+	memset( &(pUart->txDeferred), 0, sizeof( LnMsg ) );
+
+	pUart->pTxSender			= NULL;
+	pUart->pTxSenderDeferred	= NULL;
+	pUart->txTag				= 0;
+	pUart->txTagDeferred		= 0;
+
+	memset( pUart->txTrack, 0, sizeof( pUart->txTrack ) );
+	atomic_init( &(pUart->txHandleSeq), 0 );
+
+	pUart->txLatencyLast		= 0;
+	pUart->txLatencyMax			= 0;
+	pUart->cntTrackFull			= 0;
+	pUart->rxResync				= false;
+	pUart->cntEchoDiscarded		= 0;
+
+	memset( &(pUart->rxStats), 0, sizeof( LnRxStats ) );
+	memset( &(pUart->txStats), 0, sizeof( LnTxStats ) );
+
+	pUart->safetyLatencyLast	= 0;
+	pUart->safetyLatencyMax		= 0;
+	pUart->cntSafetyRx			= 0;
 
 	loconet_msg_buffer_init( &(pUart->rxMsg) );
 	loconet_bus_register_consumer( pUart->pBus, pUart, loconet_phy_uart_send );
@@ -359,16 +813,57 @@ void loconet_phy_uart_init( loconet_phy_uart_t *pUart )
 	UART_LL_GET_HW( pUart->uartNum )->rs485_conf.rs485rxby_tx_en	= 0;
 	UART_LL_GET_HW( pUart->uartNum )->rs485_conf.rs485tx_rx_en		= 1;
 
-	pUart->state = IDLE;
+	pUart->state			= IDLE;
+	pUart->cntRxRingFull	= 0;
+	pUart->cntRxQueueFull	= 0;
+
+	if( pUart->pipeline )
+	{
+		loconet_ring_init( &(pUart->rxRing), rxRingStorage, sizeof( loconet_phy_rx_entry_t ), LOCONET_PHY_RX_RING_SIZE );
+
+		pUart->dispatchTask = xTaskCreateStaticPinnedToCore(	loconet_phy_uart_dispatch_task,
+																"LN_dispatch",
+																LOCONET_PHY_DISPATCH_STACK_SIZE,
+																(void *)pUart,
+																tskIDLE_PRIORITY + 1,
+																xDispatchStack,
+																&xDispatchTaskBuffer,
+																LOCONET_PHY_DISPATCH_CORE		);
+	}
 
 	pUart->rxtxTask = xTaskCreateStaticPinnedToCore(	loconet_phy_uart_rxtx_task,
 														"LN_tx_rx",
-														TASK_STACK_SIZE,
+														LOCONET_PHY_TASK_STACK_SIZE,
 														(void *)pUart,
 														tskIDLE_PRIORITY,
 														xStack,
 														&xTaskBuffer,
-														0							);
+														LOCONET_PHY_WIRE_CORE		);
+}
+
+
+//**************************************************************************
+//	loconet_phy_uart_register_safety
+//--------------------------------------------------------------------------
+//	the handlers should be registered before loconet_phy_uart_init()
+//	is called, because they are used by the rx/tx task
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	no free handler entry
+//
+uint8_t loconet_phy_uart_register_safety( loconet_phy_uart_t *pUart, loconet_phy_uart_func_safety pFunc, void *pContext )
+{
+	if( LOCONET_PHY_MAX_SAFETY_HANDLERS <= pUart->numSafetyHandlers )
+	{
+		return( 1 );
+	}
+
+	pUart->pSafetyFunc[ pUart->numSafetyHandlers ]		= pFunc;
+	pUart->pSafetyContext[ pUart->numSafetyHandlers ]	= pContext;
+	pUart->numSafetyHandlers++;
+
+	return( 0 );
 }
 
 
@@ -378,6 +873,9 @@ void loconet_phy_uart_init( loconet_phy_uart_t *pUart )
 //	this function will check if we got a new loconet message over
 //	the physical lines. If so, the message will be spread over the bus
 //	to all other consumers, but not to us.
+//	Our own messages are not received again, they are spread as
+//	loopback after they are sent (see loconet_bus_set_loopback).
+//	The completion functions of tracked messages are called here, too.
 //
 //	NOTE:
 //	this function should be called in a periodical manner to get
@@ -385,21 +883,31 @@ void loconet_phy_uart_init( loconet_phy_uart_t *pUart )
 //
 void loconet_phy_uart_process( loconet_phy_uart_t *pUart )
 {
-	LnMsg	aMsg;
+	loconet_phy_rx_entry_t	entry;
+
+	if( pUart->pipeline )
+	{
+		//--------------------------------------------------------------
+		//	the dispatch task does the job
+		//
+		return;
+	}
 
 	if( uxQueueMessagesWaiting( pUart->rxQueue ) )
 	{
 		//--------------------------------------------------------------
 		//	we received a loconet msg
 		//
-		xQueueReceive( pUart->rxQueue, &aMsg, 0 );
+		xQueueReceive( pUart->rxQueue, &entry, 0 );
 
 		//--------------------------------------------------------------
 		//	now spread this msg over the bus to all other consumers,
 		//	but not to ourself
 		//
-		loconet_bus_broadcast( pUart->pBus, &aMsg, loconet_phy_uart_send );
+		dispatch_rx_entry( pUart, &entry );
 	}
+
+	deliver_tx_completions( pUart );
 }
 
 
@@ -411,10 +919,93 @@ void loconet_phy_uart_process( loconet_phy_uart_t *pUart )
 //	Normaly this function will be called automaticly if there is a new
 //	loconet message spread on the bus.
 //	But it can be called directly, also.
+//	Safety messages bypass the normal tx ring.
+//	The sender on the bus is the producer for the rate limit.
 //
 void loconet_phy_uart_send( loconet_bus_consumer pConsumer, LnMsg *pMsg )
 {
 	loconet_phy_uart_t	*pUart	= (loconet_phy_uart_t *)pConsumer;
 
-	xQueueSendToBack( pUart->txQueue, (void *)pMsg, 0 );
+	loconet_phy_uart_send_status( pUart, (const void *)loconet_bus_get_sender( pUart->pBus ), pMsg, 0 );
+}
+
+
+//**************************************************************************
+//	loconet_phy_uart_send_status
+//--------------------------------------------------------------------------
+//	return values:	LN_TX_QUEUED	=> the message is in the tx ring
+//					LN_TX_COALESCED	=> a waiting message of the slot
+//									   will carry the new value
+//					LN_TX_DROPPED	=> still no room after 'maxWait'
+//
+loconet_tx_status_t loconet_phy_uart_send_status( loconet_phy_uart_t *pUart, const void *pProducer, LnMsg *pMsg, TickType_t maxWait )
+{
+	return( send_message( pUart, pProducer, pMsg, maxWait, 0 ) );
+}
+
+
+//**************************************************************************
+//	loconet_phy_uart_send_tracked
+//--------------------------------------------------------------------------
+//	the message is never coalesced and not waited for, the completion
+//	of a dropped message is given by the next loconet_phy_uart_process()
+//
+loconet_phy_tx_handle_t loconet_phy_uart_send_tracked(	loconet_phy_uart_t				*pUart,
+														const void						*pProducer,
+														LnMsg							*pMsg,
+														loconet_phy_uart_func_tx_done	pFunc,
+														void							*pContext	)
+{
+	loconet_phy_tx_track_t	*pTrack	= NULL;
+	loconet_phy_tx_handle_t	handle;
+	unsigned char			state;
+	uint8_t					idx;
+
+	for( idx = 0 ; (LOCONET_PHY_MAX_TX_TRACK > idx) && (NULL == pTrack) ; idx++ )
+	{
+		state = TRACK_FREE;
+
+		if( atomic_compare_exchange_strong( &(pUart->txTrack[ idx ].state), &state, TRACK_BUSY ) )
+		{
+			pTrack = &(pUart->txTrack[ idx ]);
+		}
+	}
+
+	if( NULL == pTrack )
+	{
+		pUart->cntTrackFull++;
+		return( LOCONET_PHY_TX_HANDLE_NONE );
+	}
+
+	//------------------------------------------------------------------
+	//	'idx' is already behind the entry, so it is the tag.
+	//	The lower 8 bits of the handle are the tag, so it is never 0.
+	//	The entry can be done and used again before we return, so the
+	//	handle is kept local
+	//
+	handle = (atomic_fetch_add( &(pUart->txHandleSeq), 1 ) << 8) | idx;
+
+	pTrack->pFunc					= pFunc;
+	pTrack->pContext				= pContext;
+	pTrack->completion.handle		= handle;
+	pTrack->completion.status		= LN_TX_DONE_OK;
+	pTrack->completion.cntRetries	= 0;
+	pTrack->completion.timeQueued	= (uint64_t)esp_timer_get_time();
+	pTrack->completion.timeFirstTry	= 0;
+	pTrack->completion.timeDone		= 0;
+
+	if( LN_TX_DROPPED == send_message( pUart, pProducer, pMsg, 0, idx ) )
+	{
+		pTrack->completion.status	= LN_TX_DONE_DROPPED;
+		pTrack->completion.timeDone	= pTrack->completion.timeQueued;
+
+		atomic_store_explicit( &(pTrack->state), TRACK_DONE, memory_order_release );
+
+		if( pUart->pipeline )
+		{
+			xTaskNotifyGive( pUart->dispatchTask );
+		}
+	}
+
+	return( handle );
 }
@@ -0,0 +1,314 @@
+//##########################################################################
+//#
+//#		LoconetReplay.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library read a capture file
+//#	(see LoconetCapture.h) and inject the recorded messages into the
+//#	bus, with the original timing, N times faster or as fast as possible.
+//#	On Linux the file is memory mapped, so even very large captures
+//#	are not loaded into RAM, otherwise the file is read in blocks.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef __linux__
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+#include <esp_timer.h>
+
+#include "LoconetMsgBuffer.h"
+#include "LoconetCapture.h"
+#include "LoconetReplay.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define MAX_RECORD_SIZE		(10 + 1 + LN_BUF_SIZE)
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	available_bytes
+//--------------------------------------------------------------------------
+//	returns the number of bytes that can be read at 'pos'.
+//	Without mmap the block is refilled if a record might not fit.
+//
+static size_t available_bytes( loconet_replay_t *pReplay )
+{
+#ifndef __linux__
+	size_t	rest = pReplay->size - pReplay->pos;
+
+	if( (MAX_RECORD_SIZE > rest) && (NULL != pReplay->pFile) )
+	{
+		memmove( pReplay->block, &(pReplay->block[ pReplay->pos ]), rest );
+
+		pReplay->size	= rest + fread( &(pReplay->block[ rest ]), 1, LOCONET_REPLAY_BLOCK_SIZE - rest, pReplay->pFile );
+		pReplay->pos	= 0;
+	}
+#endif
+
+	return( pReplay->size - pReplay->pos );
+}
+
+
+//**************************************************************************
+//	read_record
+//--------------------------------------------------------------------------
+//	decode the next record into nextTime/nextSource/nextMsg,
+//	returns false at the end of the file or for a broken record
+//
+static bool read_record( loconet_replay_t *pReplay )
+{
+	size_t			avail	= available_bytes( pReplay );
+	const uint8_t	*pData	= &(pReplay->pData[ pReplay->pos ]);
+	uint64_t		delta	= 0;
+	size_t			count	= 0;
+	uint8_t			shift	= 0;
+	uint8_t			length;
+
+	pReplay->hasNext = false;
+
+	do
+	{
+		if( (count >= avail) || (63 < shift) )
+		{
+			return( false );
+		}
+
+		delta	|= (uint64_t)(pData[ count ] & 0x7F) << shift;
+		shift	+= 7;
+
+	} while( pData[ count++ ] & 0x80 );
+
+	if( (count + 3) > avail )
+	{
+		return( false );
+	}
+
+	pReplay->nextSource	= pData[ count++ ];
+	length				= LOCONET_PACKET_SIZE( pData[ count ], pData[ count + 1 ] );
+
+	if( (2 > length) || (LN_BUF_SIZE < length) || ((count + length) > avail) )
+	{
+		pReplay->cntErrors++;
+		return( false );
+	}
+
+	memset( &(pReplay->nextMsg), 0, sizeof( LnMsg ) );
+	memcpy( pReplay->nextMsg.data, &(pData[ count ]), length );
+
+	pReplay->pos		+= count + length;
+	pReplay->nextTime	+= delta;
+	pReplay->hasNext	 = true;
+
+	return( true );
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_replay_open
+//--------------------------------------------------------------------------
+//	'pSender' is used as sender of the injected messages, so this
+//	consumer will not get them (e.g. the phy, so the messages are
+//	not sent to the loconet), it may be NULL.
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	file could not be opened
+//		2	=>	not a capture file or unknown version
+//
+uint8_t loconet_replay_open(	loconet_replay_t			*pReplay,
+								loconet_bus_t				*pBus,
+								const char					*pPath,
+								loconet_bus_consumer_func	pSender		)
+{
+	memset( pReplay, 0, sizeof( loconet_replay_t ) );
+
+	pReplay->pBus		= pBus;
+	pReplay->pSender	= pSender;
+	pReplay->mode		= LN_REPLAY_REALTIME;
+	pReplay->speed		= 1;
+
+#ifdef __linux__
+	struct stat	fileStat;
+	void		*pMap;
+
+	pReplay->fd = open( pPath, O_RDONLY );
+
+	if( 0 > pReplay->fd )
+	{
+		return( 1 );
+	}
+
+	if( (0 != fstat( pReplay->fd, &fileStat )) || (LOCONET_CAPTURE_HEADER_SIZE > fileStat.st_size) )
+	{
+		loconet_replay_close( pReplay );
+		return( 2 );
+	}
+
+	pMap = mmap( NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, pReplay->fd, 0 );
+
+	if( MAP_FAILED == pMap )
+	{
+		loconet_replay_close( pReplay );
+		return( 1 );
+	}
+
+	madvise( pMap, (size_t)fileStat.st_size, MADV_SEQUENTIAL );
+
+	pReplay->pData	= (const uint8_t *)pMap;
+	pReplay->size	= (size_t)fileStat.st_size;
+#else
+	pReplay->pFile = fopen( pPath, "rb" );
+
+	if( NULL == pReplay->pFile )
+	{
+		return( 1 );
+	}
+
+	pReplay->pData	= pReplay->block;
+	pReplay->size	= fread( pReplay->block, 1, LOCONET_REPLAY_BLOCK_SIZE, pReplay->pFile );
+#endif
+
+	if(		(LOCONET_CAPTURE_HEADER_SIZE > pReplay->size)
+		||	(0 != memcmp( pReplay->pData, LOCONET_CAPTURE_MAGIC, LOCONET_CAPTURE_HEADER_SIZE - 1 ))
+		||	(LOCONET_CAPTURE_VERSION != pReplay->pData[ LOCONET_CAPTURE_HEADER_SIZE - 1 ])			)
+	{
+		loconet_replay_close( pReplay );
+		return( 2 );
+	}
+
+	pReplay->pos = LOCONET_CAPTURE_HEADER_SIZE;
+
+	read_record( pReplay );
+
+	pReplay->firstTime = pReplay->nextTime;
+	pReplay->startTime = (uint64_t)esp_timer_get_time();
+
+	return( 0 );
+}
+
+
+//**************************************************************************
+//	loconet_replay_close
+//--------------------------------------------------------------------------
+//
+void loconet_replay_close( loconet_replay_t *pReplay )
+{
+#ifdef __linux__
+	if( NULL != pReplay->pData )
+	{
+		munmap( (void *)pReplay->pData, pReplay->size );
+	}
+
+	if( 0 <= pReplay->fd )
+	{
+		close( pReplay->fd );
+	}
+
+	pReplay->fd = -1;
+#else
+	if( NULL != pReplay->pFile )
+	{
+		fclose( pReplay->pFile );
+	}
+
+	pReplay->pFile = NULL;
+#endif
+
+	pReplay->pData		= NULL;
+	pReplay->size		= 0;
+	pReplay->pos		= 0;
+	pReplay->hasNext	= false;
+}
+
+
+//**************************************************************************
+//	loconet_replay_set_mode
+//--------------------------------------------------------------------------
+//	'speed' is only used for LN_REPLAY_SCALED.
+//	The timing restarts with the next message.
+//
+void loconet_replay_set_mode( loconet_replay_t *pReplay, loconet_replay_mode_t mode, uint16_t speed )
+{
+	pReplay->mode		= mode;
+	pReplay->speed		= ((LN_REPLAY_SCALED == mode) && (0 < speed)) ? speed : 1;
+	pReplay->firstTime	= pReplay->nextTime;
+	pReplay->startTime	= (uint64_t)esp_timer_get_time();
+}
+
+
+//**************************************************************************
+//	loconet_replay_process
+//--------------------------------------------------------------------------
+//
+bool loconet_replay_process( loconet_replay_t *pReplay )
+{
+	uint64_t	elapsed;
+
+	elapsed = ((uint64_t)esp_timer_get_time() - pReplay->startTime) * pReplay->speed;
+
+	for( uint16_t cnt = 0 ; pReplay->hasNext && (LOCONET_REPLAY_BURST > cnt) ; cnt++ )
+	{
+		if(		(LN_REPLAY_MAX_SPEED != pReplay->mode)
+			&&	((pReplay->nextTime - pReplay->firstTime) > elapsed)	)
+		{
+			break;
+		}
+
+		pReplay->cntMessages++;
+
+		loconet_bus_broadcast( pReplay->pBus, &(pReplay->nextMsg), pReplay->pSender );
+
+		read_record( pReplay );
+	}
+
+	return( pReplay->hasNext );
+}
@@ -0,0 +1,135 @@
+//##########################################################################
+//#
+//#		LoconetRing.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	A lock-free ring buffer for one producer and one consumer
+//#	(e.g. two tasks). The elements have a fixed size and are copied
+//#	into and out of the ring. The storage is given by the caller.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "LoconetRing.h"
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_ring_init
+//--------------------------------------------------------------------------
+//	'pStorage' must hold 'capacity' elements of 'elemSize' bytes.
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	capacity is not a power of two
+//
+uint8_t loconet_ring_init( loconet_ring_t *pRing, void *pStorage, uint16_t elemSize, uint32_t capacity )
+{
+	if( (0 == capacity) || (0 != (capacity & (capacity - 1))) )
+	{
+		return( 1 );
+	}
+
+	pRing->pStorage	= (uint8_t *)pStorage;
+	pRing->elemSize	= elemSize;
+	pRing->mask		= capacity - 1;
+
+	atomic_init( &(pRing->head), 0 );
+	atomic_init( &(pRing->tail), 0 );
+
+	return( 0 );
+}
+
+
+//**************************************************************************
+//	loconet_ring_push
+//--------------------------------------------------------------------------
+//	must only be called by the producer.
+//	Returns false if the ring is full.
+//
+bool loconet_ring_push( loconet_ring_t *pRing, const void *pElem )
+{
+	unsigned	head = atomic_load_explicit( &(pRing->head), memory_order_relaxed );
+	unsigned	tail = atomic_load_explicit( &(pRing->tail), memory_order_acquire );
+
+	if( (head - tail) > pRing->mask )
+	{
+		return( false );
+	}
+
+	memcpy( &(pRing->pStorage[ (head & pRing->mask) * pRing->elemSize ]), pElem, pRing->elemSize );
+
+	atomic_store_explicit( &(pRing->head), head + 1, memory_order_release );
+
+	return( true );
+}
+
+
+//**************************************************************************
+//	loconet_ring_pop
+//--------------------------------------------------------------------------
+//	must only be called by the consumer.
+//	Returns false if the ring is empty.
+//
+bool loconet_ring_pop( loconet_ring_t *pRing, void *pElem )
+{
+	unsigned	tail = atomic_load_explicit( &(pRing->tail), memory_order_relaxed );
+	unsigned	head = atomic_load_explicit( &(pRing->head), memory_order_acquire );
+
+	if( head == tail )
+	{
+		return( false );
+	}
+
+	memcpy( pElem, &(pRing->pStorage[ (tail & pRing->mask) * pRing->elemSize ]), pRing->elemSize );
+
+	atomic_store_explicit( &(pRing->tail), tail + 1, memory_order_release );
+
+	return( true );
+}
+
+
+//**************************************************************************
+//	loconet_ring_count
+//--------------------------------------------------------------------------
+//	number of elements in the ring, can be called from any task
+//
+uint32_t loconet_ring_count( loconet_ring_t *pRing )
+{
+	unsigned	head = atomic_load_explicit( &(pRing->head), memory_order_acquire );
+	unsigned	tail = atomic_load_explicit( &(pRing->tail), memory_order_acquire );
+
+	return( (uint32_t)(head - tail) );
+}
@@ -0,0 +1,367 @@
+//##########################################################################
+//#
+//#		LoconetRouteEngine.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library set routes, i.e. named
+//#	sequences of switch commands. The commands are sent with a pacing
+//#	time between them and can be confirmed by OPC_LONG_ACK or OPC_SW_REP.
+//#	Several routes can run at the same time.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <esp_timer.h>
+
+#include "ln_opc.h"
+#include "LoconetMsgBuffer.h"
+#include "LoconetRouteEngine.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define LACK_ACCEPTED		0x7F
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	send_entry
+//--------------------------------------------------------------------------
+//	send the next switch command of the run, the output is switched on
+//
+static void send_entry( loconet_route_engine_t *pEngine, uint8_t runIdx )
+{
+	loconet_route_run_t			*pRun	= &(pEngine->runs[ runIdx ]);
+	const loconet_route_entry_t	*pEntry	= &(pRun->pRoute->pEntries[ pRun->nextEntry ]);
+	uint16_t					address	= pEntry->address - 1;
+	LnMsg						aMsg;
+
+	memset( &aMsg, 0, sizeof( LnMsg ) );
+
+	aMsg.srq.command	= (LN_ROUTE_CONFIRM_ACK == pEngine->confirmMode) ? OPC_SW_ACK : OPC_SW_REQ;
+	aMsg.srq.sw1		= (uint8_t)(address & 0x7F);
+	aMsg.srq.sw2		= (uint8_t)((address >> 7) & 0x0F) | OPC_SW_REQ_OUT;
+
+	if( pEntry->closed )
+	{
+		aMsg.srq.sw2 |= OPC_SW_REQ_DIR;
+	}
+
+	loconet_msg_set_checksum( &aMsg );
+
+	pEngine->waitRun	= runIdx;
+	pEngine->sendTime	= (uint64_t)esp_timer_get_time();
+	pEngine->cntCommands++;
+
+	loconet_bus_broadcast( pEngine->pBus, &aMsg, loconet_route_engine_receive );
+}
+
+
+//**************************************************************************
+//	finish_entry
+//--------------------------------------------------------------------------
+//	the current entry of the run is done (confirmed or failed),
+//	the run is done after its last entry
+//
+static void finish_entry( loconet_route_engine_t *pEngine, uint8_t runIdx, bool confirmed )
+{
+	loconet_route_run_t	*pRun = &(pEngine->runs[ runIdx ]);
+
+	pEngine->waiting	= false;
+	pEngine->retries	= 0;
+
+	if( !confirmed )
+	{
+		pRun->cntFailed++;
+		pEngine->cntFailed++;
+	}
+
+	pRun->nextEntry++;
+
+	if( pRun->nextEntry >= pRun->pRoute->numEntries )
+	{
+		pRun->active			= false;
+		pEngine->lastDurationUs	= (uint32_t)((uint64_t)esp_timer_get_time() - pRun->startTime);
+
+		if( pRun->pDoneFunc )
+		{
+			(*pRun->pDoneFunc)( pRun->pDoneContext, pRun->pRoute, 0 == pRun->cntFailed, pEngine->lastDurationUs );
+		}
+	}
+}
+
+
+//**************************************************************************
+//	select_next_run
+//--------------------------------------------------------------------------
+//	round robin over all active runs, so concurrent routes are
+//	interleaved. Returns LOCONET_ROUTE_MAX_RUNS if no run is active.
+//
+static uint8_t select_next_run( loconet_route_engine_t *pEngine )
+{
+	uint8_t	runIdx;
+
+	for( uint8_t cnt = 0 ; LOCONET_ROUTE_MAX_RUNS > cnt ; cnt++ )
+	{
+		runIdx				= pEngine->nextRun;
+		pEngine->nextRun	= (pEngine->nextRun + 1) % LOCONET_ROUTE_MAX_RUNS;
+
+		if( pEngine->runs[ runIdx ].active )
+		{
+			return( runIdx );
+		}
+	}
+
+	return( LOCONET_ROUTE_MAX_RUNS );
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_route_engine_init
+//--------------------------------------------------------------------------
+//	return values:
+//		0	=>	okay
+//		1	=>	no free consumer entry on the bus
+//
+uint8_t loconet_route_engine_init( loconet_route_engine_t *pEngine, loconet_bus_t *pBus )
+{
+	memset( pEngine, 0, sizeof( loconet_route_engine_t ) );
+
+	pEngine->pBus			= pBus;
+	pEngine->pacingUs		= LOCONET_ROUTE_DEFAULT_PACING_US;
+	pEngine->timeoutUs		= LOCONET_ROUTE_DEFAULT_TIMEOUT_US;
+	pEngine->maxRetries		= LOCONET_ROUTE_DEFAULT_RETRIES;
+	pEngine->confirmMode	= LN_ROUTE_CONFIRM_NONE;
+
+	return( loconet_bus_register_consumer( pBus, pEngine, loconet_route_engine_receive ) );
+}
+
+
+//**************************************************************************
+//	loconet_route_engine_start
+//--------------------------------------------------------------------------
+//	the route must be valid until the done function was called
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	no free run
+//		2	=>	route is already running
+//		3	=>	route is empty
+//
+uint8_t loconet_route_engine_start(	loconet_route_engine_t	*pEngine,
+									const loconet_route_t	*pRoute,
+									loconet_route_func_done	pFunc,
+									void					*pContext	)
+{
+	loconet_route_run_t	*pRun;
+
+	if( 0 == pRoute->numEntries )
+	{
+		return( 3 );
+	}
+
+	if( loconet_route_engine_is_running( pEngine, pRoute ) )
+	{
+		return( 2 );
+	}
+
+	for( uint8_t runIdx = 0 ; LOCONET_ROUTE_MAX_RUNS > runIdx ; runIdx++ )
+	{
+		pRun = &(pEngine->runs[ runIdx ]);
+
+		if( !pRun->active )
+		{
+			pRun->pRoute		= pRoute;
+			pRun->pDoneFunc		= pFunc;
+			pRun->pDoneContext	= pContext;
+			pRun->startTime		= (uint64_t)esp_timer_get_time();
+			pRun->nextEntry		= 0;
+			pRun->cntFailed		= 0;
+			pRun->active		= true;
+
+			return( 0 );
+		}
+	}
+
+	return( 1 );
+}
+
+
+//**************************************************************************
+//	loconet_route_engine_is_running
+//--------------------------------------------------------------------------
+//
+bool loconet_route_engine_is_running( loconet_route_engine_t *pEngine, const loconet_route_t *pRoute )
+{
+	for( uint8_t runIdx = 0 ; LOCONET_ROUTE_MAX_RUNS > runIdx ; runIdx++ )
+	{
+		if( pEngine->runs[ runIdx ].active && (pEngine->runs[ runIdx ].pRoute == pRoute) )
+		{
+			return( true );
+		}
+	}
+
+	return( false );
+}
+
+
+//**************************************************************************
+//	loconet_route_engine_process
+//--------------------------------------------------------------------------
+//
+void loconet_route_engine_process( loconet_route_engine_t *pEngine )
+{
+	uint64_t	now = (uint64_t)esp_timer_get_time();
+	uint8_t		runIdx;
+
+	if( pEngine->waiting )
+	{
+		if( (now - pEngine->sendTime) < pEngine->timeoutUs )
+		{
+			return;
+		}
+
+		//--------------------------------------------------------------
+		//	no confirmation, send the command again
+		//	or give up this entry
+		//
+		if( pEngine->retries < pEngine->maxRetries )
+		{
+			pEngine->retries++;
+			pEngine->cntRetries++;
+
+			send_entry( pEngine, pEngine->waitRun );
+		}
+		else
+		{
+			finish_entry( pEngine, pEngine->waitRun, false );
+		}
+
+		return;
+	}
+
+	if( (now - pEngine->sendTime) < pEngine->pacingUs )
+	{
+		return;
+	}
+
+	runIdx = select_next_run( pEngine );
+
+	if( LOCONET_ROUTE_MAX_RUNS > runIdx )
+	{
+		if( LN_ROUTE_CONFIRM_NONE == pEngine->confirmMode )
+		{
+			send_entry( pEngine, runIdx );
+			finish_entry( pEngine, runIdx, true );
+		}
+		else
+		{
+			pEngine->waiting = true;
+
+			send_entry( pEngine, runIdx );
+		}
+	}
+}
+
+
+//**************************************************************************
+//	loconet_route_engine_receive
+//--------------------------------------------------------------------------
+//
+void loconet_route_engine_receive( loconet_bus_consumer pConsumer, LnMsg *pMsg )
+{
+	loconet_route_engine_t		*pEngine = (loconet_route_engine_t *)pConsumer;
+	const loconet_route_entry_t	*pEntry;
+	loconet_route_run_t			*pRun;
+	uint16_t					address;
+	bool						closed;
+
+	if( !pEngine->waiting )
+	{
+		return;
+	}
+
+	pRun	= &(pEngine->runs[ pEngine->waitRun ]);
+	pEntry	= &(pRun->pRoute->pEntries[ pRun->nextEntry ]);
+
+	switch( pMsg->sz.command )
+	{
+		case OPC_LONG_ACK:
+			if(		(LN_ROUTE_CONFIRM_ACK == pEngine->confirmMode)
+				&&	((OPC_SW_ACK & OPC_MASK) == pMsg->lack.opcode)	)
+			{
+				if( LACK_ACCEPTED == pMsg->lack.ack1 )
+				{
+					finish_entry( pEngine, pEngine->waitRun, true );
+				}
+				else
+				{
+					//------------------------------------------------------
+					//	command station buffer is full,
+					//	let the timeout send the command again
+					//
+					pEngine->sendTime = (uint64_t)esp_timer_get_time() - pEngine->timeoutUs + pEngine->pacingUs;
+				}
+			}
+			break;
+
+		case OPC_SW_REP:
+			if(		(LN_ROUTE_CONFIRM_REPORT == pEngine->confirmMode)
+				&&	(0 == (pMsg->srp.sn2 & OPC_SW_REP_INPUTS))			)
+			{
+				address	= (pMsg->srp.sn1 | ((pMsg->srp.sn2 & 0x0F) << 7)) + 1;
+				closed	= (0 != (pMsg->srp.sn2 & OPC_SW_REP_CLOSED));
+
+				if( (address == pEntry->address) && (closed == pEntry->closed) )
+				{
+					finish_entry( pEngine, pEngine->waitRun, true );
+				}
+			}
+			break;
+
+		default:
+			break;
+	}
+}
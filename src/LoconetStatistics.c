@@ -0,0 +1,299 @@
+//##########################################################################
+//#
+//#		LoconetStatistics.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library collect traffic
+//#	statistics: frames and bytes per opcode, the addresses with the
+//#	most traffic (sensors, switches, slots) and the bus utilization,
+//#	collisions and tx errors in 1 s, 10 s and 60 s windows.
+//#	Every update is O(1), a consistent snapshot can be taken from
+//#	any task.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <esp_timer.h>
+
+#include "ln_opc.h"
+#include "LoconetStatistics.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+//	length of the windows in seconds
+static const uint8_t	windowLength[ LN_STATS_NUM_WINDOWS ] = { 1, 10, 60 };
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	current_bucket
+//--------------------------------------------------------------------------
+//	returns the bucket of the current second, a bucket of an old
+//	second is cleared first
+//
+static loconet_stats_bucket_t *current_bucket( loconet_statistics_t *pStats )
+{
+	uint32_t				second	= (uint32_t)(esp_timer_get_time() / 1000000);
+	loconet_stats_bucket_t	*pBucket = &(pStats->buckets[ second % LOCONET_STATS_NUM_BUCKETS ]);
+
+	if( pBucket->second != second )
+	{
+		memset( pBucket, 0, sizeof( loconet_stats_bucket_t ) );
+
+		pBucket->second = second;
+	}
+
+	return( pBucket );
+}
+
+
+//**************************************************************************
+//	top_count
+//--------------------------------------------------------------------------
+//	Space-Saving: a new address replaces the entry with the lowest
+//	count and takes over its count as error.
+//	The list has a constant length, so this is O(1).
+//
+static void top_count( loconet_stats_top_t *pTop, uint16_t address )
+{
+	loconet_stats_talker_t	*pMin = NULL;
+
+	for( uint8_t idx = 0 ; idx < pTop->numEntries ; idx++ )
+	{
+		if( pTop->entries[ idx ].address == address )
+		{
+			pTop->entries[ idx ].count++;
+			return;
+		}
+
+		if( (NULL == pMin) || (pTop->entries[ idx ].count < pMin->count) )
+		{
+			pMin = &(pTop->entries[ idx ]);
+		}
+	}
+
+	if( LOCONET_STATS_TOP_K > pTop->numEntries )
+	{
+		pMin		= &(pTop->entries[ pTop->numEntries++ ]);
+		pMin->count	= 0;
+	}
+
+	pMin->address	 = address;
+	pMin->error		 = pMin->count;
+	pMin->count		+= 1;
+}
+
+
+//**************************************************************************
+//	count_address
+//--------------------------------------------------------------------------
+//	find the sensor, switch or slot of the message
+//
+static void count_address( loconet_statistics_t *pStats, LnMsg *pMsg )
+{
+	switch( pMsg->sz.command )
+	{
+		case OPC_INPUT_REP:
+			top_count(	&(pStats->top[ LN_STATS_SENSOR ]),
+						(((pMsg->ir.in1 | ((pMsg->ir.in2 & 0x0F) << 7)) << 1) + ((pMsg->ir.in2 & OPC_INPUT_REP_SW) ? 2 : 1)) );
+			break;
+
+		case OPC_SW_REQ:
+		case OPC_SW_REP:
+		case OPC_SW_ACK:
+		case OPC_SW_STATE:
+			top_count(	&(pStats->top[ LN_STATS_SWITCH ]),
+						(pMsg->srq.sw1 | ((pMsg->srq.sw2 & 0x0F) << 7)) + 1 );
+			break;
+
+		case OPC_LOCO_SPD:
+		case OPC_LOCO_DIRF:
+		case OPC_LOCO_SND:
+		case OPC_SLOT_STAT1:
+		case OPC_RQ_SL_DATA:
+			top_count( &(pStats->top[ LN_STATS_SLOT ]), pMsg->lsp.slot );
+			break;
+
+		case OPC_SL_RD_DATA:
+		case OPC_WR_SL_DATA:
+			top_count( &(pStats->top[ LN_STATS_SLOT ]), pMsg->sd.slot );
+			break;
+
+		default:
+			break;
+	}
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_statistics_init
+//--------------------------------------------------------------------------
+//	return values:
+//		0	=>	okay
+//		1	=>	no free consumer entry on the bus
+//
+uint8_t loconet_statistics_init( loconet_statistics_t *pStats, loconet_bus_t *pBus )
+{
+	memset( pStats, 0, sizeof( loconet_statistics_t ) );
+
+	pStats->pBus = pBus;
+
+	for( uint8_t idx = 0 ; LOCONET_STATS_NUM_BUCKETS > idx ; idx++ )
+	{
+		pStats->buckets[ idx ].second = UINT32_MAX;
+	}
+
+	atomic_init( &(pStats->sequence), 0 );
+
+	return( loconet_bus_register_consumer( pBus, pStats, loconet_statistics_process ) );
+}
+
+
+//**************************************************************************
+//	loconet_statistics_sample_tx
+//--------------------------------------------------------------------------
+//	the counters of the phy are free running, so only the difference
+//	to the last sample is added
+//
+void loconet_statistics_sample_tx( loconet_statistics_t *pStats, const LnTxStats *pTxStats )
+{
+	loconet_stats_bucket_t	*pBucket;
+
+	atomic_fetch_add( &(pStats->sequence), 1 );
+
+	pBucket = current_bucket( pStats );
+
+	pBucket->txPackets	+= (uint16_t)(pTxStats->txPackets  - pStats->lastTxStats.txPackets);
+	pBucket->txErrors	+= (uint16_t)(pTxStats->txErrors   - pStats->lastTxStats.txErrors);
+	pBucket->collisions	+= (uint16_t)(pTxStats->collisions - pStats->lastTxStats.collisions);
+
+	pStats->lastTxStats = *pTxStats;
+
+	atomic_fetch_add( &(pStats->sequence), 1 );
+}
+
+
+//**************************************************************************
+//	loconet_statistics_snapshot
+//--------------------------------------------------------------------------
+//	the windows contain the last complete seconds
+//
+void loconet_statistics_snapshot( loconet_statistics_t *pStats, loconet_stats_snapshot_t *pSnapshot )
+{
+	loconet_stats_bucket_t	*pBucket;
+	uint32_t				second = (uint32_t)(esp_timer_get_time() / 1000000);
+	uint32_t				age;
+	unsigned				startSeq;
+
+	do
+	{
+		startSeq = atomic_load( &(pStats->sequence) );
+
+		memcpy( pSnapshot->opcodeFrames, pStats->opcodeFrames, sizeof( pSnapshot->opcodeFrames ) );
+		memcpy( pSnapshot->opcodeBytes, pStats->opcodeBytes, sizeof( pSnapshot->opcodeBytes ) );
+		memcpy( pSnapshot->top, pStats->top, sizeof( pSnapshot->top ) );
+		memset( pSnapshot->window, 0, sizeof( pSnapshot->window ) );
+
+		pSnapshot->totalFrames	= pStats->totalFrames;
+		pSnapshot->totalBytes	= pStats->totalBytes;
+
+		for( uint8_t idx = 0 ; LOCONET_STATS_NUM_BUCKETS > idx ; idx++ )
+		{
+			pBucket	= &(pStats->buckets[ idx ]);
+			age		= second - pBucket->second;
+
+			for( uint8_t win = 0 ; LN_STATS_NUM_WINDOWS > win ; win++ )
+			{
+				if( (0 < age) && (age <= windowLength[ win ]) )
+				{
+					pSnapshot->window[ win ].frames		+= pBucket->frames;
+					pSnapshot->window[ win ].bytes		+= pBucket->bytes;
+					pSnapshot->window[ win ].txPackets	+= pBucket->txPackets;
+					pSnapshot->window[ win ].txErrors	+= pBucket->txErrors;
+					pSnapshot->window[ win ].collisions	+= pBucket->collisions;
+				}
+			}
+		}
+
+		atomic_thread_fence( memory_order_acquire );
+
+	} while( (startSeq & 1) || (startSeq != atomic_load( &(pStats->sequence) )) );
+
+	for( uint8_t win = 0 ; LN_STATS_NUM_WINDOWS > win ; win++ )
+	{
+		pSnapshot->window[ win ].utilization = (uint16_t)(	((uint64_t)pSnapshot->window[ win ].bytes * LOCONET_STATS_BYTE_TIME_US * 1000)
+														/	((uint64_t)windowLength[ win ] * 1000000)										);
+	}
+}
+
+
+//**************************************************************************
+//	loconet_statistics_process
+//--------------------------------------------------------------------------
+//
+void loconet_statistics_process( loconet_bus_consumer pConsumer, LnMsg *pMsg )
+{
+	loconet_statistics_t	*pStats	= (loconet_statistics_t *)pConsumer;
+	uint8_t					length	= LOCONET_PACKET_SIZE( pMsg->sz.command, pMsg->sz.mesg_size );
+	uint8_t					opcIdx	= pMsg->sz.command & 0x7F;
+	loconet_stats_bucket_t	*pBucket;
+
+	atomic_fetch_add( &(pStats->sequence), 1 );
+
+	pStats->opcodeFrames[ opcIdx ]++;
+	pStats->opcodeBytes[ opcIdx ]	+= length;
+	pStats->totalFrames++;
+	pStats->totalBytes				+= length;
+
+	pBucket = current_bucket( pStats );
+
+	pBucket->frames++;
+	pBucket->bytes += length;
+
+	count_address( pStats, pMsg );
+
+	atomic_fetch_add( &(pStats->sequence), 1 );
+}
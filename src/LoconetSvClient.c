@@ -0,0 +1,467 @@
+//##########################################################################
+//#
+//#		LoconetSvClient.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library read and write
+//#	System Variables (SV, protocol version 2) of loconet devices.
+//#	A list of requests is worked off with several requests in flight
+//#	to different devices, four SVs per transfer where possible.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <esp_timer.h>
+
+#include "ln_opc.h"
+#include "LoconetMsgBuffer.h"
+#include "LoconetSvClient.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define SVX_MARKER		0x10
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	pack_msb
+//--------------------------------------------------------------------------
+//	the MSBs of four bytes are moved into one extension byte
+//
+static uint8_t pack_msb( uint8_t *pByte0, uint8_t *pByte1, uint8_t *pByte2, uint8_t *pByte3 )
+{
+	uint8_t	svx = SVX_MARKER;
+
+	svx |= (*pByte0 & 0x80) >> 7;
+	svx |= (*pByte1 & 0x80) >> 6;
+	svx |= (*pByte2 & 0x80) >> 5;
+	svx |= (*pByte3 & 0x80) >> 4;
+
+	*pByte0 &= 0x7F;
+	*pByte1 &= 0x7F;
+	*pByte2 &= 0x7F;
+	*pByte3 &= 0x7F;
+
+	return( svx );
+}
+
+
+//**************************************************************************
+//	unpack_msb
+//--------------------------------------------------------------------------
+//
+static void unpack_msb( uint8_t svx, uint8_t *pByte0, uint8_t *pByte1, uint8_t *pByte2, uint8_t *pByte3 )
+{
+	*pByte0 |= (svx & 0x01) << 7;
+	*pByte1 |= (svx & 0x02) << 6;
+	*pByte2 |= (svx & 0x04) << 5;
+	*pByte3 |= (svx & 0x08) << 4;
+}
+
+
+//**************************************************************************
+//	request_command
+//--------------------------------------------------------------------------
+//
+static uint8_t request_command( loconet_sv_request_t *pRequest )
+{
+	if( LN_SV_READ == pRequest->op )
+	{
+		return( (4 == pRequest->count) ? SV_CMD_READ_QUAD : SV_CMD_READ_SINGLE );
+	}
+
+	return( (4 == pRequest->count) ? SV_CMD_WRITE_QUAD : SV_CMD_WRITE_SINGLE );
+}
+
+
+//**************************************************************************
+//	send_request
+//--------------------------------------------------------------------------
+//
+static void send_request( loconet_sv_client_t *pClient, uint16_t idx )
+{
+	loconet_sv_request_t	*pRequest	= &(pClient->pRequests[ idx ]);
+	svMsg					*pSv;
+	LnMsg					aMsg;
+
+	memset( &aMsg, 0, sizeof( LnMsg ) );
+
+	pSv				= &(aMsg.sv);
+	pSv->command	= OPC_PEER_XFER;
+	pSv->mesg_size	= SV_MSG_SIZE;
+	pSv->src		= LOCONET_SV_SOURCE;
+	pSv->sv_cmd		= request_command( pRequest );
+	pSv->sv_type	= SV_TYPE_2;
+	pSv->dst_lo		= (uint8_t)(pRequest->destination & 0xFF);
+	pSv->dst_hi		= (uint8_t)(pRequest->destination >> 8);
+	pSv->sv_addl	= (uint8_t)(pRequest->svAddress & 0xFF);
+	pSv->sv_addh	= (uint8_t)(pRequest->svAddress >> 8);
+
+	if( LN_SV_WRITE == pRequest->op )
+	{
+		pSv->d1	= pRequest->data[ 0 ];
+		pSv->d2	= pRequest->data[ 1 ];
+		pSv->d3	= pRequest->data[ 2 ];
+		pSv->d4	= pRequest->data[ 3 ];
+	}
+
+	pSv->svx1	= pack_msb( &(pSv->dst_lo), &(pSv->dst_hi), &(pSv->sv_addl), &(pSv->sv_addh) );
+	pSv->svx2	= pack_msb( &(pSv->d1), &(pSv->d2), &(pSv->d3), &(pSv->d4) );
+
+	loconet_msg_set_checksum( &aMsg );
+
+	pRequest->status									= LN_SV_IN_FLIGHT;
+	pClient->inFlight[ pClient->numInFlight ]			= idx;
+	pClient->sendTime[ pClient->numInFlight ]			= (uint64_t)esp_timer_get_time();
+	pClient->numInFlight++;
+
+	loconet_bus_broadcast( pClient->pBus, &aMsg, loconet_sv_client_receive );
+}
+
+
+//**************************************************************************
+//	remove_in_flight
+//--------------------------------------------------------------------------
+//
+static void remove_in_flight( loconet_sv_client_t *pClient, uint8_t slot )
+{
+	pClient->numInFlight--;
+
+	pClient->inFlight[ slot ]	= pClient->inFlight[ pClient->numInFlight ];
+	pClient->sendTime[ slot ]	= pClient->sendTime[ pClient->numInFlight ];
+}
+
+
+//**************************************************************************
+//	finish_request
+//--------------------------------------------------------------------------
+//
+static void finish_request( loconet_sv_client_t *pClient, uint16_t idx, loconet_sv_status_t status )
+{
+	pClient->pRequests[ idx ].status = status;
+
+	if( LN_SV_DONE == status )
+	{
+		pClient->cntDone++;
+	}
+	else
+	{
+		pClient->cntFailed++;
+	}
+
+	if( (pClient->cntDone + pClient->cntFailed) == pClient->numRequests )
+	{
+		pClient->endTime = (uint64_t)esp_timer_get_time();
+	}
+
+	if( pClient->pProgressFunc )
+	{
+		(*pClient->pProgressFunc)( pClient->pProgressContext, pClient->cntDone, pClient->cntFailed, pClient->numRequests );
+	}
+}
+
+
+//**************************************************************************
+//	is_destination_busy
+//--------------------------------------------------------------------------
+//	a device will only get one request at a time
+//
+static bool is_destination_busy( loconet_sv_client_t *pClient, uint16_t destination )
+{
+	for( uint8_t slot = 0 ; slot < pClient->numInFlight ; slot++ )
+	{
+		if( pClient->pRequests[ pClient->inFlight[ slot ] ].destination == destination )
+		{
+			return( true );
+		}
+	}
+
+	return( false );
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_sv_client_init
+//--------------------------------------------------------------------------
+//	return values:
+//		0	=>	okay
+//		1	=>	no free consumer entry on the bus
+//
+uint8_t loconet_sv_client_init( loconet_sv_client_t *pClient, loconet_bus_t *pBus )
+{
+	memset( pClient, 0, sizeof( loconet_sv_client_t ) );
+
+	pClient->pBus			= pBus;
+	pClient->maxInFlight	= LOCONET_SV_DEFAULT_IN_FLIGHT;
+	pClient->maxRetries		= LOCONET_SV_DEFAULT_RETRIES;
+	pClient->timeoutUs		= LOCONET_SV_DEFAULT_TIMEOUT_US;
+
+	return( loconet_bus_register_consumer( pBus, pClient, loconet_sv_client_receive ) );
+}
+
+
+//**************************************************************************
+//	loconet_sv_fill_requests
+//--------------------------------------------------------------------------
+//	split a block of SVs of one device into quad and single requests.
+//	For a write 'pData' must hold 'numSvs' bytes, for a read it is
+//	not used.
+//	Returns the number of filled requests.
+//
+uint16_t loconet_sv_fill_requests(	loconet_sv_request_t	*pRequests,
+									uint16_t				maxRequests,
+									uint16_t				destination,
+									uint16_t				firstSv,
+									uint16_t				numSvs,
+									loconet_sv_op_t			op,
+									const uint8_t			*pData			)
+{
+	loconet_sv_request_t	*pRequest;
+	uint16_t				num = 0;
+
+	while( (0 < numSvs) && (num < maxRequests) )
+	{
+		pRequest = &(pRequests[ num++ ]);
+
+		memset( pRequest, 0, sizeof( loconet_sv_request_t ) );
+
+		pRequest->destination	= destination;
+		pRequest->svAddress		= firstSv;
+		pRequest->count			= (4 <= numSvs) ? 4 : 1;
+		pRequest->op			= op;
+		pRequest->status		= LN_SV_PENDING;
+
+		if( (LN_SV_WRITE == op) && (NULL != pData) )
+		{
+			memcpy( pRequest->data, pData, pRequest->count );
+			pData += pRequest->count;
+		}
+
+		firstSv	+= pRequest->count;
+		numSvs	-= pRequest->count;
+	}
+
+	return( num );
+}
+
+
+//**************************************************************************
+//	loconet_sv_client_start
+//--------------------------------------------------------------------------
+//	the requests will be worked off by loconet_sv_client_process()
+//	the array must be valid until all requests are finished
+//
+//	return values:
+//		0	=>	okay
+//		1	=>	client is busy
+//
+uint8_t loconet_sv_client_start(	loconet_sv_client_t			*pClient,
+									loconet_sv_request_t		*pRequests,
+									uint16_t					numRequests,
+									loconet_sv_func_progress	pFunc,
+									void						*pContext		)
+{
+	if( loconet_sv_client_is_busy( pClient ) )
+	{
+		return( 1 );
+	}
+
+	for( uint16_t idx = 0 ; idx < numRequests ; idx++ )
+	{
+		pRequests[ idx ].status		= LN_SV_PENDING;
+		pRequests[ idx ].retries	= 0;
+	}
+
+	pClient->pRequests			= pRequests;
+	pClient->numRequests		= numRequests;
+	pClient->firstPending		= 0;
+	pClient->numInFlight		= 0;
+	pClient->pProgressFunc		= pFunc;
+	pClient->pProgressContext	= pContext;
+	pClient->cntDone			= 0;
+	pClient->cntFailed			= 0;
+	pClient->cntRetries			= 0;
+	pClient->startTime			= (uint64_t)esp_timer_get_time();
+	pClient->endTime			= 0;
+
+	if( pClient->maxInFlight > LOCONET_SV_MAX_IN_FLIGHT )
+	{
+		pClient->maxInFlight = LOCONET_SV_MAX_IN_FLIGHT;
+	}
+
+	return( 0 );
+}
+
+
+//**************************************************************************
+//	loconet_sv_client_is_busy
+//--------------------------------------------------------------------------
+//
+bool loconet_sv_client_is_busy( loconet_sv_client_t *pClient )
+{
+	return( (pClient->cntDone + pClient->cntFailed) < pClient->numRequests );
+}
+
+
+//**************************************************************************
+//	loconet_sv_client_process
+//--------------------------------------------------------------------------
+//	first handle the timeouts, then fill up the free in flight slots
+//
+void loconet_sv_client_process( loconet_sv_client_t *pClient )
+{
+	loconet_sv_request_t	*pRequest;
+	uint64_t				now = (uint64_t)esp_timer_get_time();
+	uint16_t				idx;
+	uint8_t					slot;
+
+	slot = pClient->numInFlight;
+
+	while( 0 < slot )
+	{
+		slot--;
+
+		if( (now - pClient->sendTime[ slot ]) > pClient->timeoutUs )
+		{
+			idx			= pClient->inFlight[ slot ];
+			pRequest	= &(pClient->pRequests[ idx ]);
+
+			remove_in_flight( pClient, slot );
+
+			if( pRequest->retries < pClient->maxRetries )
+			{
+				pRequest->retries++;
+				pRequest->status = LN_SV_PENDING;
+				pClient->cntRetries++;
+
+				if( idx < pClient->firstPending )
+				{
+					pClient->firstPending = idx;
+				}
+			}
+			else
+			{
+				finish_request( pClient, idx, LN_SV_FAILED );
+			}
+		}
+	}
+
+	while(		(pClient->firstPending < pClient->numRequests)
+			&&	(LN_SV_PENDING != pClient->pRequests[ pClient->firstPending ].status)	)
+	{
+		pClient->firstPending++;
+	}
+
+	for(	idx = pClient->firstPending ;
+			(idx < pClient->numRequests) && (pClient->numInFlight < pClient->maxInFlight) ;
+			idx++ )
+	{
+		pRequest = &(pClient->pRequests[ idx ]);
+
+		if(		(LN_SV_PENDING == pRequest->status)
+			&&	!is_destination_busy( pClient, pRequest->destination )	)
+		{
+			send_request( pClient, idx );
+		}
+	}
+}
+
+
+//**************************************************************************
+//	loconet_sv_client_receive
+//--------------------------------------------------------------------------
+//	a reply holds the device address in the destination field
+//
+void loconet_sv_client_receive( loconet_bus_consumer pConsumer, LnMsg *pMsg )
+{
+	loconet_sv_client_t		*pClient	= (loconet_sv_client_t *)pConsumer;
+	loconet_sv_request_t	*pRequest;
+	svMsg					sv;
+	uint16_t				destination;
+	uint16_t				svAddress;
+
+	if(		(OPC_PEER_XFER != pMsg->sz.command)
+		||	(SV_MSG_SIZE != pMsg->sz.mesg_size)
+		||	(SV_TYPE_2 != pMsg->sv.sv_type)
+		||	(0 == (pMsg->sv.sv_cmd & SV_CMD_REPLY))
+		||	(0 == pClient->numInFlight)				)
+	{
+		return;
+	}
+
+	sv = pMsg->sv;
+
+	unpack_msb( sv.svx1, &(sv.dst_lo), &(sv.dst_hi), &(sv.sv_addl), &(sv.sv_addh) );
+	unpack_msb( sv.svx2, &(sv.d1), &(sv.d2), &(sv.d3), &(sv.d4) );
+
+	destination	= (uint16_t)(sv.dst_lo  | (sv.dst_hi  << 8));
+	svAddress	= (uint16_t)(sv.sv_addl | (sv.sv_addh << 8));
+
+	for( uint8_t slot = 0 ; slot < pClient->numInFlight ; slot++ )
+	{
+		uint16_t	idx = pClient->inFlight[ slot ];
+
+		pRequest = &(pClient->pRequests[ idx ]);
+
+		if(		(pRequest->destination == destination)
+			&&	(pRequest->svAddress == svAddress)
+			&&	(request_command( pRequest ) == (sv.sv_cmd & ~SV_CMD_REPLY))	)
+		{
+			if( LN_SV_READ == pRequest->op )
+			{
+				pRequest->data[ 0 ]	= sv.d1;
+				pRequest->data[ 1 ]	= sv.d2;
+				pRequest->data[ 2 ]	= sv.d3;
+				pRequest->data[ 3 ]	= sv.d4;
+			}
+
+			remove_in_flight( pClient, slot );
+			finish_request( pClient, idx, LN_SV_DONE );
+
+			return;
+		}
+	}
+}
@@ -0,0 +1,475 @@
+//##########################################################################
+//#
+//#		LoconetThrottle.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library drive locos with few frames:
+//#	only changed values are sent, limited per slot and by the budget of
+//#	the pool.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <esp_timer.h>
+
+#include "ln_opc.h"
+#include "LoconetMsgBuffer.h"
+#include "LoconetThrottle.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define TOKEN		1000000
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	update_pending
+//--------------------------------------------------------------------------
+//	a value that is set back before it was sent needs no frame
+//
+static void update_pending( loconet_throttle_t *pThrottle, uint8_t changed )
+{
+	uint8_t	pending = 0;
+
+	if( pThrottle->spd != pThrottle->sentSpd )
+	{
+		pending |= LN_THROTTLE_PENDING_SPD;
+	}
+
+	if( pThrottle->dirf != pThrottle->sentDirf )
+	{
+		pending |= LN_THROTTLE_PENDING_DIRF;
+	}
+
+	if( pThrottle->snd != pThrottle->sentSnd )
+	{
+		pending |= LN_THROTTLE_PENDING_SND;
+	}
+
+	if( pThrottle->pending & changed )
+	{
+		pThrottle->cntCoalesced++;
+	}
+
+	pThrottle->pending = pending;
+}
+
+
+//**************************************************************************
+//	send_frame
+//--------------------------------------------------------------------------
+//	all three frames have the same layout
+//
+static void send_frame( loconet_throttle_t *pThrottle, uint8_t opcode, uint8_t value, uint64_t now )
+{
+	LnMsg	aMsg;
+
+	memset( &aMsg, 0, sizeof( LnMsg ) );
+
+	aMsg.lsp.command	= opcode;
+	aMsg.lsp.slot		= pThrottle->slot;
+	aMsg.lsp.spd		= value;
+
+	loconet_msg_set_checksum( &aMsg );
+
+	pThrottle->sendTime = now;
+	pThrottle->cntFrames++;
+	pThrottle->pPool->cntFrames++;
+
+	loconet_bus_broadcast( pThrottle->pPool->pBus, &aMsg, loconet_throttle_pool_receive );
+}
+
+
+//**************************************************************************
+//	send_next
+//--------------------------------------------------------------------------
+//	one pending frame, the kinds take turns, so a speed that changes
+//	all the time does not hold back the functions. If the speed and
+//	the direction changed, a deceleration is sent before the direction
+//	and an acceleration after it.
+//
+static void send_next( loconet_throttle_t *pThrottle, uint64_t now )
+{
+	uint8_t	next = pThrottle->lastFrame;
+
+	do
+	{
+		next = (LN_THROTTLE_PENDING_SND == next) ? LN_THROTTLE_PENDING_SPD : (next << 1);
+
+	} while( !(pThrottle->pending & next) );
+
+	if(		(LN_THROTTLE_PENDING_SPD | LN_THROTTLE_PENDING_DIRF) == (pThrottle->pending & (LN_THROTTLE_PENDING_SPD | LN_THROTTLE_PENDING_DIRF))
+		&&	(LN_THROTTLE_PENDING_SND != next)																					)
+	{
+		next = (pThrottle->spd < pThrottle->sentSpd) ? LN_THROTTLE_PENDING_SPD : LN_THROTTLE_PENDING_DIRF;
+	}
+
+	pThrottle->lastFrame = next;
+
+	if( LN_THROTTLE_PENDING_SPD == next )
+	{
+		pThrottle->sentSpd = pThrottle->spd;
+		send_frame( pThrottle, OPC_LOCO_SPD, pThrottle->spd, now );
+	}
+	else if( LN_THROTTLE_PENDING_DIRF == next )
+	{
+		pThrottle->sentDirf = pThrottle->dirf;
+		send_frame( pThrottle, OPC_LOCO_DIRF, pThrottle->dirf, now );
+	}
+	else
+	{
+		pThrottle->sentSnd = pThrottle->snd;
+		send_frame( pThrottle, OPC_LOCO_SND, pThrottle->snd, now );
+	}
+
+	update_pending( pThrottle, 0 );
+}
+
+
+//**************************************************************************
+//	refill
+//--------------------------------------------------------------------------
+//
+static void refill( loconet_throttle_pool_t *pPool, uint64_t now )
+{
+	uint64_t	max = (uint64_t)pPool->burst * TOKEN;
+
+	pPool->tokens		+= (now - pPool->refillTime) * pPool->budget;
+	pPool->refillTime	 = now;
+
+	if( pPool->tokens > max )
+	{
+		pPool->tokens = max;
+	}
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_throttle_pool_init
+//--------------------------------------------------------------------------
+//	return values:
+//		0	=>	okay
+//		1	=>	no free consumer entry on the bus
+//
+uint8_t loconet_throttle_pool_init( loconet_throttle_pool_t *pPool, loconet_bus_t *pBus )
+{
+	memset( pPool, 0, sizeof( loconet_throttle_pool_t ) );
+
+	pPool->pBus			= pBus;
+	pPool->budget		= LOCONET_THROTTLE_DEFAULT_BUDGET;
+	pPool->burst		= LOCONET_THROTTLE_DEFAULT_BURST;
+	pPool->tokens		= (uint64_t)LOCONET_THROTTLE_DEFAULT_BURST * TOKEN;
+	pPool->refillTime	= (uint64_t)esp_timer_get_time();
+
+	return( loconet_bus_register_consumer( pBus, pPool, loconet_throttle_pool_receive ) );
+}
+
+
+//**************************************************************************
+//	loconet_throttle_init
+//--------------------------------------------------------------------------
+//
+uint8_t loconet_throttle_init( loconet_throttle_t *pThrottle, loconet_throttle_pool_t *pPool, uint8_t slot )
+{
+	if( (0 == slot) || (LOCONET_THROTTLE_MAX_SLOT < slot) )
+	{
+		return( 2 );
+	}
+
+	for( uint8_t idx = 0 ; LOCONET_THROTTLE_MAX_THROTTLES > idx ; idx++ )
+	{
+		if( NULL == pPool->pThrottles[ idx ] )
+		{
+			memset( pThrottle, 0, sizeof( loconet_throttle_t ) );
+
+			pThrottle->pPool		= pPool;
+			pThrottle->slot			= slot;
+			pThrottle->intervalUs	= LOCONET_THROTTLE_DEFAULT_INTERVAL_US;
+			pThrottle->lastFrame	= LN_THROTTLE_PENDING_SND;
+
+			pPool->pThrottles[ idx ] = pThrottle;
+
+			return( 0 );
+		}
+	}
+
+	return( 1 );
+}
+
+
+//**************************************************************************
+//	loconet_throttle_release
+//--------------------------------------------------------------------------
+//	pending frames are not sent any more
+//
+void loconet_throttle_release( loconet_throttle_t *pThrottle )
+{
+	loconet_throttle_pool_t	*pPool = pThrottle->pPool;
+
+	for( uint8_t idx = 0 ; LOCONET_THROTTLE_MAX_THROTTLES > idx ; idx++ )
+	{
+		if( pThrottle == pPool->pThrottles[ idx ] )
+		{
+			pPool->pThrottles[ idx ] = NULL;
+		}
+	}
+
+	pThrottle->pending = 0;
+}
+
+
+//**************************************************************************
+//	loconet_throttle_sync
+//--------------------------------------------------------------------------
+//
+void loconet_throttle_sync( loconet_throttle_t *pThrottle, uint8_t spd, uint8_t dirf, uint8_t snd )
+{
+	pThrottle->spd		= pThrottle->sentSpd	= spd & 0x7F;
+	pThrottle->dirf		= pThrottle->sentDirf	= dirf & 0x3F;
+	pThrottle->snd		= pThrottle->sentSnd	= snd & 0x0F;
+	pThrottle->pending	= 0;
+}
+
+
+//**************************************************************************
+//	loconet_throttle_set_speed
+//--------------------------------------------------------------------------
+//
+void loconet_throttle_set_speed( loconet_throttle_t *pThrottle, uint8_t spd )
+{
+	if( OPC_LOCO_SPD_ESTOP == spd )
+	{
+		loconet_throttle_estop( pThrottle );
+		return;
+	}
+
+	pThrottle->spd = spd & 0x7F;
+
+	update_pending( pThrottle, LN_THROTTLE_PENDING_SPD );
+}
+
+
+//**************************************************************************
+//	loconet_throttle_set_direction
+//--------------------------------------------------------------------------
+//
+void loconet_throttle_set_direction( loconet_throttle_t *pThrottle, bool forward )
+{
+	if( forward )
+	{
+		pThrottle->dirf &= ~DIRF_DIR;
+	}
+	else
+	{
+		pThrottle->dirf |= DIRF_DIR;
+	}
+
+	update_pending( pThrottle, LN_THROTTLE_PENDING_DIRF );
+}
+
+
+//**************************************************************************
+//	loconet_throttle_set_function
+//--------------------------------------------------------------------------
+//	F0 .. F4 are in 'dirf', F5 .. F8 in 'snd'
+//
+void loconet_throttle_set_function( loconet_throttle_t *pThrottle, uint8_t function, bool on )
+{
+	uint8_t	*pValue;
+	uint8_t	mask;
+	uint8_t	changed;
+
+	if( LOCONET_THROTTLE_MAX_FUNCTION < function )
+	{
+		return;
+	}
+
+	if( 0 == function )
+	{
+		pValue	= &(pThrottle->dirf);
+		mask	= DIRF_F0;
+		changed	= LN_THROTTLE_PENDING_DIRF;
+	}
+	else if( 4 >= function )
+	{
+		pValue	= &(pThrottle->dirf);
+		mask	= DIRF_F1 << (function - 1);
+		changed	= LN_THROTTLE_PENDING_DIRF;
+	}
+	else
+	{
+		pValue	= &(pThrottle->snd);
+		mask	= SND_F5 << (function - 5);
+		changed	= LN_THROTTLE_PENDING_SND;
+	}
+
+	if( on )
+	{
+		*pValue |= mask;
+	}
+	else
+	{
+		*pValue &= ~mask;
+	}
+
+	update_pending( pThrottle, changed );
+}
+
+
+//**************************************************************************
+//	loconet_throttle_estop
+//--------------------------------------------------------------------------
+//	sent at once, without interval and budget
+//
+void loconet_throttle_estop( loconet_throttle_t *pThrottle )
+{
+	pThrottle->spd		= OPC_LOCO_SPD_ESTOP;
+	pThrottle->sentSpd	= OPC_LOCO_SPD_ESTOP;
+
+	send_frame( pThrottle, OPC_LOCO_SPD, OPC_LOCO_SPD_ESTOP, (uint64_t)esp_timer_get_time() );
+
+	update_pending( pThrottle, 0 );
+}
+
+
+//**************************************************************************
+//	loconet_throttle_pool_process
+//--------------------------------------------------------------------------
+//	every throttle sends at most one frame per call. The next call
+//	starts with the throttle behind the last one that sent, so all
+//	throttles get the same share of the budget.
+//
+void loconet_throttle_pool_process( loconet_throttle_pool_t *pPool )
+{
+	loconet_throttle_t	*pThrottle;
+	uint64_t			now = (uint64_t)esp_timer_get_time();
+	uint8_t				idx;
+
+	refill( pPool, now );
+
+	for( uint8_t count = 0 ; LOCONET_THROTTLE_MAX_THROTTLES > count ; count++ )
+	{
+		idx			= (pPool->nextThrottle + count) % LOCONET_THROTTLE_MAX_THROTTLES;
+		pThrottle	= pPool->pThrottles[ idx ];
+
+		if(		(NULL == pThrottle)
+			||	(0 == pThrottle->pending)
+			||	((now - pThrottle->sendTime) < pThrottle->intervalUs)	)
+		{
+			continue;
+		}
+
+		if( TOKEN > pPool->tokens )
+		{
+			pPool->cntDeferred++;
+			break;
+		}
+
+		pPool->tokens		-= TOKEN;
+		pPool->nextThrottle	 = (idx + 1) % LOCONET_THROTTLE_MAX_THROTTLES;
+
+		send_next( pThrottle, now );
+	}
+}
+
+
+//**************************************************************************
+//	loconet_throttle_pool_receive
+//--------------------------------------------------------------------------
+//	a value that another throttle sent for the slot is taken over,
+//	if the own throttle has no newer one
+//
+void loconet_throttle_pool_receive( loconet_bus_consumer pConsumer, LnMsg *pMsg )
+{
+	loconet_throttle_pool_t	*pPool = (loconet_throttle_pool_t *)pConsumer;
+	loconet_throttle_t		*pThrottle;
+
+	if(		(OPC_LOCO_SPD  != pMsg->sz.command)
+		&&	(OPC_LOCO_DIRF != pMsg->sz.command)
+		&&	(OPC_LOCO_SND  != pMsg->sz.command)	)
+	{
+		return;
+	}
+
+	for( uint8_t idx = 0 ; LOCONET_THROTTLE_MAX_THROTTLES > idx ; idx++ )
+	{
+		pThrottle = pPool->pThrottles[ idx ];
+
+		if( (NULL == pThrottle) || (pThrottle->slot != pMsg->lsp.slot) )
+		{
+			continue;
+		}
+
+		if( OPC_LOCO_SPD == pMsg->sz.command )
+		{
+			if( !(pThrottle->pending & LN_THROTTLE_PENDING_SPD) )
+			{
+				pThrottle->spd = pMsg->lsp.spd;
+			}
+
+			pThrottle->sentSpd = pMsg->lsp.spd;
+		}
+		else if( OPC_LOCO_DIRF == pMsg->sz.command )
+		{
+			if( !(pThrottle->pending & LN_THROTTLE_PENDING_DIRF) )
+			{
+				pThrottle->dirf = pMsg->ldf.dirf;
+			}
+
+			pThrottle->sentDirf = pMsg->ldf.dirf;
+		}
+		else
+		{
+			if( !(pThrottle->pending & LN_THROTTLE_PENDING_SND) )
+			{
+				pThrottle->snd = pMsg->ls.snd;
+			}
+
+			pThrottle->sentSnd = pMsg->ls.snd;
+		}
+
+		update_pending( pThrottle, 0 );
+	}
+}
@@ -0,0 +1,214 @@
+//##########################################################################
+//#
+//#		LoconetTrace.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	Trace points along the rx and tx path of the library. Every event
+//#	is stored with a time stamp and a small payload in a lock-free
+//#	ring per core and can be exported as Chrome trace JSON
+//#	(chrome://tracing or ui.perfetto.dev).
+//#	Without LOCONET_TRACE_ENABLE all trace points compile to nothing.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include "LoconetTrace.h"
+
+#ifdef LOCONET_TRACE_ENABLE
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define TRACE_MASK		(LOCONET_TRACE_RING_SIZE - 1)
+
+_Static_assert( 0 == (LOCONET_TRACE_RING_SIZE & TRACE_MASK), "LOCONET_TRACE_RING_SIZE must be a power of two" );
+
+
+//==========================================================================
+//
+//		T Y P E   D E F I N I T I O N S
+//
+//==========================================================================
+
+//----------------------------------------------------------------------
+//	every task on a core reserves its slot with one atomic add,
+//	so a task that preempts another one on the same core can
+//	not overwrite its event. The oldest events are overwritten.
+//
+typedef struct trace_ring
+{
+	atomic_uint				head;
+	loconet_trace_event_t	events[ LOCONET_TRACE_RING_SIZE ];
+
+} trace_ring_t;
+
+
+//==========================================================================
+//
+//		G L O B A L   V A R I A B L E S
+//
+//==========================================================================
+
+static trace_ring_t	traceRings[ LOCONET_TRACE_NUM_CORES ];
+static atomic_bool	traceEnabled = true;
+
+static const char * const	eventNames[ LN_TRACE_NUM_EVENTS ] =
+{
+	"rx byte",
+	"rx frame",
+	"rx enqueue",
+	"rx dequeue",
+	"consumer",
+	"consumer",
+	"tx start",
+	"tx echo ok",
+	"tx collision",
+	"backoff end"
+};
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_trace_enable
+//--------------------------------------------------------------------------
+//
+void loconet_trace_enable( bool enable )
+{
+	atomic_store( &traceEnabled, enable );
+}
+
+
+//**************************************************************************
+//	loconet_trace_clear
+//--------------------------------------------------------------------------
+//
+void loconet_trace_clear( void )
+{
+	for( uint8_t core = 0 ; LOCONET_TRACE_NUM_CORES > core ; core++ )
+	{
+		atomic_store( &(traceRings[ core ].head), 0 );
+	}
+}
+
+
+//**************************************************************************
+//	loconet_trace_event
+//--------------------------------------------------------------------------
+//	normally called by the LN_TRACE() macro
+//
+void loconet_trace_event( uint8_t id, uint32_t payload )
+{
+	trace_ring_t			*pRing;
+	loconet_trace_event_t	*pEvent;
+
+	if( !atomic_load_explicit( &traceEnabled, memory_order_relaxed ) )
+	{
+		return;
+	}
+
+	pRing	= &(traceRings[ (uint32_t)xPortGetCoreID() % LOCONET_TRACE_NUM_CORES ]);
+	pEvent	= &(pRing->events[ atomic_fetch_add_explicit( &(pRing->head), 1, memory_order_relaxed ) & TRACE_MASK ]);
+
+	pEvent->time	= (uint64_t)esp_timer_get_time();
+	pEvent->payload	= payload;
+	pEvent->id		= id;
+}
+
+
+//**************************************************************************
+//	loconet_trace_export_json
+//--------------------------------------------------------------------------
+//	every core is shown as an own thread, the consumer calls
+//	of the bus as duration events, all others as instant events
+//
+uint32_t loconet_trace_export_json( FILE *pFile )
+{
+	loconet_trace_event_t	*pEvent;
+	const char				*pPhase;
+	uint32_t				head;
+	uint32_t				first;
+	uint32_t				count = 0;
+
+	fprintf( pFile, "{\"traceEvents\":[\n" );
+
+	for( uint8_t core = 0 ; LOCONET_TRACE_NUM_CORES > core ; core++ )
+	{
+		head	= atomic_load( &(traceRings[ core ].head) );
+		first	= (LOCONET_TRACE_RING_SIZE < head) ? (head - LOCONET_TRACE_RING_SIZE) : 0;
+
+		for( uint32_t idx = first ; idx != head ; idx++ )
+		{
+			pEvent = &(traceRings[ core ].events[ idx & TRACE_MASK ]);
+
+			if( LN_TRACE_NUM_EVENTS <= pEvent->id )
+			{
+				continue;
+			}
+
+			switch( pEvent->id )
+			{
+				case LN_TRACE_CONSUMER_ENTER:	pPhase = "\"ph\":\"B\"";			break;
+				case LN_TRACE_CONSUMER_EXIT:	pPhase = "\"ph\":\"E\"";			break;
+				default:						pPhase = "\"ph\":\"i\",\"s\":\"t\"";	break;
+			}
+
+			fprintf(	pFile,
+						"%s{\"name\":\"%s\",%s,\"ts\":%" PRIu64 ",\"pid\":1,\"tid\":%u,\"args\":{\"value\":%" PRIu32 "}}",
+						(0 < count) ? ",\n" : "",
+						eventNames[ pEvent->id ],
+						pPhase,
+						pEvent->time,
+						core,
+						pEvent->payload															);
+
+			count++;
+		}
+	}
+
+	fprintf( pFile, "\n]}\n" );
+
+	return( count );
+}
+
+#endif
@@ -0,0 +1,438 @@
+//##########################################################################
+//#
+//#		LoconetTxRing.c
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	The functions in this part of the library implement the lock-free
+//#	transmit ring with an optional token bucket per producer and
+//#	coalescing of the loco messages of a slot.
+//#
+//#-------------------------------------------------------------------------
+//#
+//#		MIT License
+//#
+//#		Copyright (c) 2023	Michael Pfeil
+//#							Am Kuckhof 8
+//#							D - 52146 Würselen
+//#							GERMANY
+//#
+//#-------------------------------------------------------------------------
+//#
+//#	File Version:	1		Date: 19.10.2026
+//#
+//#	Implementation:
+//#		-	First implementation of the functions
+//#
+//##########################################################################
+
+//==========================================================================
+//
+//		I N C L U D E S
+//
+//==========================================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <esp_timer.h>
+
+#include "LoconetMsgBuffer.h"
+#include "LoconetTxRing.h"
+
+
+//==========================================================================
+//
+//		D E F I N I T I O N S
+//
+//==========================================================================
+
+#define RING_MASK			(LOCONET_TX_RING_SIZE - 1)
+
+#define NO_COALESCE			0xFF
+
+
+//==========================================================================
+//
+//		I N T E R N A L   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	coalesce_index
+//--------------------------------------------------------------------------
+//	the three messages have the layout of locoSpdMsg, an emergency
+//	stop is never coalesced
+//
+static uint8_t coalesce_index( const LnMsg *pMsg )
+{
+	switch( pMsg->sz.command )
+	{
+		case OPC_LOCO_SPD:
+			return( (OPC_LOCO_SPD_ESTOP == pMsg->lsp.spd) ? NO_COALESCE : 0 );
+
+		case OPC_LOCO_DIRF:
+			return( 1 );
+
+		case OPC_LOCO_SND:
+			return( 2 );
+
+		default:
+			return( NO_COALESCE );
+	}
+}
+
+
+//**************************************************************************
+//	find_producer
+//--------------------------------------------------------------------------
+//	a new key takes a free entry
+//
+static loconet_tx_producer_t *find_producer( loconet_tx_ring_t *pRing, const void *pKey )
+{
+	uintptr_t	key = (uintptr_t)pKey;
+	uintptr_t	entry;
+
+	if( 0 == key )
+	{
+		return( &(pRing->producers[ 0 ]) );
+	}
+
+	for( uint8_t idx = 1 ; LOCONET_TX_MAX_PRODUCERS > idx ; idx++ )
+	{
+		entry = atomic_load( &(pRing->producers[ idx ].key) );
+
+		if(		(key == entry)
+			||	((0 == entry) && atomic_compare_exchange_strong( &(pRing->producers[ idx ].key), &entry, key ))
+			||	(key == entry)																					)
+		{
+			return( &(pRing->producers[ idx ]) );
+		}
+	}
+
+	return( &(pRing->producers[ 0 ]) );
+}
+
+
+//**************************************************************************
+//	take_token
+//--------------------------------------------------------------------------
+//	GCRA: the frame conforms if the theoretical arrival time is not
+//	more than the tolerance in the future.
+//	An arrival time further away than the tolerance plus one interval
+//	can not be set by a frame, it is from an idle producer before the
+//	timer wrapped around (or zero after the init).
+//	A producer without a rate always gets a token.
+//
+static bool take_token( loconet_tx_producer_t *pProducer, uint32_t now )
+{
+	unsigned	arrival = atomic_load( &(pProducer->arrivalTime) );
+	uint32_t	base;
+	int32_t		ahead;
+
+	if( 0 == pProducer->intervalUs )
+	{
+		return( true );
+	}
+
+	do
+	{
+		ahead	= (int32_t)(arrival - now);
+		base	= ((0 < ahead) && ((pProducer->toleranceUs + pProducer->intervalUs) >= (uint32_t)ahead)) ? arrival : now;
+
+		if( (base - now) > pProducer->toleranceUs )
+		{
+			return( false );
+		}
+
+	} while( !atomic_compare_exchange_weak( &(pProducer->arrivalTime), &arrival, base + pProducer->intervalUs ) );
+
+	return( true );
+}
+
+
+//**************************************************************************
+//	reserve_cell
+//--------------------------------------------------------------------------
+//	returns NULL if the ring is full
+//
+static loconet_tx_cell_t *reserve_cell( loconet_tx_ring_t *pRing, unsigned *pPos )
+{
+	loconet_tx_cell_t	*pCell;
+	unsigned			pos = atomic_load_explicit( &(pRing->head), memory_order_relaxed );
+	int32_t				diff;
+
+	while( 1 )
+	{
+		pCell	= &(pRing->cells[ pos & RING_MASK ]);
+		diff	= (int32_t)(atomic_load_explicit( &(pCell->sequence), memory_order_acquire ) - pos);
+
+		if( 0 == diff )
+		{
+			if( atomic_compare_exchange_weak_explicit(	&(pRing->head), &pos, pos + 1,
+														memory_order_relaxed, memory_order_relaxed ) )
+			{
+				*pPos = pos;
+				return( pCell );
+			}
+		}
+		else if( 0 > diff )
+		{
+			return( NULL );
+		}
+		else
+		{
+			pos = atomic_load_explicit( &(pRing->head), memory_order_relaxed );
+		}
+	}
+}
+
+
+//**************************************************************************
+//	publish_cell
+//--------------------------------------------------------------------------
+//	the cell is handed over to the consumer
+//
+static void publish_cell( loconet_tx_ring_t *pRing, loconet_tx_cell_t *pCell, unsigned pos )
+{
+	unsigned	count;
+	unsigned	highWater;
+
+	atomic_store_explicit( &(pCell->sequence), pos + 1, memory_order_release );
+
+	count		= pos + 1 - atomic_load( &(pRing->tail) );
+	highWater	= atomic_load( &(pRing->highWater) );
+
+	while( (count > highWater) && !atomic_compare_exchange_weak( &(pRing->highWater), &highWater, count ) )
+	{
+		;
+	}
+}
+
+
+//**************************************************************************
+//	push_message
+//--------------------------------------------------------------------------
+//	A loco message is first offered to a waiting message of the slot:
+//	the value is stored and if the message is still waiting, the
+//	consumer will read the new value (all accesses to 'value' and
+//	'waiting' are sequentially consistent). Otherwise the message is
+//	queued, if another producer was faster the reserved cell is
+//	turned into an empty one.
+//
+static loconet_tx_status_t push_message(	loconet_tx_ring_t	*pRing,
+										const void			*pProducer,
+										const LnMsg			*pMsg,
+										uint8_t				coalesce,
+										uint8_t				tag			)
+{
+	loconet_tx_producer_t	*pEntry;
+	loconet_tx_cell_t		*pCell;
+	uint32_t				now		= (uint32_t)esp_timer_get_time();
+	uint8_t					slot	= pMsg->lsp.slot & 0x7F;
+	unsigned				pos;
+
+	if( NO_COALESCE != coalesce )
+	{
+		atomic_store( &(pRing->value[ coalesce ][ slot ]), pMsg->lsp.spd );
+
+		if( atomic_load( &(pRing->waiting[ coalesce ][ slot ]) ) )
+		{
+			atomic_fetch_add( &(pRing->cntCoalesced), 1 );
+			return( LN_TX_COALESCED );
+		}
+	}
+
+	pEntry = find_producer( pRing, pProducer );
+
+	if( !take_token( pEntry, now ) )
+	{
+		atomic_fetch_add( &(pEntry->cntDropped), 1 );
+		atomic_fetch_add( &(pRing->cntDroppedRate), 1 );
+		return( LN_TX_DROPPED );
+	}
+
+	pCell = reserve_cell( pRing, &pos );
+
+	if( NULL == pCell )
+	{
+		atomic_fetch_sub( &(pEntry->arrivalTime), pEntry->intervalUs );
+		atomic_fetch_add( &(pEntry->cntDropped), 1 );
+		atomic_fetch_add( &(pRing->cntDroppedFull), 1 );
+		return( LN_TX_DROPPED );
+	}
+
+	if(		(NO_COALESCE != coalesce)
+		&&	atomic_exchange( &(pRing->waiting[ coalesce ][ slot ]), true )	)
+	{
+		pCell->coalesce			= NO_COALESCE;
+		pCell->tag				= 0;
+		pCell->msg.sz.command	= 0x00;
+
+		publish_cell( pRing, pCell, pos );
+
+		atomic_fetch_sub( &(pEntry->arrivalTime), pEntry->intervalUs );
+		atomic_fetch_add( &(pRing->cntCoalesced), 1 );
+		return( LN_TX_COALESCED );
+	}
+
+	pCell->coalesce		= coalesce;
+	pCell->tag			= tag;
+	pCell->pProducer	= pProducer;
+	pCell->msg			= *pMsg;
+
+	publish_cell( pRing, pCell, pos );
+
+	atomic_fetch_add( &(pRing->cntQueued), 1 );
+
+	return( LN_TX_QUEUED );
+}
+
+
+//==========================================================================
+//
+//		E X T E R N   F U N C T I O N S
+//
+//==========================================================================
+
+//**************************************************************************
+//	loconet_tx_ring_init
+//--------------------------------------------------------------------------
+//
+void loconet_tx_ring_init( loconet_tx_ring_t *pRing )
+{
+	memset( pRing, 0, sizeof( loconet_tx_ring_t ) );
+
+	for( unsigned idx = 0 ; LOCONET_TX_RING_SIZE > idx ; idx++ )
+	{
+		atomic_init( &(pRing->cells[ idx ].sequence), idx );
+	}
+
+	atomic_init( &(pRing->head), 0 );
+	atomic_init( &(pRing->tail), 0 );
+}
+
+
+//**************************************************************************
+//	loconet_tx_ring_set_rate
+//--------------------------------------------------------------------------
+//
+void loconet_tx_ring_set_rate( loconet_tx_ring_t *pRing, const void *pProducer, uint16_t rate, uint8_t burst )
+{
+	loconet_tx_producer_t	*pEntry = find_producer( pRing, pProducer );
+
+	pEntry->intervalUs	= (0 < rate) ? (1000000UL / rate) : 0;
+	pEntry->toleranceUs	= pEntry->intervalUs * ((0 < burst) ? (burst - 1) : 0);
+}
+
+
+//**************************************************************************
+//	loconet_tx_ring_push
+//--------------------------------------------------------------------------
+//
+loconet_tx_status_t loconet_tx_ring_push( loconet_tx_ring_t *pRing, const void *pProducer, const LnMsg *pMsg )
+{
+	return( push_message( pRing, pProducer, pMsg, coalesce_index( pMsg ), 0 ) );
+}
+
+
+//**************************************************************************
+//	loconet_tx_ring_push_tagged
+//--------------------------------------------------------------------------
+//
+loconet_tx_status_t loconet_tx_ring_push_tagged( loconet_tx_ring_t *pRing, const void *pProducer, const LnMsg *pMsg, uint8_t tag )
+{
+	return( push_message( pRing, pProducer, pMsg, NO_COALESCE, tag ) );
+}
+
+
+//**************************************************************************
+//	loconet_tx_ring_override_speed
+//--------------------------------------------------------------------------
+//
+void loconet_tx_ring_override_speed( loconet_tx_ring_t *pRing, uint8_t slot, uint8_t spd )
+{
+	atomic_store( &(pRing->value[ 0 ][ slot & 0x7F ]), spd );
+}
+
+
+//**************************************************************************
+//	loconet_tx_ring_pop
+//--------------------------------------------------------------------------
+//	'waiting' is cleared before the value is read, so a value that
+//	is stored later is queued again by its producer
+//
+bool loconet_tx_ring_pop( loconet_tx_ring_t *pRing, LnMsg *pMsg, const void **ppProducer, uint8_t *pTag )
+{
+	loconet_tx_cell_t	*pCell;
+	unsigned			tail = atomic_load_explicit( &(pRing->tail), memory_order_relaxed );
+	const void			*pProducer;
+	uint8_t				coalesce;
+	uint8_t				tag;
+	uint8_t				slot;
+
+	while( 1 )
+	{
+		pCell = &(pRing->cells[ tail & RING_MASK ]);
+
+		if( (tail + 1) != atomic_load_explicit( &(pCell->sequence), memory_order_acquire ) )
+		{
+			return( false );
+		}
+
+		//------------------------------------------------------
+		//	the cell belongs to the producers again after the
+		//	sequence is stored, so everything is copied before
+		//
+		coalesce	= pCell->coalesce;
+		pProducer	= pCell->pProducer;
+		tag			= pCell->tag;
+		*pMsg		= pCell->msg;
+
+		atomic_store_explicit( &(pCell->sequence), tail + LOCONET_TX_RING_SIZE, memory_order_release );
+		atomic_store_explicit( &(pRing->tail), ++tail, memory_order_release );
+
+		if( 0x00 == pMsg->sz.command )
+		{
+			continue;
+		}
+
+		if( NULL != ppProducer )
+		{
+			*ppProducer = pProducer;
+		}
+
+		if( NULL != pTag )
+		{
+			*pTag = tag;
+		}
+
+		if( NO_COALESCE != coalesce )
+		{
+			slot = pMsg->lsp.slot & 0x7F;
+
+			atomic_store( &(pRing->waiting[ coalesce ][ slot ]), false );
+
+			pMsg->lsp.spd = atomic_load( &(pRing->value[ coalesce ][ slot ]) );
+
+			loconet_msg_set_checksum( pMsg );
+		}
+
+		return( true );
+	}
+}
+
+
+//**************************************************************************
+//	loconet_tx_ring_count
+//--------------------------------------------------------------------------
+//	number of messages in the ring, can be called from any task
+//
+uint32_t loconet_tx_ring_count( loconet_tx_ring_t *pRing )
+{
+	unsigned	head = atomic_load_explicit( &(pRing->head), memory_order_acquire );
+	unsigned	tail = atomic_load_explicit( &(pRing->tail), memory_order_acquire );
+
+	return( (uint32_t)(head - tail) );
+}